@@ -6,6 +6,17 @@
 #define QX_ALIGNED(x) __attribute__ ((aligned(x)))
 #endif
 
+// Function-level target attributes for the wide vector kernels, so they can be
+// compiled next to the baseline code and selected at runtime. MSVC doesn't
+// need them to emit AVX2/AVX-512 instructions.
+#if defined(_MSC_VER)
+#define QX_TARGET_AVX2
+#define QX_TARGET_AVX512
+#else
+#define QX_TARGET_AVX2 __attribute__ ((target("avx2,fma")))
+#define QX_TARGET_AVX512 __attribute__ ((target("avx512f,avx2,fma")))
+#endif
+
 // MSVC doesn't define __SSE__, so just assume it is available...
 #if defined(_MSC_VER)
 #define __SSE__
@@ -0,0 +1,72 @@
+/**
+ * @file    backend.h
+ * @brief   simulation backends
+ */
+
+#ifndef QX_BACKEND_H
+#define QX_BACKEND_H
+
+#include <cstring>
+
+namespace qx
+{
+   /**
+    * simulation backends : the state vector simulates any circuit, the
+    * stabilizer tableau only clifford circuits, and the density matrix
+    * evolves the mixed state of noisy circuits exactly (without binary
+    * control). the matrix product state simulates noiseless circuits of
+    * single-qubit and singly-controlled gates on many qubits, as long as
+    * their entanglement stays low. the compressed state vector stores the
+    * amplitudes in sparse or dense chunks, for noiseless circuits whose
+    * states have a small support, and the sparse state hashes the few
+    * non-zero amplitudes of arithmetic and oracle circuits, moving to a
+    * state vector when they grow too many. __auto_backend__ picks the cheapest
+    * backend able to run the program.
+    */
+   typedef enum __backend_t
+   {
+      __auto_backend__,
+      __state_vector_backend__,
+      __stabilizer_backend__,
+      __density_matrix_backend__,
+      __mps_backend__,
+      __compressed_backend__,
+      __sparse_backend__
+   } backend_t;
+
+   /**
+    * \brief backend name
+    */
+   inline const char * backend_name(backend_t b)
+   {
+      switch (b)
+      {
+         case __state_vector_backend__ : return "state_vector";
+         case __stabilizer_backend__   : return "stabilizer";
+         case __density_matrix_backend__ : return "density_matrix";
+         case __mps_backend__          : return "mps";
+         case __compressed_backend__   : return "compressed";
+         case __sparse_backend__       : return "sparse";
+         default                       : return "auto";
+      }
+   }
+
+   /**
+    * \brief parse a backend name ("auto", "state_vector", "stabilizer",
+    *    "density_matrix", "mps", "compressed" or "sparse")
+    * \return false if the name is unknown
+    */
+   inline bool backend_from_name(const char * name, backend_t & b)
+   {
+      if (!strcmp(name,"auto"))         { b = __auto_backend__;         return true; }
+      if (!strcmp(name,"state_vector")) { b = __state_vector_backend__; return true; }
+      if (!strcmp(name,"stabilizer"))   { b = __stabilizer_backend__;   return true; }
+      if (!strcmp(name,"density_matrix")) { b = __density_matrix_backend__; return true; }
+      if (!strcmp(name,"mps"))          { b = __mps_backend__;          return true; }
+      if (!strcmp(name,"compressed"))   { b = __compressed_backend__;   return true; }
+      if (!strcmp(name,"sparse"))       { b = __sparse_backend__;       return true; }
+      return false;
+   }
+}
+
+#endif // QX_BACKEND_H
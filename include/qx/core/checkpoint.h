@@ -0,0 +1,497 @@
+/**
+ * @file    checkpoint.h
+ * @brief   checkpoints of a running simulation : the state vector, the
+ *          measurements, the random stream and the position reached in
+ *          the circuits are written to a binary file every few gates, so
+ *          that a preempted run resumes from its last checkpoint
+ */
+
+#ifndef QX_CHECKPOINT_H
+#define QX_CHECKPOINT_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#include <unistd.h>
+#endif
+
+#include "qx/core/circuit.h"
+
+/**
+ * \brief gates applied between two checkpoints by default
+ */
+#define __checkpoint_default_interval__ 1000
+
+/**
+ * \brief tag and version of the checkpoint files
+ */
+#define __checkpoint_magic__   "QXCKPT"
+#define __checkpoint_version__ 1
+
+/**
+ * \brief amplitudes are streamed to and from the file by blocks of 4 MiB
+ */
+#define __checkpoint_block_bytes__ (1UL << 22)
+
+namespace qx
+{
+   /**
+    * \brief position of a checkpoint in the program : the gates of the
+    *    circuits before <circuit>, and of the iterations of <circuit>
+    *    before <iteration>, have been applied, and the first <gate> gates
+    *    of its iteration <iteration>
+    */
+   typedef struct __checkpoint_position_t
+   {
+      uint64_t circuit;
+      uint64_t iteration;
+      uint64_t gate;
+   } checkpoint_position_t;
+
+   /**
+    * \brief binary file read or written in sequence, with a running
+    *    checksum of its bytes (64-bit fnv-1a over 8-byte words, folded)
+    */
+   class checkpoint_file
+   {
+      private:
+
+         FILE *   file;
+         uint64_t sum;
+
+         void update(const void * p, size_t bytes)
+         {
+            const unsigned char * b = (const unsigned char *)p;
+            size_t                i = 0;
+            for (; i+8<=bytes; i+=8)
+            {
+               uint64_t w;
+               memcpy(&w, b+i, 8);
+               sum  = (sum ^ w) * 0x100000001b3ULL;
+               sum ^= (sum >> 32);
+            }
+            for (; i<bytes; ++i)
+               sum = (sum ^ b[i]) * 0x100000001b3ULL;
+         }
+
+      public:
+
+         checkpoint_file(const std::string& path, const char * mode) : file(fopen(path.c_str(), mode)), sum(0xcbf29ce484222325ULL)
+         {
+         }
+
+         ~checkpoint_file()
+         {
+            close();
+         }
+
+         bool is_open()
+         {
+            return (file != NULL);
+         }
+
+         bool write(const void * p, size_t bytes)
+         {
+            update(p, bytes);
+            return (fwrite(p, 1, bytes, file) == bytes);
+         }
+
+         bool read(void * p, size_t bytes)
+         {
+            if (fread(p, 1, bytes, file) != bytes)
+               return false;
+            update(p, bytes);
+            return true;
+         }
+
+         bool write(uint64_t v)
+         {
+            return write(&v, sizeof(v));
+         }
+
+         bool read(uint64_t& v)
+         {
+            return read(&v, sizeof(v));
+         }
+
+         /**
+          * \brief checksum of the bytes read or written so far
+          */
+         uint64_t checksum()
+         {
+            return sum;
+         }
+
+         /**
+          * \brief push the written bytes to the disk
+          */
+         bool sync()
+         {
+            if (fflush(file))
+               return false;
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+            return !fsync(fileno(file));
+#else
+            return true;
+#endif
+         }
+
+         bool close()
+         {
+            bool ok = true;
+            if (file)
+               ok = !fclose(file);
+            file = NULL;
+            return ok;
+         }
+   };
+
+   /**
+    * \brief fold <x> into the fingerprint <h>
+    */
+   inline uint64_t checkpoint_hash(uint64_t h, uint64_t x)
+   {
+      return (h ^ x) * 0x100000001b3ULL;
+   }
+
+   inline uint64_t checkpoint_hash(uint64_t h, const complex_t& c)
+   {
+      uint64_t re, im;
+      std::memcpy(&re, &c.re, sizeof(re));
+      std::memcpy(&im, &c.im, sizeof(im));
+      return checkpoint_hash(checkpoint_hash(h, re), im);
+   }
+
+   /**
+    * \brief fold gate <g> into the fingerprint <h> : its type, qubits and
+    *    operator (matrix, diagonal or permutation, so that the angles of
+    *    rotations and the matrices of custom and fused gates count), and
+    *    the gates and bits it wraps
+    */
+   inline uint64_t checkpoint_hash(uint64_t h, gate * g)
+   {
+      std::vector<uint64_t>  qubits = g->qubits();
+      cmatrix_t              m;
+      std::vector<complex_t> d;
+      std::vector<uint64_t>  dest;
+      h = checkpoint_hash(h, (uint64_t)g->type());
+      for (size_t q=0; q<qubits.size(); ++q)
+         h = checkpoint_hash(h, qubits[q]);
+      if (g->get_matrix(m))
+      {
+         for (size_t i=0; i<4; ++i)
+            h = checkpoint_hash(h, m.m[i]);
+      }
+      else if (g->get_diagonal(d))
+      {
+         for (size_t i=0; i<d.size(); ++i)
+            h = checkpoint_hash(h, d[i]);
+      }
+      else if (g->get_permutation(dest))
+      {
+         for (size_t i=0; i<dest.size(); ++i)
+            h = checkpoint_hash(h, dest[i]);
+      }
+      switch (g->type())
+      {
+         case __dense_unitary_gate__ :
+            {
+               const std::vector<complex_t>& u = ((dense_unitary *)g)->get_dense_matrix();
+               for (size_t i=0; i<u.size(); ++i)
+                  h = checkpoint_hash(h, u[i]);
+               break;
+            }
+         case __bin_ctrl_gate__ :
+            {
+               std::vector<size_t> bits = ((bin_ctrl *)g)->get_bits();
+               h = checkpoint_hash(h, (uint64_t)bits.size());
+               for (size_t b=0; b<bits.size(); ++b)
+                  h = checkpoint_hash(h, (uint64_t)bits[b]);
+               h = checkpoint_hash(h, ((bin_ctrl *)g)->get_gate());
+               break;
+            }
+         case __parallel_gate__ :
+            {
+               std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+               h = checkpoint_hash(h, (uint64_t)gates.size());
+               for (size_t i=0; i<gates.size(); ++i)
+                  h = checkpoint_hash(h, gates[i]);
+               break;
+            }
+         case __tiled_gates__ :
+            {
+               std::vector<gate *> gates = ((tiled_gates *)g)->get_gates();
+               h = checkpoint_hash(h, (uint64_t)gates.size());
+               for (size_t i=0; i<gates.size(); ++i)
+                  h = checkpoint_hash(h, gates[i]);
+               break;
+            }
+         default :
+            break;
+      }
+      return h;
+   }
+
+   /**
+    * \brief fingerprint of the gates of <circuits>, checked on restore so
+    *    that a checkpoint only resumes the program (and the options of
+    *    fusion, remapping...) which wrote it
+    */
+   inline uint64_t checkpoint_fingerprint(std::vector<circuit *>& circuits)
+   {
+      uint64_t h = 0xcbf29ce484222325ULL;
+      h = checkpoint_hash(h, (uint64_t)circuits.size());
+      for (size_t c=0; c<circuits.size(); ++c)
+      {
+         h = checkpoint_hash(h, (uint64_t)circuits[c]->get_iterations());
+         h = checkpoint_hash(h, (uint64_t)circuits[c]->size());
+         for (size_t i=0; i<circuits[c]->size(); ++i)
+            h = checkpoint_hash(h, circuits[c]->get(i));
+      }
+      return h;
+   }
+
+   /**
+    * \brief write the state of <reg> at position <pos> of the program of
+    *    fingerprint <fingerprint> to <path> : the file is written next to
+    *    it and renamed once complete, so that a preemption while writing
+    *    leaves the previous checkpoint in place
+    * \return false if the file can not be written
+    */
+   inline bool save_checkpoint(const std::string& path, qu_register& reg, const checkpoint_position_t& pos, uint64_t fingerprint)
+   {
+      std::string     tmp = path + ".tmp";
+      checkpoint_file f(tmp, "wb");
+      if (!f.is_open())
+         return false;
+
+      uint64_t n    = reg.size();
+      char     magic[8] = __checkpoint_magic__;
+      bool     ok   = f.write(magic, sizeof(magic));
+      ok &= f.write((uint64_t)__checkpoint_version__);
+      ok &= f.write(n);
+      ok &= f.write((uint64_t)reg.get_precision());
+      ok &= f.write(fingerprint);
+      ok &= f.write(pos.circuit);
+      ok &= f.write(pos.iteration);
+      ok &= f.write(pos.gate);
+
+      // measurements and random stream
+      std::vector<unsigned char> measurements(n), predictions(n);
+      std::vector<uint64_t>      averaging(2*n);
+      for (uint64_t q=0; q<n; ++q)
+      {
+         measurements[q]  = reg.get_measurement(q);
+         predictions[q]   = reg.get_measurement_prediction(q);
+         averaging[2*q]   = reg.measurement_averaging[q].ground_states;
+         averaging[2*q+1] = reg.measurement_averaging[q].exited_states;
+      }
+      std::string rng = reg.get_random_state();
+      ok &= f.write(measurements.data(), n);
+      ok &= f.write(predictions.data(), n);
+      ok &= f.write(averaging.data(), averaging.size()*sizeof(uint64_t));
+      ok &= f.write((uint64_t)rng.size());
+      ok &= f.write(rng.data(), rng.size());
+
+      // amplitudes
+      const char * data  = (reg.single_precision() ? (const char *)reg.get_data_f().data() : (const char *)reg.get_data().data());
+      size_t       bytes = reg.states()*(reg.single_precision() ? sizeof(complex_f_t) : sizeof(complex_t));
+      for (size_t o=0; ok && (o<bytes); o+=__checkpoint_block_bytes__)
+         ok &= f.write(data+o, std::min<size_t>(__checkpoint_block_bytes__, bytes-o));
+
+      uint64_t sum = f.checksum();
+      ok &= f.write(sum);
+      ok &= f.sync();
+      ok &= f.close();
+      if (!ok || rename(tmp.c_str(), path.c_str()))
+      {
+         remove(tmp.c_str());
+         return false;
+      }
+      return true;
+   }
+
+   /**
+    * \brief restore the state of <reg> and the position <pos> of the
+    *    program of fingerprint <fingerprint> from the checkpoint <path>
+    * \return false if the file can not be read, was written for another
+    *    register or program, or is corrupted (<reg> is then undefined)
+    */
+   inline bool load_checkpoint(const std::string& path, qu_register& reg, checkpoint_position_t& pos, uint64_t fingerprint)
+   {
+      checkpoint_file f(path, "rb");
+      if (!f.is_open())
+      {
+         println("[x] checkpoint : could not open '" << path << "'");
+         return false;
+      }
+
+      char     magic[8], expected[8] = __checkpoint_magic__;
+      uint64_t version = 0, n = 0, precision = 0, fp = 0;
+      if (!f.read(magic, sizeof(magic)) || memcmp(magic, expected, sizeof(magic)) || !f.read(version) || (version != __checkpoint_version__))
+      {
+         println("[x] checkpoint : '" << path << "' is not a checkpoint of this version");
+         return false;
+      }
+      if (!f.read(n) || !f.read(precision) || !f.read(fp) || !f.read(pos.circuit) || !f.read(pos.iteration) || !f.read(pos.gate))
+      {
+         println("[x] checkpoint : '" << path << "' is truncated");
+         return false;
+      }
+      if ((n != reg.size()) || (precision != (uint64_t)reg.get_precision()))
+      {
+         println("[x] checkpoint : '" << path << "' holds a register of " << n << " qubits in " << (precision == __single_precision__ ? "single" : "double") << " precision");
+         return false;
+      }
+      if (fp != fingerprint)
+      {
+         println("[x] checkpoint : '" << path << "' was written by another program (or other options)");
+         return false;
+      }
+
+      // measurements and random stream
+      std::vector<unsigned char> measurements(n), predictions(n);
+      std::vector<uint64_t>      averaging(2*n);
+      uint64_t                   rng_size = 0;
+      bool                       ok = f.read(measurements.data(), n);
+      ok = ok && f.read(predictions.data(), n);
+      ok = ok && f.read(averaging.data(), averaging.size()*sizeof(uint64_t));
+      ok = ok && f.read(rng_size) && (rng_size < (1UL << 20));
+      std::string rng(ok ? rng_size : 0, ' ');
+      ok = ok && f.read(&rng[0], rng.size());
+
+      // amplitudes
+      char * data  = (reg.single_precision() ? (char *)reg.get_data_f().data() : (char *)reg.get_data().data());
+      size_t bytes = reg.states()*(reg.single_precision() ? sizeof(complex_f_t) : sizeof(complex_t));
+      for (size_t o=0; ok && (o<bytes); o+=__checkpoint_block_bytes__)
+         ok = f.read(data+o, std::min<size_t>(__checkpoint_block_bytes__, bytes-o));
+
+      uint64_t sum = f.checksum(), stored = 0;
+      if (!ok || !f.read(stored) || (sum != stored) || !reg.set_random_state(rng))
+      {
+         println("[x] checkpoint : '" << path << "' is corrupted");
+         return false;
+      }
+      for (uint64_t q=0; q<n; ++q)
+      {
+         reg.set_measurement(q, (bool)measurements[q]);
+         reg.set_measurement_prediction(q, (state_t)predictions[q]);
+         reg.measurement_averaging[q].ground_states = averaging[2*q];
+         reg.measurement_averaging[q].exited_states = averaging[2*q+1];
+      }
+      return true;
+   }
+
+   /**
+    * \brief execution hook applying the gates of a program and writing a
+    *    checkpoint every <interval> gates : the gates before the restored
+    *    position are skipped
+    */
+   class checkpointer : public execution_hook
+   {
+      private:
+
+         std::string           path;
+         size_t                interval;
+         uint64_t              fingerprint;
+         checkpoint_position_t start;
+         uint64_t              circuit_index;
+         uint64_t              circuit_size;
+         uint64_t              skip;
+         uint64_t              applied;
+         size_t                pending;
+         size_t                written;
+
+      public:
+
+         /**
+          * ctor : checkpoints to <path> (none if empty or <interval> is 0)
+          *    of the program of fingerprint <fingerprint>, resumed at
+          *    <start>
+          */
+         checkpointer(const std::string& path, size_t interval, uint64_t fingerprint, const checkpoint_position_t& start) : path(path),
+                                                                                                                            interval(path.empty() ? 0 : interval),
+                                                                                                                            fingerprint(fingerprint),
+                                                                                                                            start(start),
+                                                                                                                            circuit_index(0),
+                                                                                                                            circuit_size(0),
+                                                                                                                            skip(0),
+                                                                                                                            applied(0),
+                                                                                                                            pending(0),
+                                                                                                                            written(0)
+         {
+         }
+
+         /**
+          * \brief check whether circuit <c> still has gates to apply
+          */
+         bool pending_circuit(size_t c)
+         {
+            return (c >= start.circuit);
+         }
+
+         /**
+          * \brief start circuit <c> of <size> gates per iteration
+          */
+         void enter(size_t c, size_t size)
+         {
+            circuit_index = c;
+            circuit_size  = size;
+            applied       = 0;
+            skip          = (c == start.circuit ? start.iteration*size + start.gate : 0);
+         }
+
+         void apply(gate * g, size_t step, qu_register& reg)
+         {
+            if (applied < skip)
+            {
+               applied++;
+               return;
+            }
+            g->apply(reg);
+            applied++;
+            if (interval && (++pending >= interval))
+            {
+               checkpoint_position_t pos = { circuit_index, applied / circuit_size, applied % circuit_size };
+               pending = 0;
+               if (save_checkpoint(path, reg, pos, fingerprint))
+                  written++;
+               else
+                  println("[x] checkpoint : could not write '" << path << "', simulation goes on");
+            }
+         }
+
+         /**
+          * \brief number of checkpoints written
+          */
+         size_t checkpoints()
+         {
+            return written;
+         }
+   };
+
+   /**
+    * \brief execute <circuits> on <reg> from position <start>, writing a
+    *    checkpoint to <path> every <interval> gates
+    * \return number of checkpoints written
+    */
+   inline size_t execute_checkpointed(std::vector<circuit *>& circuits, qu_register& reg, const std::string& path, size_t interval, const checkpoint_position_t& start, bool silent=false)
+   {
+      checkpointer hook(path, interval, checkpoint_fingerprint(circuits), start);
+      for (size_t c=0; c<circuits.size(); ++c)
+      {
+         if (!hook.pending_circuit(c))
+            continue;
+         hook.enter(c, circuits[c]->size());
+         circuits[c]->execute(reg, hook, silent);
+      }
+      return hook.checkpoints();
+   }
+}
+
+#endif // QX_CHECKPOINT_H
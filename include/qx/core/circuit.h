@@ -12,6 +12,8 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <algorithm>
+#include <set>
 
 #define println(x) std::cout << x << std::endl
 #define print(x) std::cout << x 
@@ -29,6 +31,29 @@
 
 namespace qx
 {
+   /**
+    * \brief execution hook : applies the gates of a circuit on behalf of
+    *    circuit::execute(), e.g. to act on the register around each gate
+    *    (noise) without building a modified circuit
+    */
+   class execution_hook
+   {
+      public:
+
+         virtual ~execution_hook() { }
+
+         /**
+          * \brief apply gate <g>, found at <step> of the circuit, to <reg>
+          */
+         virtual void apply(gate * g, size_t step, qu_register& reg) = 0;
+   };
+
+   /**
+    * \brief gates looked ahead by the dynamic qubit remapping
+    *    (see circuit::remap())
+    */
+   #define __remap_window__ 128
+
    class circuit
    {
       private:
@@ -39,6 +64,424 @@ namespace qx
          size_t              iteration;
          double              time;
 
+         /**
+          * \brief parallel gates are applied one after the other, so
+          *    their gates can be inlined in the circuit for fusion
+          */
+         void flatten(gate * g, std::vector<gate *>& flat)
+         {
+            if (g->type() != __parallel_gate__)
+            {
+               flat.push_back(g);
+               return;
+            }
+            std::vector<gate *> pg = ((parallel_gates *)g)->get_gates();
+            for (size_t i=0; i<pg.size(); ++i)
+               flatten(pg[i],flat);
+            delete g;
+         }
+
+         /**
+          * \brief gates which can not be moved across single-qubit gates
+          *    on any qubit
+          */
+         bool is_fusion_barrier(gate * g)
+         {
+            switch (g->type())
+            {
+               case __measure_gate__:
+               case __measure_reg_gate__:
+               case __measure_x_gate__:
+               case __measure_x_reg_gate__:
+               case __measure_y_gate__:
+               case __measure_y_reg_gate__:
+               case __bin_ctrl_gate__:
+               case __display__:
+               case __display_binary__:
+               case __print_str__:
+               case __prepare_gate__:
+                  return true;
+               default:
+                  return g->qubits().empty();
+            }
+         }
+
+         /**
+          * \brief unitary gates may only precede the measurements, which
+          *    set <measured>; any other operation prevents sampling
+          */
+         bool is_sampleable(gate * g, bool& measured)
+         {
+            switch (g->type())
+            {
+               case __parallel_gate__:
+               {
+                  std::vector<gate *> pg = ((parallel_gates *)g)->get_gates();
+                  for (size_t i=0; i<pg.size(); ++i)
+                     if (!is_sampleable(pg[i],measured))
+                        return false;
+                  return true;
+               }
+               case __measure_gate__:
+               case __measure_reg_gate__:
+                  measured = true;
+                  return true;
+               case __display__:
+               case __display_binary__:
+               case __print_str__:
+                  return true;
+               case __prepx_gate__:
+               case __prepy_gate__:
+               case __prepz_gate__:
+               case __measure_x_gate__:
+               case __measure_x_reg_gate__:
+               case __measure_y_gate__:
+               case __measure_y_reg_gate__:
+               case __bin_ctrl_gate__:
+               case __lookup_table__:
+               case __classical_not_gate__:
+               case __prepare_gate__:
+                  return false;
+               default:
+                  return !measured;
+            }
+         }
+
+         /**
+          * \brief replace the pending run of single-qubit gates on
+          *    qubit <q> by one gate
+          * \return number of gates removed
+          */
+         size_t flush(std::vector<gate *>& run, size_t q)
+         {
+            size_t removed = 0;
+            if (run.size() == 1)
+               gates.push_back(run[0]);
+            else if (run.size() > 1)
+            {
+               cmatrix_t m = build_matrix(identity_c,2);
+               for (size_t i=0; i<run.size(); ++i)
+               {
+                  cmatrix_t gm;
+                  run[i]->get_matrix(gm);
+                  m = mxm(gm,m);
+                  delete run[i];
+               }
+               gates.push_back(new custom(q,m));
+               removed = run.size()-1;
+            }
+            run.clear();
+            return removed;
+         }
+
+         /**
+          * \brief replace a cluster of gates by the dense unitary
+          *    acting on their (sorted) qubits <window>
+          * \return number of gates removed
+          */
+         size_t flush_cluster(std::vector<gate *>& cluster, std::vector<uint64_t>& window)
+         {
+            size_t removed = 0;
+            if ((window.size() < 2) || (cluster_cost(cluster) <= dense_cost(window.size())))
+            {
+               // not worth a dense product : keep the gates
+               for (size_t i=0; i<cluster.size(); ++i)
+                  gates.push_back(cluster[i]);
+            }
+            else
+            {
+               size_t dim = (1UL << window.size());
+               std::vector<complex_t> u(dim*dim, complex_t(0.0,0.0));
+               for (size_t i=0; i<dim; ++i)
+                  u[i*dim+i] = complex_t(1.0,0.0);
+
+               for (size_t i=0; i<cluster.size(); ++i)
+               {
+                  cmatrix_t m;
+                  cluster[i]->get_matrix(m);
+                  std::vector<uint64_t> ctrl = cluster[i]->control_qubits();
+                  uint64_t cmask = 0;
+                  for (size_t c=0; c<ctrl.size(); ++c)
+                     cmask |= (1UL << local_qubit(window,ctrl[c]));
+                  uint64_t tmask = (1UL << local_qubit(window,cluster[i]->target_qubits()[0]));
+
+                  // left-multiply u by the controlled 2x2 gate
+                  for (size_t r=0; r<dim; ++r)
+                  {
+                     if ((r & tmask) || ((r & cmask) != cmask))
+                        continue;
+                     for (size_t c=0; c<dim; ++c)
+                     {
+                        complex_t a = u[r*dim+c];
+                        complex_t b = u[(r|tmask)*dim+c];
+                        u[r*dim+c]         = m(0,0)*a + m(0,1)*b;
+                        u[(r|tmask)*dim+c] = m(1,0)*a + m(1,1)*b;
+                     }
+                  }
+                  delete cluster[i];
+               }
+               gates.push_back(new dense_unitary(window,u));
+               removed = cluster.size()-1;
+            }
+            cluster.clear();
+            window.clear();
+            return removed;
+         }
+
+         /**
+          * \brief replace a group of diagonal gates by a single diagonal
+          *    unitary on their (sorted) qubits <window>. a diagonal gate
+          *    only visits the amplitudes it changes (half of the state or
+          *    less), so that fusing pays off from three gates on.
+          * \return number of gates removed
+          */
+         size_t flush_diagonal(std::vector<gate *>& group, std::vector<uint64_t>& window)
+         {
+            size_t removed = 0;
+            if (group.size() < 3)
+            {
+               for (size_t i=0; i<group.size(); ++i)
+                  gates.push_back(group[i]);
+            }
+            else
+            {
+               size_t dim = (1UL << window.size());
+               std::vector<complex_t> d(dim, complex_t(1.0,0.0));
+               for (size_t i=0; i<group.size(); ++i)
+               {
+                  cmatrix_t m;
+                  group[i]->get_matrix(m);
+                  std::vector<uint64_t> ctrl = group[i]->control_qubits();
+                  uint64_t cmask = 0;
+                  for (size_t c=0; c<ctrl.size(); ++c)
+                     cmask |= (1UL << local_qubit(window,ctrl[c]));
+                  uint64_t tmask = (1UL << local_qubit(window,group[i]->target_qubits()[0]));
+                  for (size_t j=0; j<dim; ++j)
+                     if ((j & cmask) == cmask)
+                        d[j] *= ((j & tmask) ? m(1,1) : m(0,0));
+                  delete group[i];
+               }
+               gates.push_back(new diagonal_unitary(window,d));
+               removed = group.size()-1;
+            }
+            group.clear();
+            window.clear();
+            return removed;
+         }
+
+         /**
+          * \brief replace a group of swaps (and qubit permutations) by the
+          *    single permutation of their (sorted) qubits <window>, or by
+          *    nothing when they cancel out
+          * \return number of gates removed
+          */
+         size_t flush_permutation(std::vector<gate *>& group, std::vector<uint64_t>& window)
+         {
+            size_t removed = 0;
+            if (group.size() < 2)
+            {
+               for (size_t i=0; i<group.size(); ++i)
+                  gates.push_back(group[i]);
+            }
+            else
+            {
+               // where[k] : qubit holding the state of window[k]
+               std::vector<uint64_t> where = window;
+               for (size_t i=0; i<group.size(); ++i)
+               {
+                  std::vector<uint64_t> src = group[i]->qubits();
+                  std::vector<uint64_t> dst;
+                  group[i]->get_permutation(dst);
+                  for (size_t k=0; k<where.size(); ++k)
+                  {
+                     size_t j = std::find(src.begin(),src.end(),where[k]) - src.begin();
+                     if (j < src.size())
+                        where[k] = dst[j];
+                  }
+                  delete group[i];
+               }
+               removed = group.size();
+               if (where != window)
+               {
+                  gates.push_back(new qubit_permutation(window,where));
+                  removed--;
+               }
+            }
+            group.clear();
+            window.clear();
+            return removed;
+         }
+
+         /**
+          * \brief replace a group of gates on the low qubits by a
+          *    tiled_gates applying them block by block
+          * \return 1 if a tiled group was created
+          */
+         size_t flush_tile(std::vector<gate *>& group)
+         {
+            size_t tiled = 0;
+            if (group.size() < 2)
+            {
+               for (size_t i=0; i<group.size(); ++i)
+                  gates.push_back(group[i]);
+            }
+            else
+            {
+               gates.push_back(new tiled_gates(group));
+               tiled = 1;
+            }
+            group.clear();
+            return tiled;
+         }
+
+         /**
+          * \brief gate <g> with each of its logical qubits q moved to the
+          *    physical qubit phys[q] (<g> itself when none of them moves)
+          */
+         gate * relabel(gate * g, std::vector<uint64_t>& phys)
+         {
+            std::vector<uint64_t> qubits = g->qubits();
+            bool                  moved  = false;
+            for (size_t k=0; k<qubits.size(); ++k)
+               moved |= (phys[qubits[k]] != qubits[k]);
+            if (!moved)
+               return g;
+            gate * r = relocate(g,phys);
+            delete g;
+            return r;
+         }
+
+         /**
+          * \brief swap the physical qubits <a> and <b>, and the logical
+          *    qubits they hold
+          */
+         void move(uint64_t a, uint64_t b, std::vector<uint64_t>& phys, std::vector<uint64_t>& logical)
+         {
+            uint64_t la = logical[a];
+            uint64_t lb = logical[b];
+            gates.push_back(new qx::swap(a,b));
+            logical[a] = lb;
+            logical[b] = la;
+            phys[la]   = b;
+            phys[lb]   = a;
+         }
+
+         /**
+          * \brief bring every logical qubit back to its physical qubit
+          * \return number of swaps
+          */
+         size_t unmap(std::vector<uint64_t>& phys, std::vector<uint64_t>& logical)
+         {
+            size_t swaps = 0;
+            for (uint64_t p=0; p<phys.size(); ++p)
+               if (logical[p] != p)
+               {
+                  move(p,phys[p],phys,logical);
+                  swaps++;
+               }
+            return swaps;
+         }
+
+         /**
+          * \brief move the logical qubits used by the gates of <flat> from
+          *    <i> on (up to __remap_window__ gates, or to the next gate which
+          *    can not be relabeled) from the high physical qubits to the low
+          *    ones left unused by these gates, the most used first, when it
+          *    brings more gates below __tile_qubits__ than passes it costs :
+          *    disjoint swaps are merged 5 by 5 into permutations, each about
+          *    a pass over the state vector, and are undone later on.
+          * \return number of swaps
+          */
+         size_t localize(std::vector<gate *>& flat, size_t i, std::vector<uint64_t>& phys, std::vector<uint64_t>& logical)
+         {
+            std::vector<size_t> uses(n_qubit, 0);
+            size_t              end = i;
+            for (; (end < flat.size()) && (end < i+__remap_window__); ++end)
+            {
+               if (is_fusion_barrier(flat[end]) || !is_relocatable(flat[end]))
+                  break;
+               std::vector<uint64_t> qubits = flat[end]->qubits();
+               for (size_t k=0; k<qubits.size(); ++k)
+                  uses[qubits[k]]++;
+            }
+
+            std::vector<uint64_t> in, out;
+            for (uint64_t q=0; q<n_qubit; ++q)
+               if ((phys[q] >= __tile_qubits__) && uses[q])
+                  in.push_back(q);
+            for (uint64_t p=0; p<__tile_qubits__; ++p)
+               if (!uses[logical[p]])
+                  out.push_back(p);
+            for (size_t a=1; a<in.size(); ++a)
+               for (size_t b=a; (b > 0) && (uses[in[b]] > uses[in[b-1]]); --b)
+                  std::swap(in[b],in[b-1]);
+            size_t k = std::min(in.size(),out.size());
+            if (!k)
+               return 0;
+
+            // gates of the window entirely below the tile boundary before and after
+            std::vector<uint64_t> after = phys;
+            for (size_t j=0; j<k; ++j)
+               after[in[j]] = out[j];
+            int64_t gain = 0;
+            for (size_t j=i; j<end; ++j)
+            {
+               std::vector<uint64_t> qubits = flat[j]->qubits();
+               bool                  before = true, low = true;
+               for (size_t q=0; q<qubits.size(); ++q)
+               {
+                  before &= (phys[qubits[q]] < __tile_qubits__);
+                  low    &= (after[qubits[q]] < __tile_qubits__);
+               }
+               gain += (int64_t)low - (int64_t)before;
+            }
+            if (gain <= 2*(int64_t)((k+4)/5))
+               return 0;
+
+            for (size_t j=0; j<k; ++j)
+               move(phys[in[j]],out[j],phys,logical);
+            return k;
+         }
+
+         /**
+          * \brief cost of a cluster in single-qubit gate sweeps, once
+          *    the runs of single-qubit gates have been merged by fuse()
+          */
+         double cluster_cost(std::vector<gate *>& cluster)
+         {
+            double             cost = 0;
+            std::set<uint64_t> pending;   // qubits ending with a single-qubit gate
+            for (size_t i=0; i<cluster.size(); ++i)
+            {
+               std::vector<uint64_t> qubits = cluster[i]->qubits();
+               if (qubits.size() == 1)
+               {
+                  if (pending.insert(qubits[0]).second)
+                     cost += 1;
+                  continue;
+               }
+               for (size_t k=0; k<qubits.size(); ++k)
+                  pending.erase(qubits[k]);
+               cost += 0.5;  // only touches the controlled half
+            }
+            return cost;
+         }
+
+         /**
+          * \brief measured cost of the dense kernel on k qubits in
+          *    single-qubit gate sweeps
+          */
+         double dense_cost(size_t k)
+         {
+            static const double cost[__dense_max_qubits__+1] = { 0, 1, 2, 2.5, 4, 6 };
+            return cost[k];
+         }
+
+         size_t local_qubit(std::vector<uint64_t>& window, uint64_t q)
+         {
+            return std::find(window.begin(),window.end(),q) - window.begin();
+         }
+
       public:
 
          /**
@@ -159,6 +602,411 @@ namespace qx
 #endif // XPU_TIMER
          }
 
+         /**
+          * \brief execute the circuit on <reg>, each gate being applied
+          *    through <hook>
+          */
+         void execute(qu_register& reg, execution_hook& hook, bool silent=false)
+         {
+            size_t it = iteration;
+
+#ifdef XPU_TIMER
+            xpu::timer tmr;
+            if (!silent)
+            {
+               println("[+] executing circuit '" << name << "' (" << it << " iter) ...");
+               tmr.start();
+            }
+#endif
+            while (it--)
+               for (size_t i=0; i<gates.size(); ++i)
+                  hook.apply(gates[i],i,reg);
+#ifdef XPU_TIMER
+            if (!silent)
+            {
+               tmr.stop();
+               println("[+] circuit execution time: " << tmr.elapsed() << " sec.");
+            }
+#endif // XPU_TIMER
+         }
+
+         /**
+          * \brief check whether the circuit only contains unitary gates
+          *    followed by measurements in the computational basis, so that
+          *    shots can be drawn from a single simulation. <measured> is
+          *    carried across the circuits of a program.
+          */
+         bool terminal_measurements_only(bool& measured)
+         {
+            bool m = measured;
+            for (size_t i=0; i<gates.size(); ++i)
+               if (!is_sampleable(gates[i],measured))
+                  return false;
+            // a repeated circuit would measure in the middle
+            return ((iteration < 2) || (m == measured));
+         }
+
+         /**
+          * \brief remove the measurements in the computational basis
+          * \return number of gates removed
+          */
+         size_t remove_measurements()
+         {
+            std::vector<gate *> flat;
+            for (size_t i=0; i<gates.size(); ++i)
+               flatten(gates[i],flat);
+            gates.clear();
+            for (size_t i=0; i<flat.size(); ++i)
+            {
+               gate_type_t t = flat[i]->type();
+               if ((t == __measure_gate__) || (t == __measure_reg_gate__))
+                  delete flat[i];
+               else
+                  gates.push_back(flat[i]);
+            }
+            return flat.size()-gates.size();
+         }
+
+         /**
+          * \brief fuse the runs of single-qubit gates acting on the same
+          *    qubit into a single custom 2x2 gate. a run extends across
+          *    the gates acting on other qubits; measurements, binary-controlled
+          *    gates and displays end all the runs.
+          * \return number of gates removed from the circuit
+          */
+         size_t fuse()
+         {
+            std::vector<gate *>                flat;
+            std::vector<std::vector<gate *> >  runs(n_qubit);
+            size_t                             removed = 0;
+
+            for (size_t i=0; i<gates.size(); ++i)
+               flatten(gates[i],flat);
+            gates.clear();
+
+            for (size_t i=0; i<flat.size(); ++i)
+            {
+               gate *    g = flat[i];
+               cmatrix_t m;
+               if (is_fusion_barrier(g))
+               {
+                  for (size_t q=0; q<n_qubit; ++q)
+                     removed += flush(runs[q],q);
+                  gates.push_back(g);
+                  continue;
+               }
+               std::vector<uint64_t> qubits = g->qubits();
+               if ((qubits.size() == 1) && g->get_matrix(m))
+               {
+                  runs[qubits[0]].push_back(g);
+                  continue;
+               }
+               for (size_t k=0; k<qubits.size(); ++k)
+                  removed += flush(runs[qubits[k]],qubits[k]);
+               gates.push_back(g);
+            }
+            for (size_t q=0; q<n_qubit; ++q)
+               removed += flush(runs[q],q);
+
+            removed += fuse_diagonal();
+            return removed + fuse_permutation();
+         }
+
+         /**
+          * \brief fuse consecutive diagonal gates (z, s, t, rz, cphase,
+          *    controlled phases...) acting on up to 10 qubits into a single
+          *    diagonal unitary. the diagonal gates commute, and a group
+          *    extends across the other gates as long as they act on other
+          *    qubits; measurements, binary-controlled gates and displays
+          *    end it.
+          * \return number of gates removed from the circuit
+          */
+         size_t fuse_diagonal()
+         {
+            std::vector<gate *>    flat;
+            std::vector<gate *>    group;
+            std::vector<uint64_t>  window;
+            size_t                 removed = 0;
+
+            for (size_t i=0; i<gates.size(); ++i)
+               flatten(gates[i],flat);
+            gates.clear();
+
+            for (size_t i=0; i<flat.size(); ++i)
+            {
+               gate *    g = flat[i];
+               cmatrix_t m;
+               if (is_fusion_barrier(g))
+               {
+                  removed += flush_diagonal(group,window);
+                  gates.push_back(g);
+                  continue;
+               }
+               std::vector<uint64_t> qubits = g->qubits();
+               if (g->is_diagonal() && (g->target_qubits().size() == 1) && g->get_matrix(m))
+               {
+                  std::vector<uint64_t> w = window;
+                  for (size_t k=0; k<qubits.size(); ++k)
+                     if (std::find(w.begin(),w.end(),qubits[k]) == w.end())
+                        w.push_back(qubits[k]);
+                  if (w.size() > __diagonal_max_qubits__)
+                  {
+                     removed += flush_diagonal(group,window);
+                     w = qubits;
+                  }
+                  std::sort(w.begin(),w.end());
+                  window = w;
+                  group.push_back(g);
+                  continue;
+               }
+               // a gate on other qubits commutes with the pending group
+               for (size_t k=0; k<qubits.size(); ++k)
+                  if (std::find(window.begin(),window.end(),qubits[k]) != window.end())
+                  {
+                     removed += flush_diagonal(group,window);
+                     break;
+                  }
+               gates.push_back(g);
+            }
+            removed += flush_diagonal(group,window);
+
+            return removed;
+         }
+
+         /**
+          * \brief fuse consecutive swaps acting on up to 10 qubits into a
+          *    single qubit permutation, which moves each amplitude at most
+          *    once instead of once per swap. a group extends across the
+          *    gates acting on other qubits; measurements, binary-controlled
+          *    gates and displays end it.
+          * \return number of gates removed from the circuit
+          */
+         size_t fuse_permutation()
+         {
+            std::vector<gate *>    flat;
+            std::vector<gate *>    group;
+            std::vector<uint64_t>  window;
+            size_t                 removed = 0;
+
+            for (size_t i=0; i<gates.size(); ++i)
+               flatten(gates[i],flat);
+            gates.clear();
+
+            for (size_t i=0; i<flat.size(); ++i)
+            {
+               gate *                g = flat[i];
+               std::vector<uint64_t> dest;
+               if (is_fusion_barrier(g))
+               {
+                  removed += flush_permutation(group,window);
+                  gates.push_back(g);
+                  continue;
+               }
+               std::vector<uint64_t> qubits = g->qubits();
+               if (g->get_permutation(dest))
+               {
+                  std::vector<uint64_t> w = window;
+                  for (size_t k=0; k<qubits.size(); ++k)
+                     if (std::find(w.begin(),w.end(),qubits[k]) == w.end())
+                        w.push_back(qubits[k]);
+                  if (w.size() > __permutation_max_qubits__)
+                  {
+                     removed += flush_permutation(group,window);
+                     w = qubits;
+                  }
+                  std::sort(w.begin(),w.end());
+                  window = w;
+                  group.push_back(g);
+                  continue;
+               }
+               // a gate on other qubits commutes with the pending group
+               for (size_t k=0; k<qubits.size(); ++k)
+                  if (std::find(window.begin(),window.end(),qubits[k]) != window.end())
+                  {
+                     removed += flush_permutation(group,window);
+                     break;
+                  }
+               gates.push_back(g);
+            }
+            removed += flush_permutation(group,window);
+
+            return removed;
+         }
+
+         /**
+          * \brief dynamic qubit remapping : the gates are rewritten on
+          *    physical qubits, and when the upcoming gates act on high
+          *    qubits, their logical qubits are swapped in bulk with unused
+          *    low ones (see localize()), so that tile() can apply these
+          *    gates block by block in the cache. the logical qubits are
+          *    swapped back before the measurements, displays, binary-controlled
+          *    gates and gates which can not be relabeled, and at the end of
+          *    the circuit, so that the outcomes and the final state are
+          *    those of the original circuit. runs after the fusion passes,
+          *    on registers of more than 14 qubits.
+          * \return number of swaps inserted
+          */
+         size_t remap()
+         {
+            std::vector<gate *>   flat;
+            std::vector<uint64_t> phys(n_qubit);
+            std::vector<uint64_t> logical(n_qubit);
+            size_t                swaps = 0;
+
+            if (n_qubit <= __tile_qubits__)
+               return 0;
+            for (uint64_t q=0; q<n_qubit; ++q)
+               phys[q] = logical[q] = q;
+
+            for (size_t i=0; i<gates.size(); ++i)
+               flatten(gates[i],flat);
+            gates.clear();
+
+            for (size_t i=0; i<flat.size(); ++i)
+            {
+               gate * g = flat[i];
+               if (is_fusion_barrier(g) || !is_relocatable(g))
+               {
+                  swaps += unmap(phys,logical);
+                  gates.push_back(g);
+                  continue;
+               }
+               std::vector<uint64_t> qubits = g->qubits();
+               for (size_t k=0; k<qubits.size(); ++k)
+                  if (phys[qubits[k]] >= __tile_qubits__)
+                  {
+                     swaps += localize(flat,i,phys,logical);
+                     break;
+                  }
+               gates.push_back(relabel(g,phys));
+            }
+            swaps += unmap(phys,logical);
+
+            if (swaps)
+               fuse_permutation();
+            return swaps;
+         }
+
+         /**
+          * \brief group the consecutive gates acting on the qubits below
+          *    __tile_qubits__ (14) into tiled_gates, so that they cost a
+          *    single pass over the state vector instead of one pass each.
+          *    a group extends across the gates acting on the qubits above
+          *    (with which it commutes); gates on both sides, measurements,
+          *    binary-controlled gates and displays end it. runs after the
+          *    fusion passes, on registers of more than 14 qubits.
+          * \return number of tiled groups
+          */
+         size_t tile()
+         {
+            std::vector<gate *>  flat;
+            std::vector<gate *>  group;
+            size_t               tiled = 0;
+
+            if (n_qubit <= __tile_qubits__)
+               return 0;
+
+            for (size_t i=0; i<gates.size(); ++i)
+               flatten(gates[i],flat);
+            gates.clear();
+
+            for (size_t i=0; i<flat.size(); ++i)
+            {
+               gate * g = flat[i];
+               if (is_fusion_barrier(g))
+               {
+                  tiled += flush_tile(group);
+                  gates.push_back(g);
+                  continue;
+               }
+               if (tiled_gates::supports(g))
+               {
+                  group.push_back(g);
+                  continue;
+               }
+               std::vector<uint64_t> qubits = g->qubits();
+               for (size_t k=0; k<qubits.size(); ++k)
+                  if (qubits[k] < __tile_qubits__)
+                  {
+                     tiled += flush_tile(group);
+                     break;
+                  }
+               gates.push_back(g);
+            }
+            tiled += flush_tile(group);
+
+            return tiled;
+         }
+
+         /**
+          * \brief number of gates left out of the tiled groups by tile(),
+          *    each of which makes its own pass over the whole state vector :
+          *    measurements, displays, binary-controlled gates and the gates
+          *    which remap() could not move to the low qubits. the swaps
+          *    inserted by remap() are not counted.
+          */
+         size_t ungrouped()
+         {
+            size_t n = 0;
+            for (size_t i=0; i<gates.size(); ++i)
+            {
+               gate_type_t gt = gates[i]->type();
+               if ((gt != __tiled_gates__) && (gt != __swap_gate__) && (gt != __permutation_gate__))
+                  n++;
+            }
+            return n;
+         }
+
+         /**
+          * \brief fuse consecutive gates acting on a window of at most
+          *    <max_qubits> qubits (<= 5) into dense unitaries. single-qubit
+          *    and controlled single-target gates (cnot, toffoli, cphase,
+          *    ctrl_phase_shift, rotations...) are clustered greedily; any
+          *    other gate closes the current cluster.
+          * \return number of gates removed from the circuit
+          */
+         size_t fuse_dense(size_t max_qubits=__dense_max_qubits__)
+         {
+            std::vector<gate *>    flat;
+            std::vector<gate *>    cluster;
+            std::vector<uint64_t>  window;
+            size_t                 removed = 0;
+
+            max_qubits = std::min<size_t>(max_qubits, __dense_max_qubits__);
+            for (size_t i=0; i<gates.size(); ++i)
+               flatten(gates[i],flat);
+            gates.clear();
+
+            for (size_t i=0; i<flat.size(); ++i)
+            {
+               gate *    g = flat[i];
+               cmatrix_t m;
+               std::vector<uint64_t> qubits = g->qubits();
+               if (is_fusion_barrier(g) || (qubits.size() > max_qubits) || (g->target_qubits().size() != 1) || !g->get_matrix(m))
+               {
+                  removed += flush_cluster(cluster,window);
+                  gates.push_back(g);
+                  continue;
+               }
+               std::vector<uint64_t> w = window;
+               for (size_t k=0; k<qubits.size(); ++k)
+                  if (std::find(w.begin(),w.end(),qubits[k]) == w.end())
+                     w.push_back(qubits[k]);
+               if (w.size() > max_qubits)
+               {
+                  removed += flush_cluster(cluster,window);
+                  w = qubits;
+               }
+               std::sort(w.begin(),w.end());
+               window = w;
+               cluster.push_back(g);
+            }
+            removed += flush_cluster(cluster,window);
+
+            // merge what is left of the single-qubit runs
+            return removed + fuse();
+         }
+
          /**
           * \return gates count
           */
@@ -0,0 +1,821 @@
+/**
+ * @file    compressed.h
+ * @brief   compressed state vector : the amplitudes are stored in chunks
+ *          which are kept empty, sparse, palette-coded or dense depending
+ *          on their support and on how many distinct values they hold, so
+ *          that large registers in structured states (basis states,
+ *          arithmetic, oracles, uniform superpositions, states with few
+ *          non-zero or few distinct amplitudes per chunk) fit in memory
+ */
+
+#ifndef QX_COMPRESSED_H
+#define QX_COMPRESSED_H
+
+#include <vector>
+#include <string>
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "qx/core/circuit.h"
+
+namespace qx
+{
+   /**
+    * \brief qubits covered by a chunk : 2^16 amplitudes (1 MiB) are
+    *    decompressed at a time, up to 36 qubits
+    */
+   #define __compressed_chunk_qubits__ 16
+
+   /**
+    * \brief at most 2^20 chunks : the chunks of larger registers cover
+    *    more qubits, to bound the memory of the empty ones
+    */
+   #define __compressed_max_chunks_qubits__ 20
+
+   /**
+    * \brief default weight |a|^2 below which an amplitude of a sparse
+    *    chunk is dropped : far below the rounding of the amplitudes of
+    *    a normalized state, so that the compression is lossless but for
+    *    the residues of cancellations
+    */
+   #define __compressed_default_tolerance__ 1e-30
+
+   /**
+    * \brief most distinct amplitudes of a palette-coded chunk : the
+    *    amplitudes of structured states take a few values (uniform
+    *    superpositions, phase oracles), generic chunks are given up on
+    *    after a few thousand amplitudes
+    */
+   #define __compressed_max_palette__ 4096
+
+   /**
+    * \brief largest register whose amplitudes are listed by get_state()
+    */
+   #define __compressed_state_max_qubits__ 16
+
+   /**
+    * \brief chunk of 2^__compressed_chunk_qubits__ amplitudes : all zero
+    *    when it has no values, sparse (offsets of the non-zero amplitudes
+    *    in the chunk and their values) when it has offsets, dense when it
+    *    has a value per amplitude, palette-coded otherwise (the distinct
+    *    amplitudes in <values>, and the index of each amplitude in
+    *    <codes>, on 0, 1 or 2 bytes, see code_bytes())
+    */
+   typedef struct __chunk_t
+   {
+      std::vector<uint32_t>  offsets;
+      std::vector<complex_t> values;
+      std::vector<uint8_t>   codes;
+   } chunk_t;
+
+   /**
+    * \brief compressed state-vector register : each gate decompresses the
+    *    chunks it mixes, 2^k at a time for a gate on k qubits above the
+    *    chunk, into a small state vector on which it runs with the usual
+    *    kernels (relocated to the chunk qubits, see relocate()), then
+    *    compresses them back. groups of chunks that are all zero are
+    *    skipped, so the cost follows the support of the state. a chunk
+    *    holding few distinct amplitudes is palette-coded, losslessly ; a
+    *    chunk becomes sparse when at most half of its amplitudes are
+    *    non-zero, dropping those whose weight is below the tolerance : the
+    *    sum of the square roots of the weights dropped by each gate bounds
+    *    the distance between the simulated and the exact states (before
+    *    the renormalizations of the measurements). the measurement
+    *    register and averaging follow qu_register.
+    */
+   class compressed_register
+   {
+      private:
+
+         size_t                                 n_qubits;
+         size_t                                 chunk_qubits;
+         double                                 tolerance;
+         std::vector<chunk_t>                   chunks;
+         std::vector<qu_register *>             scratch;
+         std::vector<int32_t>                   slots;     // hash table of the palette
+         std::vector<uint16_t>                  index;     // palette index of each amplitude
+         double                                 error;
+         size_t                                 peak;
+         std::default_random_engine             rgenerator;
+         std::uniform_real_distribution<double> udistribution;
+
+         size_t chunk_size()
+         {
+            return (1UL << chunk_qubits);
+         }
+
+         /**
+          * \brief state vector of chunk_qubits+k qubits holding 2^k chunks
+          */
+         qu_register& buffer(size_t k)
+         {
+            if (scratch.size() <= k)
+               scratch.resize(k+1, NULL);
+            if (!scratch[k])
+               scratch[k] = new qu_register(chunk_qubits+k);
+            return *scratch[k];
+         }
+
+         /**
+          * \brief bytes of the palette index of each amplitude of a chunk
+          *    coded with <distinct> values
+          */
+         static size_t code_bytes(size_t distinct)
+         {
+            return (distinct == 1 ? 0 : (distinct <= 256 ? 1 : 2));
+         }
+
+         /**
+          * \brief whether chunk <c> is palette-coded
+          */
+         bool coded(const chunk_t& c)
+         {
+            return c.offsets.empty() && !c.values.empty() && (c.values.size() < chunk_size());
+         }
+
+         /**
+          * \brief palette index of amplitude <i> of the coded chunk <c>
+          */
+         static size_t code(const chunk_t& c, size_t i)
+         {
+            switch (code_bytes(c.values.size()))
+            {
+               case 0  : return 0;
+               case 1  : return c.codes[i];
+               default : return c.codes[2*i] | (c.codes[2*i+1] << 8);
+            }
+         }
+
+         /**
+          * \brief distinct amplitudes of <src> into <values>, and the index
+          *    of each amplitude in them into the member <index> :
+          *    amplitudes are compared bit for bit, so the coding is lossless
+          * \return false, with <values> left empty, when there are more
+          *    than __compressed_max_palette__ distinct amplitudes
+          */
+         bool palette(complex_t * src, std::vector<complex_t>& values)
+         {
+            size_t len  = chunk_size();
+            size_t mask = 2*__compressed_max_palette__-1;
+            slots.assign(2*__compressed_max_palette__, -1);
+            index.resize(len);
+            values.clear();
+            for (size_t i=0; i<len; ++i)
+            {
+               uint64_t re, im;
+               std::memcpy(&re, &src[i].re, sizeof(re));
+               std::memcpy(&im, &src[i].im, sizeof(im));
+               size_t h = ((re*0x9E3779B97F4A7C15ULL) ^ (im*0xC2B2AE3D27D4EB4FULL)) >> 40;
+               for (;; h++)
+               {
+                  int32_t& slot = slots[h & mask];
+                  if (slot < 0)
+                  {
+                     if (values.size() == __compressed_max_palette__)
+                     {
+                        values.clear();
+                        return false;
+                     }
+                     slot = values.size();
+                     values.push_back(src[i]);
+                     break;
+                  }
+                  if (!std::memcmp(&values[slot], &src[i], sizeof(complex_t)))
+                     break;
+               }
+               index[i] = slots[h & mask];
+            }
+            return true;
+         }
+
+         /**
+          * \brief amplitudes of chunk <c> into <dst>
+          */
+         void decompress(chunk_t& c, complex_t * dst)
+         {
+            size_t len = chunk_size();
+            if (!c.offsets.empty() || c.values.empty())
+            {
+               std::fill(dst, dst+len, complex_t(0,0));
+               for (size_t i=0; i<c.offsets.size(); ++i)
+                  dst[c.offsets[i]] = c.values[i];
+            }
+            else if (coded(c))
+            {
+               for (size_t i=0; i<len; ++i)
+                  dst[i] = c.values[code(c,i)];
+            }
+            else
+               std::copy(c.values.begin(), c.values.end(), dst);
+         }
+
+         /**
+          * \brief store the amplitudes <src> in chunk <c> : palette-coded
+          *    when they take few distinct values and that is smaller than
+          *    the sparse chunk, else sparse when at most half of them are
+          *    above the tolerance, else dense
+          * \return weight of the dropped amplitudes
+          */
+         double compress(chunk_t& c, complex_t * src)
+         {
+            size_t len     = chunk_size();
+            size_t kept    = 0;
+            double dropped = 0;
+            for (size_t i=0; i<len; ++i)
+            {
+               double w = src[i].norm();
+               if (w > tolerance)
+                  kept++;
+               else
+                  dropped += w;
+            }
+            std::vector<uint32_t>  offsets;
+            std::vector<complex_t> values;
+            std::vector<uint8_t>   codes;
+            size_t                 sparse_bytes = kept*(sizeof(uint32_t)+sizeof(complex_t));
+            bool                   palette_coded = false;
+            // a palette of two values or more takes a byte per amplitude
+            if (((kept > len/2) || (sparse_bytes > len)) && palette(src, values))
+            {
+               size_t w = code_bytes(values.size());
+               if ((values.size() < len) && ((kept > len/2) || (values.size()*sizeof(complex_t)+len*w < sparse_bytes)))
+               {
+                  codes.resize(len*w);
+                  for (size_t i=0; (w == 1) && (i<len); ++i)
+                     codes[i] = index[i];
+                  for (size_t i=0; (w == 2) && (i<len); ++i)
+                  {
+                     codes[2*i]   = index[i] & 0xff;
+                     codes[2*i+1] = index[i] >> 8;
+                  }
+                  palette_coded = true;
+               }
+               else
+                  values.clear();
+            }
+            if (palette_coded)
+               dropped = 0;
+            else if (kept > len/2)
+            {
+               values.assign(src, src+len);
+               dropped = 0;
+            }
+            else
+            {
+               offsets.reserve(kept);
+               values.reserve(kept);
+               for (size_t i=0; i<len; ++i)
+                  if (src[i].norm() > tolerance)
+                  {
+                     offsets.push_back(i);
+                     values.push_back(src[i]);
+                  }
+            }
+            // swap rather than assign, to release the memory of the old chunk
+            c.offsets.swap(offsets);
+            c.values.swap(values);
+            c.codes.swap(codes);
+            return dropped;
+         }
+
+         /**
+          * \brief population of |1> of qubit <q>, and total population
+          */
+         void populations(size_t q, double& p1, double& total)
+         {
+            p1    = 0;
+            total = 0;
+            for (uint64_t ci=0; ci<chunks.size(); ++ci)
+            {
+               chunk_t& c = chunks[ci];
+               if (coded(c))
+               {
+                  for (size_t i=0; i<chunk_size(); ++i)
+                  {
+                     uint64_t x = (ci << chunk_qubits) | i;
+                     double   w = c.values[code(c,i)].norm();
+                     total += w;
+                     if ((x >> q) & 1)
+                        p1 += w;
+                  }
+                  continue;
+               }
+               for (size_t i=0; i<c.values.size(); ++i)
+               {
+                  uint64_t x = (ci << chunk_qubits) | (c.offsets.empty() ? i : c.offsets[i]);
+                  double   w = c.values[i].norm();
+                  total += w;
+                  if ((x >> q) & 1)
+                     p1 += w;
+               }
+            }
+         }
+
+         /**
+          * \brief update the peak memory after a gate
+          */
+         void account()
+         {
+            peak = std::max(peak, stored_bytes());
+         }
+
+      public:
+
+         measurement_register_t    measurement_register;
+         measurement_prediction_t  measurement_prediction;
+         measurement_averaging_t   measurement_averaging;
+         bool                      measurement_averaging_enabled;
+
+         /**
+          * ctor : state |0...0> of <n_qubits> qubits, amplitudes of weight
+          *    below <tolerance> dropped from the sparse chunks
+          */
+         compressed_register(size_t n_qubits, double tolerance=__compressed_default_tolerance__) : n_qubits(n_qubits),
+                                                                                                  chunk_qubits(std::min<size_t>(n_qubits,std::max<size_t>(__compressed_chunk_qubits__,n_qubits-std::min<size_t>(n_qubits,__compressed_max_chunks_qubits__)))),
+                                                                                                  tolerance(tolerance),
+                                                                                                  rgenerator(xpu::timer().current()*10e5),
+                                                                                                  udistribution(.0,1),
+                                                                                                  measurement_register(n_qubits),
+                                                                                                  measurement_prediction(n_qubits),
+                                                                                                  measurement_averaging(n_qubits),
+                                                                                                  measurement_averaging_enabled(true)
+         {
+            if (n_qubits > 63)
+               throw std::invalid_argument("hard limit of 63 qubits exceeded");
+            reset();
+         }
+
+         ~compressed_register()
+         {
+            for (size_t k=0; k<scratch.size(); ++k)
+               delete scratch[k];
+         }
+
+         /**
+          * \brief reset the state to |0...0>
+          */
+         void reset()
+         {
+            chunks.clear();
+            chunks.resize(1ULL << (n_qubits-chunk_qubits));
+            chunks[0].offsets.push_back(0);
+            chunks[0].values.push_back(complex_t(1,0));
+            for (size_t q=0; q<n_qubits; ++q)
+            {
+               measurement_register[q]   = false;
+               measurement_prediction[q] = __state_0__;
+            }
+            error = 0;
+            peak  = 0;
+            account();
+         }
+
+         size_t size()
+         {
+            return n_qubits;
+         }
+
+         double rand()
+         {
+            return udistribution(rgenerator);
+         }
+
+         void seed(uint64_t s)
+         {
+            rgenerator.seed(s);
+            udistribution.reset();
+         }
+
+         bool test(uint64_t q)
+         {
+            return measurement_register[q];
+         }
+
+         bool get_measurement(uint64_t q)
+         {
+            return measurement_register[q];
+         }
+
+         void flip_measurement(uint64_t q)
+         {
+            measurement_register[q] = !measurement_register[q];
+         }
+
+         /**
+          * \brief memory taken by the chunks, in bytes
+          */
+         size_t stored_bytes()
+         {
+            size_t bytes = chunks.size()*sizeof(chunk_t);
+            for (size_t i=0; i<chunks.size(); ++i)
+               bytes += chunks[i].offsets.size()*sizeof(uint32_t) + chunks[i].values.size()*sizeof(complex_t) + chunks[i].codes.size();
+            return bytes;
+         }
+
+         /**
+          * \brief largest memory taken by the chunks since the last reset
+          */
+         size_t peak_bytes()
+         {
+            return peak;
+         }
+
+         /**
+          * \brief size of the full state vector over the peak memory of
+          *    the chunks
+          */
+         double compression_ratio()
+         {
+            return std::ldexp((double)sizeof(complex_t), (int)n_qubits)/peak;
+         }
+
+         /**
+          * \brief bound on the distance between the simulated state and
+          *    the exact one, from the amplitudes dropped since the last
+          *    reset (0 when the simulation is lossless)
+          */
+         double error_bound()
+         {
+            return error;
+         }
+
+         /**
+          * \brief apply the relocatable gate <g> (see is_relocatable()) :
+          *    its qubits above the chunk become the qubits chunk_qubits..
+          *    of a state vector holding the 2^k chunks it mixes
+          */
+         void apply_unitary(gate * g)
+         {
+            std::vector<uint64_t> qubits = g->qubits();
+            std::vector<uint64_t> high;
+            std::vector<uint64_t> phys(n_qubits);
+            for (uint64_t q=0; q<n_qubits; ++q)
+               phys[q] = q;
+            for (size_t i=0; i<qubits.size(); ++i)
+               if ((qubits[i] >= chunk_qubits) && (phys[qubits[i]] == qubits[i]))
+               {
+                  phys[qubits[i]] = chunk_qubits + high.size();
+                  high.push_back(qubits[i]-chunk_qubits);
+               }
+
+            size_t       k     = high.size();
+            size_t       len   = chunk_size();
+            gate *       r     = (k ? relocate(g,phys) : g);
+            qu_register& buf   = buffer(k);
+            complex_t *  b     = buf.get_data().data();
+            uint64_t     hmask = 0;
+            for (size_t j=0; j<k; ++j)
+               hmask |= (1ULL << high[j]);
+
+            std::vector<uint64_t> group(1UL << k);
+            double                dropped = 0;
+            for (uint64_t base=0; base<chunks.size(); ++base)
+            {
+               if (base & hmask)
+                  continue;
+               bool zero = true;
+               for (uint64_t j=0; j<group.size(); ++j)
+               {
+                  uint64_t ci = base;
+                  for (size_t h=0; h<k; ++h)
+                     if ((j >> h) & 1)
+                        ci |= (1ULL << high[h]);
+                  group[j] = ci;
+                  zero &= chunks[ci].values.empty();
+               }
+               // gates are linear : zero chunks stay zero
+               if (zero)
+                  continue;
+               for (uint64_t j=0; j<group.size(); ++j)
+                  decompress(chunks[group[j]], b + j*len);
+               // the predictions of the buffer do not describe the chunks
+               for (size_t q=0; q<chunk_qubits+k; ++q)
+                  buf.set_measurement_prediction(q, __state_unknown__);
+               r->apply(buf);
+               for (uint64_t j=0; j<group.size(); ++j)
+                  dropped += compress(chunks[group[j]], b + j*len);
+            }
+            if (r != g)
+               delete r;
+            error += std::sqrt(dropped);
+            account();
+
+            std::vector<uint64_t>  dest;
+            std::vector<complex_t> d;
+            cmatrix_t              m;
+            if (g->get_permutation(dest))
+            {
+               measurement_prediction_t p = measurement_prediction;
+               for (size_t i=0; i<qubits.size(); ++i)
+                  measurement_prediction[dest[i]] = p[qubits[i]];
+            }
+            else if (!g->get_diagonal(d) && !g->is_diagonal())
+               measurement_prediction[g->target_qubits()[0]] = __state_unknown__;
+         }
+
+         /**
+          * \brief probability of measuring |1> on <q>
+          */
+         double probability(size_t q)
+         {
+            double p1, total;
+            populations(q, p1, total);
+            return (total > 0 ? p1/total : 0.);
+         }
+
+         /**
+          * \brief measure <q> in the computational basis
+          */
+         bool measure(size_t q, bool disable_averaging=false)
+         {
+            double p1, total;
+            populations(q, p1, total);
+            bool        value   = (rand()*total < p1);
+            double      f       = 1/std::sqrt(value ? p1 : total-p1);
+            complex_t * b       = buffer(0).get_data().data();
+            double      dropped = 0;
+            for (uint64_t ci=0; ci<chunks.size(); ++ci)
+            {
+               if (chunks[ci].values.empty())
+                  continue;
+               decompress(chunks[ci], b);
+               for (uint64_t i=0; i<chunk_size(); ++i)
+               {
+                  uint64_t x = (ci << chunk_qubits) | i;
+                  if ((((x >> q) & 1) != 0) == value)
+                     b[i] *= complex_t(f,0);
+                  else
+                     b[i] = complex_t(0,0);
+               }
+               dropped += compress(chunks[ci], b);
+            }
+            error += std::sqrt(dropped);
+            account();
+
+            measurement_prediction[q] = (value ? __state_1__ : __state_0__);
+            measurement_register[q]   = value;
+            if (!disable_averaging && measurement_averaging_enabled)
+            {
+               if (value)
+                  measurement_averaging[q].exited_states++;
+               else
+                  measurement_averaging[q].ground_states++;
+            }
+            return value;
+         }
+
+         /**
+          * \brief prepare <q> in |0>
+          */
+         void prepz(size_t q)
+         {
+            if (measure(q,true))
+            {
+               pauli_x x(q);
+               apply_unitary(&x);
+            }
+            measurement_register[q]   = false;
+            measurement_prediction[q] = __state_0__;
+         }
+
+         /**
+          * \brief amplitude of the basis state <i>
+          */
+         complex_t amplitude(uint64_t i)
+         {
+            chunk_t& c = chunks[i >> chunk_qubits];
+            uint64_t o = i & (chunk_size()-1);
+            if (coded(c))
+               return c.values[code(c,o)];
+            if (c.offsets.empty())
+               return (c.values.empty() ? complex_t(0,0) : c.values[o]);
+            std::vector<uint32_t>::iterator it = std::lower_bound(c.offsets.begin(), c.offsets.end(), (uint32_t)o);
+            if ((it == c.offsets.end()) || (*it != o))
+               return complex_t(0,0);
+            return c.values[it-c.offsets.begin()];
+         }
+
+         /**
+          * \brief check whether <g> can be applied to a compressed
+          *    register : relocatable gates (see is_relocatable()),
+          *    measurements, preparations and classical gates
+          */
+         static bool supports(gate * g)
+         {
+            switch (g->type())
+            {
+               case __identity_gate__      :
+               case __measure_gate__       :
+               case __measure_reg_gate__   :
+               case __measure_x_gate__     :
+               case __measure_x_reg_gate__ :
+               case __measure_y_gate__     :
+               case __measure_y_reg_gate__ :
+               case __prepz_gate__         :
+               case __prepx_gate__         :
+               case __prepy_gate__         :
+               case __classical_not_gate__ :
+               case __display__            :
+               case __display_binary__     :
+                  return true;
+               case __bin_ctrl_gate__      :
+                  return supports(((bin_ctrl *)g)->get_gate());
+               case __parallel_gate__      :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        if (!supports(gates[i]))
+                           return false;
+                     return true;
+                  }
+               default :
+                  return is_relocatable(g);
+            }
+         }
+
+         /**
+          * \brief check whether all the gates of <circuits> are supported
+          */
+         static bool supports(std::vector<circuit *>& circuits)
+         {
+            for (size_t c=0; c<circuits.size(); ++c)
+               for (size_t i=0; i<circuits[c]->size(); ++i)
+                  if (!supports(circuits[c]->get(i)))
+                     return false;
+            return true;
+         }
+
+         /**
+          * \brief apply <g> with the semantics of gate::apply()
+          */
+         int64_t apply(gate * g)
+         {
+            switch (g->type())
+            {
+               case __identity_gate__      : break;
+               case __measure_gate__       : return measure(g->qubits()[0]);
+               case __measure_reg_gate__   :
+                  for (size_t q=0; q<n_qubits; ++q)
+                     measure(q);
+                  break;
+               case __measure_x_gate__     :
+               case __measure_x_reg_gate__ :
+               case __measure_y_gate__     :
+               case __measure_y_reg_gate__ :
+                  {
+                     bool                reg = ((g->type() == __measure_x_reg_gate__) || (g->type() == __measure_y_reg_gate__));
+                     bool                y   = ((g->type() == __measure_y_gate__) || (g->type() == __measure_y_reg_gate__));
+                     std::vector<size_t> qubits;
+                     for (size_t q=0; q<(reg ? n_qubits : 1); ++q)
+                        qubits.push_back(reg ? q : g->qubits()[0]);
+                     for (size_t i=0; i<qubits.size(); ++i)
+                     {
+                        hadamard   h(qubits[i]);
+                        s_dag_gate sd(qubits[i]);
+                        phase_shift s(qubits[i]);
+                        if (y)
+                           apply_unitary(&sd);
+                        apply_unitary(&h);
+                        measure(qubits[i]);
+                        apply_unitary(&h);
+                        if (y)
+                           apply_unitary(&s);
+                     }
+                     break;
+                  }
+               case __prepz_gate__         : prepz(g->qubits()[0]); break;
+               case __prepx_gate__         :
+               case __prepy_gate__         :
+                  {
+                     hadamard    h(g->qubits()[0]);
+                     phase_shift s(g->qubits()[0]);
+                     prepz(g->qubits()[0]);
+                     apply_unitary(&h);
+                     if (g->type() == __prepy_gate__)
+                        apply_unitary(&s);
+                     break;
+                  }
+               case __classical_not_gate__ : flip_measurement(((classical_not *)g)->get_bit()); break;
+               case __display__            : dump(); break;
+               case __display_binary__     : dump(true); break;
+               case __bin_ctrl_gate__      :
+                  {
+                     std::vector<size_t> bits = ((bin_ctrl *)g)->get_bits();
+                     for (size_t i=0; i<bits.size(); ++i)
+                        if (!test(bits[i]))
+                           return 0;
+                     return apply(((bin_ctrl *)g)->get_gate());
+                  }
+               case __parallel_gate__      :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        apply(gates[i]);
+                     break;
+                  }
+               default :
+                  if (!is_relocatable(g))
+                  {
+                     println("[x] compressed register : unsupported gate !");
+                     g->dump();
+                     return -1;
+                  }
+                  apply_unitary(g);
+                  break;
+            }
+            return 0;
+         }
+
+         /**
+          * \brief execute <c> (honouring its iterations)
+          */
+         void execute(circuit * c)
+         {
+            for (size_t it=0; it<std::max<size_t>(c->get_iterations(),1); ++it)
+               for (size_t i=0; i<c->size(); ++i)
+                  apply(c->get(i));
+         }
+
+         /**
+          * \brief non-zero amplitudes of the state, one per line, for up
+          *    to __compressed_state_max_qubits__ qubits, or the size of
+          *    the compressed state
+          */
+         std::string get_state()
+         {
+            std::stringstream ss;
+            if (n_qubits > __compressed_state_max_qubits__)
+            {
+               ss << "compressed state of " << n_qubits << " qubits, " << stored_bytes() << " bytes, compression ratio "
+                  << compression_ratio() << ", error bound " << error << "\n";
+               return ss.str();
+            }
+            for (uint64_t i=0; i<(1ULL << n_qubits); ++i)
+            {
+               complex_t a = amplitude(i);
+               if ((std::abs(a.re) > __amp_epsilon__) || (std::abs(a.im) > __amp_epsilon__))
+                  ss << "   " << std::showpos << std::setw(7) << a << " |" << qu_register::to_binary_string(i,n_qubits) << "> +\n";
+            }
+            return ss.str();
+         }
+
+         /**
+          * \brief dump the compression statistics (unless <only_binary>),
+          *    then the measurement averaging, prediction and register as
+          *    qu_register::dump(true) does
+          */
+         void dump(bool only_binary=false)
+         {
+            if (!only_binary)
+            {
+               size_t dense = 0, palette_coded = 0, sparse = 0;
+               for (size_t i=0; i<chunks.size(); ++i)
+               {
+                  if (!chunks[i].offsets.empty())
+                     sparse++;
+                  else if (coded(chunks[i]))
+                     palette_coded++;
+                  else if (!chunks[i].values.empty())
+                     dense++;
+               }
+               println("--------------[compressed state]----------- ");
+               println("  [chunks : " << chunks.size() << " (" << dense << " dense, " << palette_coded << " palette-coded, " << sparse << " sparse)]");
+               println("  [compression ratio = " << compression_ratio() << ", error bound = " << error << "]");
+            }
+            if (measurement_averaging_enabled)
+            {
+               println("------------------------------------------- ");
+               print("[>>] measurement averaging (ground state) :");
+               print(" ");
+               for (int i=measurement_averaging.size()-1; i>=0; --i)
+               {
+                  double gs = measurement_averaging[i].ground_states;
+                  double es = measurement_averaging[i].exited_states;
+                  double av = ((es+gs) != 0. ? (gs/(es+gs)) : 0.);
+                  print(" | " << std::setw(9) << av);
+               }
+               println(" |");
+            }
+            println("------------------------------------------- ");
+            print("[>>] measurement prediction               :");
+            print(" ");
+            for (int i=measurement_prediction.size()-1; i>=0; --i)
+               print(" | " <<  std::setw(9) << __format_bin(measurement_prediction[i]));
+            println(" |");
+            println("------------------------------------------- ");
+            print("[>>] measurement register                 :");
+            print(" ");
+            for (int i=measurement_register.size()-1; i>=0; --i)
+               print(" | " <<  std::setw(9) << (measurement_register[i] ? '1' : '0'));
+            println(" |");
+            println("------------------------------------------- ");
+         }
+   };
+}
+
+#endif // QX_COMPRESSED_H
@@ -0,0 +1,358 @@
+#ifndef QX_DAMPING_CHANNEL_H
+#define QX_DAMPING_CHANNEL_H
+
+#include <cmath>
+#include <vector>
+#include "qx/core/circuit.h"
+#include "qx/core/random.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+namespace qx
+{
+   /**
+    * \brief duration (in cycles) of the gates whose duration is not set
+    */
+   #define __default_gate_duration__ 1
+
+   /**
+    * \brief qubits covered by the contiguous blocks of the damping
+    *    reduction (2^10 amplitudes per block)
+    */
+   #define __damping_block_qubits__ 10
+
+   /**
+    * \brief duration of <g> in cycles
+    */
+   inline uint64_t gate_duration(gate * g)
+   {
+      uint64_t d = g->get_duration();
+      return (d ? d : __default_gate_duration__);
+   }
+
+   /**
+    * \brief amplitude damping (T1) and pure dephasing (T2) of all the qubits
+    *    while each gate of a circuit executes, for its duration d (in the
+    *    units of T1 and T2), unravelled as quantum jumps when the channel is
+    *    used as the execution hook of the circuit :
+    *    - the decay probability gamma = 1-exp(-d/T1) is the same for all the
+    *      qubits, so one pass over the register gives the probability that
+    *      no qubit decays, sum_i |a_i|^2 (1-gamma)^popcount(i), and most of
+    *      the time the no-jump operator then scales every amplitude by
+    *      (1-gamma)^(popcount(i)/2) in place (see decay())
+    *    - pure dephasing, of rate 1/T2 - 1/(2 T1), is a random z flip with
+    *      probability (1-exp(-d/Tphi))/2 per qubit, which reproduces the
+    *      phase damping channel exactly
+    *    T1 = 0 disables the decay and T2 = 0 the pure dephasing. the
+    *    channel acts after each gate, or before it for measurements.
+    */
+   class damping_channel : public execution_hook
+   {
+      public:
+
+         /**
+          * ctor
+          */
+         damping_channel(size_t nq, double t1, double t2) : nq(nq), t1(t1), t2(t2), total_jumps(0), total_flips(0)
+         {
+            for (size_t q=0; q<nq; ++q)
+               flips.push_back(new qx::pauli_z(q));
+         }
+
+         /**
+          * dtor
+          */
+         ~damping_channel()
+         {
+            for (size_t q=0; q<flips.size(); ++q)
+               delete flips[q];
+         }
+
+         /**
+          * \brief restart the random stream of the channel from <s>
+          */
+         void seed(uint64_t s)
+         {
+            urg.seed(s);
+         }
+
+         /**
+          * \brief decay probability of a qubit during <d> cycles
+          */
+         double decay_probability(uint64_t d)
+         {
+            return (t1 > 0 ? 1-std::exp(-(double)d/t1) : 0.);
+         }
+
+         /**
+          * \brief dephasing probability lambda of the phase damping channel
+          *    during <d> cycles : the coherences decay by sqrt(1-lambda)
+          */
+         double dephasing_probability(uint64_t d)
+         {
+            if (t2 <= 0)
+               return 0.;
+            double rate = 1/t2 - (t1 > 0 ? 1/(2*t1) : 0.);
+            return (rate > 0 ? 1-std::exp(-2*rate*d) : 0.);
+         }
+
+         /**
+          * \brief apply gate <g> and the damping of its duration to <reg>
+          */
+         void apply(qx::gate * g, size_t step, qx::qu_register& reg)
+         {
+            qx::gate_type_t gt = g->type();
+            if ((gt==qx::__display__) || (gt==qx::__display_binary__) || (gt==qx::__print_str__))
+            {
+               g->apply(reg);
+               return;
+            }
+            uint64_t d = gate_duration(g);
+            if (is_measurement(g))
+            {
+               relax(reg,d);
+               g->apply(reg);
+            }
+            else
+            {
+               g->apply(reg);
+               relax(reg,d);
+            }
+         }
+
+         /**
+          * \brief damping of all the qubits of <reg> during <d> cycles
+          */
+         void relax(qx::qu_register& reg, uint64_t d)
+         {
+            double gamma = decay_probability(d);
+            if (gamma > 0)
+            {
+               total_jumps += (reg.single_precision() ? decay(reg.get_data_f().data(), gamma, decayed) : decay(reg.get_data().data(), gamma, decayed));
+               for (size_t i=0; i<decayed.size(); ++i)
+                  reg.set_measurement_prediction(decayed[i], __state_0__);
+            }
+            double lambda = dephasing_probability(d);
+            if (lambda > 0)
+            {
+               double pz = (1-std::sqrt(1-lambda))/2;
+               for (size_t q=0; q<nq; ++q)
+                  if (urg.next() < pz)
+                  {
+                     flips[q]->apply(reg);
+                     total_flips++;
+                  }
+            }
+         }
+
+         /**
+          * \brief total number of decays and phase flips
+          */
+         size_t get_total_errors()
+         {
+            return total_jumps+total_flips;
+         }
+
+      private:
+
+         static size_t popcount(uint64_t x)
+         {
+            size_t c = 0;
+            for (; x; x &= (x-1))
+               c++;
+            return c;
+         }
+
+         /**
+          * \brief check whether <g> measures qubits
+          */
+         bool is_measurement(qx::gate * g)
+         {
+            switch (g->type())
+            {
+               case __measure_gate__       :
+               case __measure_reg_gate__   :
+               case __measure_x_gate__     :
+               case __measure_x_reg_gate__ :
+               case __measure_y_gate__     :
+               case __measure_y_reg_gate__ :
+                  return true;
+               case __parallel_gate__      :
+                  {
+                     const std::vector<gate *>& gates = ((parallel_gates *)g)->gate_list();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        if (is_measurement(gates[i]))
+                           return true;
+                     return false;
+                  }
+               default :
+                  return false;
+            }
+         }
+
+         /**
+          * \brief fill the tables of f^popcount(i & mask) for the low and
+          *    high bits of the indices i (see populations())
+          */
+         void weights(uint64_t mask, double f)
+         {
+            size_t k      = std::min<size_t>(nq, __damping_block_qubits__);
+            size_t block  = (1UL << k);
+            size_t blocks = (1UL << (nq-k));
+            powers.resize(nq+1);
+            powers[0] = 1;
+            for (size_t c=1; c<=nq; ++c)
+               powers[c] = powers[c-1]*f;
+            wlow.resize(block);
+            whigh.resize(blocks);
+            for (size_t l=0; l<block; ++l)
+               wlow[l] = powers[popcount(l & mask)];
+            for (size_t h=0; h<blocks; ++h)
+               whigh[h] = powers[popcount((h << k) & mask)];
+         }
+
+         /**
+          * \brief single reduction over the state <a> : <n0> is the norm of
+          *    the state after the no-decay operator of the qubits of <mask>,
+          *    sum_i |a_i|^2 keep^popcount(i & mask), and <p1> the population
+          *    of |1> of qubit <q>. the weights are the products of two tables
+          *    indexed by the low and high bits of i (see weights()).
+          */
+         template <typename amplitude_t>
+         void populations(const amplitude_t * a, uint64_t mask, size_t q, double keep, double& p1, double& n0)
+         {
+            size_t k      = std::min<size_t>(nq, __damping_block_qubits__);
+            size_t block  = (1UL << k);
+            size_t blocks = (1UL << (nq-k));
+            weights(mask, keep);
+            const double * wl = wlow.data();
+            const double * wh = whigh.data();
+
+            double e = 0, w = 0;
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+:e,w)
+#endif
+            for (int64_t h=0; h<(int64_t)blocks; ++h)
+            {
+               const amplitude_t * b  = a + h*block;
+               double              bw = 0, be = 0;
+               bool                hq = (q >= k) && ((h >> (q-k)) & 1);
+               for (size_t l=0; l<block; ++l)
+               {
+                  double x = (double)b[l].re*b[l].re + (double)b[l].im*b[l].im;
+                  bw += wl[l]*x;
+                  if (hq || ((q < k) && ((l >> q) & 1)))
+                     be += x;
+               }
+               w += bw*wh[h];
+               e += be;
+            }
+            p1 = e;
+            n0 = w;
+         }
+
+         /**
+          * \brief no-decay operator of the qubits of <mask>, in place :
+          *    a_i *= sqrt(keep)^popcount(i & mask) * <norm>
+          */
+         template <typename amplitude_t>
+         void damp(amplitude_t * a, uint64_t mask, double keep, double norm)
+         {
+            size_t k      = std::min<size_t>(nq, __damping_block_qubits__);
+            size_t block  = (1UL << k);
+            size_t blocks = (1UL << (nq-k));
+            weights(mask, std::sqrt(keep));
+            const double * sl = wlow.data();
+            const double * sh = whigh.data();
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+            for (int64_t h=0; h<(int64_t)blocks; ++h)
+            {
+               amplitude_t * b = a + h*block;
+               for (size_t l=0; l<block; ++l)
+               {
+                  double f = sl[l]*sh[h]*norm;
+                  b[l].re *= f;
+                  b[l].im *= f;
+               }
+            }
+         }
+
+         /**
+          * \brief decay |1> -> |0> of qubit <q>, in place, scaled by <norm>
+          */
+         template <typename amplitude_t>
+         void lower(amplitude_t * a, size_t q, double norm)
+         {
+            uint64_t bit = (1ULL << q);
+            int64_t  n   = (int64_t)(1ULL << nq);
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+            for (int64_t i=0; i<n; ++i)
+            {
+               if (!(i & bit))
+                  continue;
+               a[i ^ bit].re = a[i].re*norm;
+               a[i ^ bit].im = a[i].im*norm;
+               a[i].re = 0;
+               a[i].im = 0;
+            }
+         }
+
+         /**
+          * \brief quantum jumps of the amplitude damping of probability
+          *    <gamma> of all the qubits of the state <a> : one reduction
+          *    gives the probability that no qubit decays, in which case the
+          *    no-decay operator is applied in one pass. otherwise, the decays
+          *    are drawn qubit by qubit, conditioned on at least one of them
+          *    happening, which is exact and rare (probability ~ n*gamma).
+          * \return the number of decays, the decayed qubits in <decayed>
+          */
+         template <typename amplitude_t>
+         size_t decay(amplitude_t * a, double gamma, std::vector<size_t>& decayed)
+         {
+            double   keep = 1-gamma;
+            uint64_t all  = ((nq < 64) ? (1ULL << nq)-1 : ~0ULL);
+            double   p1, n0;
+            decayed.clear();
+            populations(a, all, 0, keep, p1, n0);
+            if (urg.next() < n0)
+            {
+               damp(a, all, keep, 1/std::sqrt(n0));
+               return 0;
+            }
+            for (size_t q=0; q<nq; ++q)
+            {
+               // n0 : no decay of the qubits q..n-1 from the current state
+               populations(a, all & ~((1ULL << q)-1), q, keep, p1, n0);
+               double pj = gamma*p1;
+               double p  = (decayed.empty() ? pj/(1-n0) : pj);
+               if (urg.next() < p)
+               {
+                  lower(a, q, 1/std::sqrt(p1));
+                  decayed.push_back(q);
+               }
+               else
+                  damp(a, (1ULL << q), keep, 1/std::sqrt(1-pj));
+            }
+            return decayed.size();
+         }
+
+         size_t                              nq;
+         double                              t1;
+         double                              t2;
+         size_t                              total_jumps;
+         size_t                              total_flips;
+         std::vector<qx::gate *>             flips;
+         std::vector<size_t>                 decayed;
+         std::vector<double>                 powers;
+         std::vector<double>                 wlow;
+         std::vector<double>                 whigh;
+         qx::uniform_random_number_generator urg;
+   };
+}
+
+#endif // QX_DAMPING_CHANNEL_H
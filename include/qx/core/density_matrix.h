@@ -0,0 +1,717 @@
+/**
+ * @file    density_matrix.h
+ * @brief   density matrix simulation of noisy circuits : the mixed state is
+ *          evolved exactly under the gates and the kraus channels of the
+ *          error model, instead of being sampled by trajectories
+ */
+
+#ifndef QX_DENSITY_MATRIX_H
+#define QX_DENSITY_MATRIX_H
+
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <algorithm>
+#include <sstream>
+#include <cmath>
+#include <cstdint>
+#include <map>
+
+#include "qx/core/circuit.h"
+#include "qx/core/error_model.h"
+
+namespace qx
+{
+   /**
+    * \brief largest register simulated on a density matrix when the
+    *    backend is picked automatically (4^12 elements, 256 MiB)
+    */
+   #define __density_auto_max_qubits__ 12
+
+   typedef std::vector<cmatrix_t> kraus_t;
+
+   /**
+    * \brief kraus operators of the single-qubit depolarizing channel :
+    *    x, y and z errors with probability <p>/3 each
+    */
+   inline kraus_t depolarizing_kraus(double p)
+   {
+      kraus_t k(4);
+      double  a = std::sqrt(1-p);
+      double  b = std::sqrt(p/3);
+      k[0](0,0) = a;  k[0](1,1) = a;
+      k[1](0,1) = b;  k[1](1,0) = b;
+      k[2](0,1) = complex_t(0,-b);  k[2](1,0) = complex_t(0,b);
+      k[3](0,0) = b;  k[3](1,1) = -b;
+      return k;
+   }
+
+   /**
+    * \brief kraus operators of the bit-flip channel : an x error with
+    *    probability <p>, as the depolarizing channel draws on measured
+    *    qubits (see depolarizing_channel::measurement_error_type())
+    */
+   inline kraus_t bit_flip_kraus(double p)
+   {
+      kraus_t k(2);
+      double  a = std::sqrt(1-p);
+      double  b = std::sqrt(p);
+      k[0](0,0) = a;  k[0](1,1) = a;
+      k[1](0,1) = b;  k[1](1,0) = b;
+      return k;
+   }
+
+   /**
+    * \brief kraus operators of the amplitude damping channel : |1> decays
+    *    to |0> with probability <gamma>
+    */
+   inline kraus_t amplitude_damping_kraus(double gamma)
+   {
+      kraus_t k(2);
+      k[0](0,0) = 1;  k[0](1,1) = std::sqrt(1-gamma);
+      k[1](0,1) = std::sqrt(gamma);
+      return k;
+   }
+
+   /**
+    * \brief kraus operators of the phase damping (dephasing) channel : the
+    *    coherences decay by a factor sqrt(1-<lambda>)
+    */
+   inline kraus_t phase_damping_kraus(double lambda)
+   {
+      kraus_t k(2);
+      k[0](0,0) = 1;  k[0](1,1) = std::sqrt(1-lambda);
+      k[1](1,1) = std::sqrt(lambda);
+      return k;
+   }
+
+
+   /**
+    * \brief density matrix register : rho is stored as a vector of 4^n
+    *    amplitudes, element (r,c) at index r | (c << n), that is a state
+    *    vector of 2n qubits. U rho U^+ applies U to qubits q and conj(U) to
+    *    qubits q+n, and a kraus channel sum_k K rho K^+ is the superoperator
+    *    sum_k K (x) conj(K) on qubits (q,q+n), so the dense state-vector
+    *    kernels evolve mixed states without building any full matrix.
+    *    the measurement averaging accumulates the exact outcome
+    *    probabilities instead of sampled outcomes.
+    */
+   class density_matrix_register
+   {
+      private:
+
+         size_t               n_qubits;
+         cvector_t            rho;
+         std::vector<double>  ground_states;
+         std::vector<double>  excited_states;
+         std::vector<complex_t> noise;    // superoperator of the error model
+         std::vector<complex_t> measurement_noise;    // on measured qubits
+         damping_channel *    damping;
+         std::map<uint64_t, std::vector<complex_t> > damping_noise;    // per gate duration
+
+         /**
+          * \brief superoperator sum_k K (x) conj(K) of the single-qubit
+          *    channel <kraus>, on the (row,column) qubit pair
+          */
+         static std::vector<complex_t> superoperator(const kraus_t& kraus)
+         {
+            std::vector<complex_t> s(16, complex_t(0,0));
+            for (size_t k=0; k<kraus.size(); ++k)
+            {
+               cmatrix_t m = kraus[k];
+               for (size_t i=0; i<4; ++i)
+                  for (size_t j=0; j<4; ++j)
+                     s[i*4+j] = s[i*4+j] + m(i & 1, j & 1)*m(i >> 1, j >> 1).conj();
+            }
+            return s;
+         }
+
+         /**
+          * \brief apply the superoperator <s> to qubit <q>
+          */
+         void apply_superoperator(size_t q, const complex_t * s)
+         {
+            std::vector<uint64_t> qubits(2);
+            qubits[0] = q;
+            qubits[1] = q+n_qubits;
+            __apply_dense(rho.data(), 2*n_qubits, qubits, s);
+         }
+
+         /**
+          * \brief superoperator of the channel <a> followed by <b>
+          */
+         static std::vector<complex_t> compose(const std::vector<complex_t>& a, const std::vector<complex_t>& b)
+         {
+            std::vector<complex_t> s(16, complex_t(0,0));
+            for (size_t i=0; i<4; ++i)
+               for (size_t j=0; j<4; ++j)
+                  for (size_t k=0; k<4; ++k)
+                     s[i*4+j] = s[i*4+j] + b[i*4+k]*a[k*4+j];
+            return s;
+         }
+
+         /**
+          * \brief superoperator of the noise of the step of gate <g>
+          */
+         const std::vector<complex_t>& step_noise(gate * g)
+         {
+            if (!damping)
+               return noise;
+            uint64_t d = gate_duration(g);
+            std::map<uint64_t, std::vector<complex_t> >::iterator it = damping_noise.find(d);
+            if (it != damping_noise.end())
+               return it->second;
+            std::vector<complex_t> ad = superoperator(amplitude_damping_kraus(damping->decay_probability(d)));
+            std::vector<complex_t> pd = superoperator(phase_damping_kraus(damping->dephasing_probability(d)));
+            return (damping_noise[d] = compose(ad, pd));
+         }
+
+         /**
+          * \brief check whether the superoperator <s> only mixes the
+          *    populations and scales the coherences, with real factors, as
+          *    the depolarizing and damping channels do
+          */
+         static bool phase_covariant(const std::vector<complex_t>& s)
+         {
+            for (size_t i=0; i<4; ++i)
+               for (size_t j=0; j<4; ++j)
+               {
+                  bool populations = (((i == 0) || (i == 3)) && ((j == 0) || (j == 3)));
+                  if (std::abs(s[i*4+j].im) > 1e-15)
+                     return false;
+                  if (!populations && (i != j) && (std::abs(s[i*4+j].re) > 1e-15))
+                     return false;
+               }
+            return true;
+         }
+
+         /**
+          * \brief unitary of the (controlled) 2x2 matrix <m> on the sorted
+          *    <qubits>, acting on <target> when all the <controls> are set
+          */
+         static std::vector<complex_t> controlled_unitary(const std::vector<uint64_t>& qubits, const std::vector<uint64_t>& controls, uint64_t target, cmatrix_t& m)
+         {
+            size_t   dim   = (1UL << qubits.size());
+            uint64_t tbit  = 0;
+            uint64_t cmask = 0;
+            for (size_t b=0; b<qubits.size(); ++b)
+            {
+               if (qubits[b] == target)
+                  tbit = (1UL << b);
+               for (size_t i=0; i<controls.size(); ++i)
+                  if (qubits[b] == controls[i])
+                     cmask |= (1UL << b);
+            }
+            std::vector<complex_t> u(dim*dim, complex_t(0,0));
+            for (uint64_t c=0; c<dim; ++c)
+            {
+               if ((c & cmask) != cmask)
+               {
+                  u[c*dim+c] = 1;
+                  continue;
+               }
+               size_t tc = ((c & tbit) ? 1 : 0);
+               u[(c & ~tbit)*dim+c]          = m(0,tc);
+               u[(c | tbit)*dim+c]           = m(1,tc);
+            }
+            return u;
+         }
+
+         /**
+          * \brief set <measured> for the qubits measured by <g>
+          */
+         void measured_qubits(gate * g, std::vector<bool>& measured)
+         {
+            switch (g->type())
+            {
+               case __measure_gate__       :
+               case __measure_x_gate__     :
+               case __measure_y_gate__     :
+                  measured[g->qubits()[0]] = true;
+                  break;
+               case __measure_reg_gate__   :
+               case __measure_x_reg_gate__ :
+               case __measure_y_reg_gate__ :
+                  measured.assign(n_qubits,true);
+                  break;
+               case __parallel_gate__      :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        measured_qubits(gates[i],measured);
+                     break;
+                  }
+               default :
+                  break;
+            }
+         }
+
+         /**
+          * \brief apply the 2x2 unitary <m> to qubit <q>
+          */
+         void apply_matrix(size_t q, const complex_t * m)
+         {
+            cmatrix_t u(m);
+            std::vector<complex_t> s(16);
+            for (size_t i=0; i<4; ++i)
+               for (size_t j=0; j<4; ++j)
+                  s[i*4+j] = u(i & 1, j & 1)*u(i >> 1, j >> 1).conj();
+            apply_superoperator(q, s.data());
+         }
+
+         /**
+          * \brief apply the channel of the error model to qubit <q> : the
+          *    channels of the error models only mix the populations and
+          *    scale the coherences by real factors, so rather than the
+          *    complex 4x4 product of the dense kernel, the four blocks of
+          *    2^q contiguous elements coupled by the channel are streamed
+          *    with real coefficients
+          */
+         void apply_noise(size_t q, const std::vector<complex_t>& noise)
+         {
+            if (!phase_covariant(noise))
+            {
+               apply_superoperator(q, noise.data());
+               return;
+            }
+            const complex_t * s   = noise.data();
+            double            p00 = s[0].re,  p03 = s[3].re;
+            double            p30 = s[12].re, p33 = s[15].re;
+            double            c01 = s[5].re,  c10 = s[10].re;
+            uint64_t          lo  = (1ULL << q);
+            uint64_t          hi  = (1ULL << (q+n_qubits));
+            uint64_t          mid = (1ULL << (n_qubits-1));  // blocks between the row and column bits
+            int64_t           blocks = (int64_t)(rho.size() >> (q+2));
+            complex_t *       r   = rho.data();
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+            for (int64_t b=0; b<blocks; ++b)
+            {
+               uint64_t base = (((uint64_t)b / mid) << (q+n_qubits+1)) | (((uint64_t)b % mid) << (q+1));
+               double * e0 = (double *)(r+base);
+               double * e1 = (double *)(r+base+lo);
+               double * e2 = (double *)(r+base+hi);
+               double * e3 = (double *)(r+base+lo+hi);
+               for (uint64_t j=0; j<2*lo; ++j)
+               {
+                  double x0 = e0[j];
+                  double x3 = e3[j];
+                  e0[j]  = p00*x0+p03*x3;
+                  e3[j]  = p30*x0+p33*x3;
+                  e1[j] *= c01;
+                  e2[j] *= c10;
+               }
+            }
+         }
+
+      public:
+
+         /**
+          * \brief register of <n> qubits in |0><0|
+          */
+         density_matrix_register(size_t n) : n_qubits(n), ground_states(n,0), excited_states(n,0), damping(NULL)
+         {
+            if (n > 31)
+               throw std::invalid_argument("hard limit of 31 qubits exceeded");
+            xpu::select_isa();
+            rho.resize(1ULL << (2*n));
+            reset();
+         }
+
+         /**
+          * \brief back to |0><0|, with the averaging cleared
+          */
+         void reset()
+         {
+            std::fill(rho.begin(), rho.end(), complex_t(0,0));
+            rho[0] = 1;
+            reset_measurement_averaging();
+         }
+
+         void reset_measurement_averaging()
+         {
+            std::fill(ground_states.begin(), ground_states.end(), 0.);
+            std::fill(excited_states.begin(), excited_states.end(), 0.);
+         }
+
+         size_t size()
+         {
+            return n_qubits;
+         }
+
+         /**
+          * \brief apply the single-qubit channel <kraus> to every qubit
+          *    after each gate, and <measurement_kraus> (<kraus> if empty)
+          *    before it on measured qubits, as the trajectories of the
+          *    error model do on average
+          */
+         void set_noise(const kraus_t& kraus, const kraus_t& measurement_kraus=kraus_t())
+         {
+            noise.clear();
+            measurement_noise.clear();
+            if (!kraus.empty())
+               noise = superoperator(kraus);
+            if (!measurement_kraus.empty())
+               measurement_noise = superoperator(measurement_kraus);
+         }
+
+         /**
+          * \brief damp all the qubits during each gate, with the relaxation
+          *    times <t1> and <t2> and the gate durations (see damping_channel)
+          */
+         void set_damping(double t1, double t2)
+         {
+            delete damping;
+            damping = new damping_channel(0, t1, t2);
+            damping_noise.clear();
+         }
+
+         ~density_matrix_register()
+         {
+            delete damping;
+         }
+
+         /**
+          * \brief element (<r>,<c>) of rho
+          */
+         complex_t get(uint64_t r, uint64_t c)
+         {
+            return rho[r | (c << n_qubits)];
+         }
+
+         /**
+          * \brief apply the unitary <u> (row-major, bit b of its indices
+          *    is qubit qubits[b]) on the sorted <qubits>
+          */
+         void apply_unitary(const std::vector<uint64_t>& qubits, const std::vector<complex_t>& u)
+         {
+            std::vector<uint64_t>  cq(qubits.size());
+            std::vector<complex_t> cu(u.size());
+            for (size_t i=0; i<qubits.size(); ++i)
+               cq[i] = qubits[i]+n_qubits;
+            for (size_t i=0; i<u.size(); ++i)
+               cu[i] = complex_t(u[i]).conj();
+            __apply_dense(rho.data(), 2*n_qubits, qubits, u.data());
+            __apply_dense(rho.data(), 2*n_qubits, cq, cu.data());
+         }
+
+         /**
+          * \brief apply the channel sum_k K rho K^+ of <kraus> to qubit <q>
+          */
+         void apply_channel(size_t q, const kraus_t& kraus)
+         {
+            std::vector<complex_t> s = superoperator(kraus);
+            apply_superoperator(q, s.data());
+         }
+
+         /**
+          * \brief probability of measuring |1> on qubit <q>
+          */
+         double probability(size_t q)
+         {
+            double   p   = 0;
+            uint64_t dim = (1ULL << n_qubits);
+            for (uint64_t i=0; i<dim; ++i)
+               if ((i >> q) & 1)
+                  p += rho[i | (i << n_qubits)].re;
+            return p;
+         }
+
+         /**
+          * \brief expectation value of pauli z on qubit <q>
+          */
+         double expectation_z(size_t q)
+         {
+            return 1-2*probability(q);
+         }
+
+         /**
+          * \brief tr(rho^2) : 1 for pure states
+          */
+         double purity()
+         {
+            double p = 0;
+            for (uint64_t i=0; i<rho.size(); ++i)
+               p += rho[i].norm();
+            return p;
+         }
+
+         /**
+          * \brief non-selective z measurement of <q> : the outcome
+          *    probabilities are accumulated and the coherences dropped
+          */
+         void measure(size_t q)
+         {
+            double p1 = probability(q);
+            ground_states[q]  += 1-p1;
+            excited_states[q] += p1;
+            uint64_t n = n_qubits;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+            for (int64_t i=0; i<(int64_t)rho.size(); ++i)
+               if (((i >> q) ^ (i >> (q+n))) & 1)
+                  rho[i] = 0;
+         }
+
+         /**
+          * \brief measure all the qubits
+          */
+         void measure()
+         {
+            for (size_t q=0; q<n_qubits; ++q)
+               measure(q);
+         }
+
+         /**
+          * \brief reset <q> to |0>
+          */
+         void prepz(size_t q)
+         {
+            kraus_t k(2);
+            k[0](0,0) = 1;
+            k[1](0,1) = 1;
+            apply_channel(q, k);
+         }
+
+         /**
+          * \brief check whether <g> can be applied to a density matrix :
+          *    binary-controlled gates need the outcome of each shot
+          */
+         static bool supports(gate * g)
+         {
+            cmatrix_t m;
+            switch (g->type())
+            {
+               case __identity_gate__      :
+               case __swap_gate__          :
+               case __measure_gate__       :
+               case __measure_reg_gate__   :
+               case __measure_x_gate__     :
+               case __measure_x_reg_gate__ :
+               case __measure_y_gate__     :
+               case __measure_y_reg_gate__ :
+               case __prepz_gate__         :
+               case __prepx_gate__         :
+               case __prepy_gate__         :
+               case __display__            :
+               case __display_binary__     :
+                  return true;
+               case __parallel_gate__      :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        if (!supports(gates[i]))
+                           return false;
+                     return true;
+                  }
+               default :
+                  return g->get_matrix(m);
+            }
+         }
+
+         /**
+          * \brief check whether all the gates of <circuits> are supported
+          */
+         static bool supports(std::vector<circuit *>& circuits)
+         {
+            for (size_t c=0; c<circuits.size(); ++c)
+               for (size_t i=0; i<circuits[c]->size(); ++i)
+                  if (!supports(circuits[c]->get(i)))
+                     return false;
+            return true;
+         }
+
+         /**
+          * \brief apply <g> (without noise)
+          */
+         int64_t apply(gate * g)
+         {
+            cmatrix_t m;
+            switch (g->type())
+            {
+               case __identity_gate__      : break;
+               case __swap_gate__          :
+                  {
+                     std::vector<uint64_t> q = g->qubits();
+                     std::sort(q.begin(), q.end());
+                     std::vector<complex_t> u(16, complex_t(0,0));
+                     u[0*4+0] = 1;  u[2*4+1] = 1;  u[1*4+2] = 1;  u[3*4+3] = 1;
+                     apply_unitary(q, u);
+                     break;
+                  }
+               case __measure_gate__       : measure(g->qubits()[0]); break;
+               case __measure_reg_gate__   : measure(); break;
+               case __measure_x_gate__     :
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  measure(g->qubits()[0]);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  break;
+               case __measure_x_reg_gate__ :
+                  for (size_t q=0; q<n_qubits; ++q)
+                  {
+                     apply_matrix(q, hadamard_c);
+                     measure(q);
+                     apply_matrix(q, hadamard_c);
+                  }
+                  break;
+               case __measure_y_gate__     :
+                  apply_matrix(g->qubits()[0], sdag_gate_c);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  measure(g->qubits()[0]);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  apply_matrix(g->qubits()[0], phase_c);
+                  break;
+               case __measure_y_reg_gate__ :
+                  for (size_t q=0; q<n_qubits; ++q)
+                  {
+                     apply_matrix(q, sdag_gate_c);
+                     apply_matrix(q, hadamard_c);
+                     measure(q);
+                     apply_matrix(q, hadamard_c);
+                     apply_matrix(q, phase_c);
+                  }
+                  break;
+               case __prepz_gate__         : prepz(g->qubits()[0]); break;
+               case __prepx_gate__         :
+                  prepz(g->qubits()[0]);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  break;
+               case __prepy_gate__         :
+                  prepz(g->qubits()[0]);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  apply_matrix(g->qubits()[0], phase_c);
+                  break;
+               case __display__            : dump(); break;
+               case __display_binary__     : dump(true); break;
+               case __parallel_gate__      :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        apply(gates[i]);
+                     break;
+                  }
+               default :
+                  {
+                     if (!g->get_matrix(m))
+                     {
+                        println("[x] density matrix register : unsupported gate !");
+                        g->dump();
+                        return -1;
+                     }
+                     std::vector<uint64_t> controls = g->control_qubits();
+                     uint64_t              target   = g->target_qubits()[0];
+                     if (controls.empty())
+                     {
+                        apply_matrix(target, m.m);
+                        break;
+                     }
+                     std::vector<uint64_t> qubits(controls);
+                     qubits.push_back(target);
+                     std::sort(qubits.begin(), qubits.end());
+                     apply_unitary(qubits, controlled_unitary(qubits, controls, target, m));
+                     break;
+                  }
+            }
+            return 0;
+         }
+
+         /**
+          * \brief execute <c> (honouring its iterations), with the noise
+          *    channel applied to all the qubits at each step
+          */
+         void execute(circuit * c)
+         {
+            std::vector<bool> measured(n_qubits);
+            for (size_t it=0; it<std::max<size_t>(c->get_iterations(),1); ++it)
+               for (size_t i=0; i<c->size(); ++i)
+               {
+                  gate *      g  = c->get(i);
+                  gate_type_t gt = g->type();
+                  if ((noise.empty() && !damping) || (gt == __display__) || (gt == __display_binary__))
+                  {
+                     apply(g);
+                     continue;
+                  }
+                  const std::vector<complex_t>& s = step_noise(g);
+                  const std::vector<complex_t>& m = ((damping || measurement_noise.empty()) ? s : measurement_noise);
+                  measured.assign(n_qubits,false);
+                  measured_qubits(g,measured);
+                  for (size_t q=0; q<n_qubits; ++q)
+                     if (measured[q])
+                        apply_noise(q,m);
+                  apply(g);
+                  for (size_t q=0; q<n_qubits; ++q)
+                     if (!measured[q])
+                        apply_noise(q,s);
+               }
+         }
+
+         /**
+          * \brief non-zero elements of rho, one per line
+          */
+         std::string get_state()
+         {
+            std::stringstream ss;
+            uint64_t dim = (1ULL << n_qubits);
+            for (uint64_t c=0; c<dim; ++c)
+               for (uint64_t r=0; r<dim; ++r)
+               {
+                  complex_t e = get(r,c);
+                  if ((std::abs(e.re) > __amp_epsilon__) || (std::abs(e.im) > __amp_epsilon__))
+                     ss << "   " << std::showpos << std::setw(7) << e << " |" << qu_register::to_binary_string(r,n_qubits) << "><" << qu_register::to_binary_string(c,n_qubits) << "|\n";
+               }
+            return ss.str();
+         }
+
+         /**
+          * \brief dump the probabilities of the basis states (unless
+          *    <only_binary>) and the exact measurement averaging
+          */
+         void dump(bool only_binary=false)
+         {
+            if (!only_binary)
+            {
+               println("--------------[density matrix]------------- ");
+               std::streamsize stream_size = std::cout.precision();
+               std::cout.precision(7);
+               std::cout << std::fixed;
+               uint64_t dim = (1ULL << n_qubits);
+               for (uint64_t i=0; i<dim; ++i)
+               {
+                  double p = get(i,i).re;
+                  if (p > __amp_epsilon__)
+                     println("  [p = " << p << "] |" << qu_register::to_binary_string(i,n_qubits) << "><" << qu_register::to_binary_string(i,n_qubits) << "|");
+               }
+               println("  [purity = " << purity() << "]");
+               std::cout.precision(stream_size);
+            }
+            println("------------------------------------------- ");
+            print("[>>] measurement averaging (ground state) :");
+            print(" ");
+            for (int i=n_qubits-1; i>=0; --i)
+            {
+               double gs = ground_states[i];
+               double es = excited_states[i];
+               double av = ((es+gs) != 0. ? (gs/(es+gs)) : 0.);
+               print(" | " << std::setw(9) << av);
+            }
+            println(" |");
+            println("------------------------------------------- ");
+         }
+   };
+
+   /**
+    * \brief whether a density matrix run is cheaper than <shots> noisy
+    *    trajectories on <qubits> qubits : each gate costs one pass over
+    *    the 4^n elements plus one per qubit for the channel, against one
+    *    pass over 2^n amplitudes per shot
+    */
+   inline bool density_matrix_preferred(size_t qubits, size_t shots)
+   {
+      return (qubits <= __density_auto_max_qubits__) && (((1ULL << qubits)*(qubits+1)) < shots);
+   }
+}
+
+#endif // QX_DENSITY_MATRIX_H
@@ -2,6 +2,7 @@
 #define QX_DEPOLARIZING_CHANNEL_H
 
 #include <random>
+#include <cmath>
 #include "qx/compat.h"
 #include "qx/core/error_injector.h"
 
@@ -18,9 +19,11 @@ namespace qx
 
    
    /**
-    * \brief depolarizing channel implementation
+    * \brief depolarizing channel implementation : errors are either injected
+    *    in a new circuit (inject()) or applied to the register while the
+    *    circuit executes, when the channel is used as its execution hook
     */
-   class depolarizing_channel : public error_injector
+   class depolarizing_channel : public error_injector, public execution_hook
    {
       public:
 
@@ -48,7 +51,7 @@ namespace qx
             y_errors = 0;
 
             QX_SRAND(xpu::timer().current());
-            qx::circuit * noisy_c = new qx::circuit(nq,c->id() + "(noisy)");
+            create_error_gates();
          }
         
 
@@ -76,7 +79,17 @@ namespace qx
            y_errors = 0;
 
            QX_SRAND(xpu::timer().current());
-           qx::circuit * noisy_c = new qx::circuit(nq,c->id() + "(noisy)");
+           create_error_gates();
+        }
+
+        /**
+         * dtor
+         */
+        ~depolarizing_channel()
+        {
+           for (size_t t=0; t<3; ++t)
+              for (size_t q=0; q<error_gates[t].size(); ++q)
+                 delete error_gates[t][q];
         }
 
         /**
@@ -104,6 +117,10 @@ namespace qx
            return r;
         }
 
+        /**
+         * \brief whether <g> measures qubit <q> : called for each faulty
+         *    step, so nothing is copied
+         */
         bool is_measurement(qx::gate * g, size_t q)
         {
            if (g->type() == __measure_reg_gate__)
@@ -112,12 +129,12 @@ namespace qx
            }
            if (g->type() == __measure_gate__)
            {
-              if (g->qubits()[0] == q)
+              if (((qx::measure *)g)->get_qubit() == q)
                  return true;
            }
            if (g->type() == __parallel_gate__)
            {
-              std::vector<qx::gate *> gates = ((qx::parallel_gates*)g)->get_gates();
+              const std::vector<qx::gate *>& gates = ((qx::parallel_gates*)g)->gate_list();
               for (size_t i=0; i<gates.size(); ++i)
               {
                  if (is_measurement(gates[i],q))
@@ -127,6 +144,16 @@ namespace qx
            return false;
         }
 
+        /**
+         * \brief restart the random streams of the channel from <s>, so
+         *    that concurrent channels draw independent errors
+         */
+        void seed(uint64_t s)
+        {
+           urg.seed(s);
+           nrg.seed(s ^ 0x9e3779b97f4a7c15ULL);
+        }
+
         /**
          * \brief enable error recording
          */
@@ -204,7 +231,7 @@ namespace qx
 
                  for (size_t i=2; i<(nq+1); ++i)
                  {
-                    if (x>error_probability(nq,i,pe))
+                    if (x>simultaneous_error_probability[i])
                        break;
                     affected_qubits++;
                  }
@@ -222,7 +249,7 @@ namespace qx
                  if (affected_qubits==1)
                  {
                     // size_t q = idle[(rand()%idle_nq)];
-                    size_t q = rand()%nq;
+                    size_t q = random_qubit();
 
                     if (is_measurement(c->get(p),q))
                     {
@@ -248,9 +275,9 @@ namespace qx
                     for (size_t i=0; i<affected_qubits; ++i)
                     { 
                        // size_t q = idle[(rand()%idle_nq)];
-                       size_t q = rand()%nq;
+                       size_t q = random_qubit();
                        while (v[q])
-                          q = rand()%nq;
+                          q = random_qubit();
                        // q = idle[(rand()%idle_nq)];
                        v[q] = 1;
 
@@ -284,6 +311,97 @@ namespace qx
         }
 
 
+        /**
+         * \brief sample the errors hitting the qubits at <step> of the circuit
+         *    (gate <g>), knowing that the step is faulty : <x> is uniform in
+         *    [0,overall error probability). the errors can be read with
+         *    get_sampled_error() until the next call.
+         * \return the number of affected qubits ; <before> is set when the
+         *    errors act before the gate (measurement errors)
+         */
+        size_t sample_errors(qx::gate * g, size_t step, double x, bool& before)
+        {
+           size_t affected_qubits = 1;
+           for (size_t i=2; i<(nq+1); ++i)
+           {
+              if (x>simultaneous_error_probability[i])
+                 break;
+              affected_qubits++;
+           }
+           total_errors += affected_qubits;
+           error_histogram[affected_qubits]++;
+           if (error_recording)
+           {
+              for (size_t e=0; e<affected_qubits; ++e)
+                 error_location.push_back(step);
+           }
+
+           before = false;
+           if (affected_qubits==1)
+           {
+              size_t q = random_qubit();
+              before = is_measurement(g,q);
+              pending_types[0]  = (before ? measurement_error_type(q) : single_qubit_error_type(q));
+              pending_qubits[0] = q;
+              return 1;
+           }
+
+           for (size_t i=0; i<affected_qubits; ++i)
+           {
+              size_t q = random_qubit();
+              while (affected[q])
+                 q = random_qubit();
+              affected[q] = true;
+              if (is_measurement(g,q))
+                 before = true;
+              pending_types[i]  = single_qubit_error_type(q);
+              pending_qubits[i] = q;
+           }
+           for (size_t i=0; i<affected_qubits; ++i)
+              affected[pending_qubits[i]] = false;
+           return affected_qubits;
+        }
+
+        /**
+         * \brief <i>-th error drawn by the last sample_errors(), on qubit <q>
+         */
+        error_type_t get_sampled_error(size_t i, size_t& q)
+        {
+           q = pending_qubits[i];
+           return pending_types[i];
+        }
+
+        /**
+         * \brief apply gate <g> at <step> of the circuit to <reg>, followed
+         *    (or preceded for measurement errors) by the sampled pauli
+         *    errors : nothing is allocated on the way
+         */
+        void apply(qx::gate * g, size_t step, qx::qu_register& reg)
+        {
+           qx::gate_type_t gt = g->type();
+           if ((gt==qx::__display__) || (gt==qx::__display_binary__))
+           {
+              g->apply(reg);
+              return;
+           }
+
+           double x = uniform_rand();
+           if (x>=overall_error_probability)
+           {
+              g->apply(reg);
+              return;
+           }
+
+           bool   before;
+           size_t n = sample_errors(g,step,x,before);
+           if (!before)
+              g->apply(reg);
+           for (size_t i=0; i<n; ++i)
+              error_gates[pending_types[i]][pending_qubits[i]]->apply(reg);
+           if (before)
+              g->apply(reg);
+        }
+
         /**
          * \brief total errors
          * \return total errors
@@ -331,6 +449,15 @@ namespace qx
            return urg.next();
         }
 
+        /**
+         * uniformly drawn qubit, from the channel's own stream
+         */
+        size_t random_qubit()
+        {
+           size_t q = (size_t)(uniform_rand()*nq);
+           return (q < nq ? q : nq-1);
+        }
+
         /**
          * normal random number generator
          */
@@ -342,9 +469,9 @@ namespace qx
         }
 
         /**
-         * single qubit error 
+         * \brief draw the type of a single qubit error on <q>
          */
-        qx::gate * single_qubit_error(size_t q, bool verbose=false)
+        error_type_t single_qubit_error_type(size_t q, bool verbose=false)
         {
            double p = uniform_rand();
            if (p<xp)
@@ -353,7 +480,7 @@ namespace qx
               if (error_recording)
                  errors.push_back(error_t(__x_error__,q));
               x_errors++;
-              return new qx::pauli_x(q);
+              return __x_error__;
            }
            else if (p<(zp+xp))
            {
@@ -361,7 +488,7 @@ namespace qx
               if (error_recording)
                  errors.push_back(error_t(__z_error__,q));
               z_errors++;
-              return new qx::pauli_z(q);
+              return __z_error__;
            }
            else
            {
@@ -369,48 +496,78 @@ namespace qx
               if (error_recording)
                  errors.push_back(error_t(__y_error__,q));
               y_errors++;
-              return new qx::pauli_y(q);
+              return __y_error__;
            }
         }
 
         /**
-         * measurement error 
+         * single qubit error 
          */
-        qx::gate * measurement_error(size_t q, bool verbose=false)
+        qx::gate * single_qubit_error(size_t q, bool verbose=false)
+        {
+           switch (single_qubit_error_type(q,verbose))
+           {
+              case __x_error__ : return new qx::pauli_x(q);
+              case __z_error__ : return new qx::pauli_z(q);
+              default          : return new qx::pauli_y(q);
+           }
+        }
+
+        /**
+         * \brief record a measurement error (bit flip) on <q>
+         */
+        error_type_t measurement_error_type(size_t q, bool verbose=false)
         {
            __verbose__ println(" (measurement error) ");
            if (error_recording)
               errors.push_back(error_t(__x_error__,q));
-           return new qx::pauli_x(q);
+           return __x_error__;
         }
 
-
         /**
-         * factorial
+         * measurement error 
          */
-        size_t factorial(size_t n)
+        qx::gate * measurement_error(size_t q, bool verbose=false)
         {
-           return (n == 1 || n == 0) ? 1 : factorial(n - 1) * n;
+           measurement_error_type(q,verbose);
+           return new qx::pauli_x(q);
         }
 
         /**
-         * combinations
+         * \brief pauli gates and scratch space used by apply(), and the
+         *    probabilities of simultaneous errors
          */
-        size_t combinations(size_t n, size_t k)
+        void create_error_gates()
         {
-           return (factorial(n)/(factorial(k)*factorial(n-k)));
+           simultaneous_error_probability.assign(nq+1,0);
+           for (size_t i=1; i<(nq+1); ++i)
+              simultaneous_error_probability[i] = error_probability(nq,i,pe);
+           for (size_t q=0; q<nq; ++q)
+           {
+              error_gates[__x_error__].push_back(new qx::pauli_x(q));
+              error_gates[__z_error__].push_back(new qx::pauli_z(q));
+              error_gates[__y_error__].push_back(new qx::pauli_y(q));
+           }
+           affected.assign(nq,false);
+           pending_types.assign(nq,__x_error__);
+           pending_qubits.assign(nq,0);
         }
 
         /**
          * nq : total number of qubits
          * ne : number of simultaneously affected qubits
          * p  : probability of single error
+         * the binomial term is computed from its logarithm : the
+         * combinations overflow an integer above 20 qubits
          */
         double error_probability(size_t nq, size_t ne, double p)
         {
-           double c = (double)combinations(nq,ne);
-           double res = c*std::pow(p,ne)*std::pow(1-p,nq-ne);
-           return res;
+           if (p <= 0)
+              return (ne == 0) ? 1 : 0;
+           if (p >= 1)
+              return (ne == nq) ? 1 : 0;
+           double lc = std::lgamma(nq+1.0) - std::lgamma(ne+1.0) - std::lgamma(nq-ne+1.0);
+           return std::exp(lc + ne*std::log(p) + (nq-ne)*std::log1p(-p));
         }
 
       private:
@@ -432,6 +589,7 @@ namespace qx
         double               zp;
 
         double               overall_error_probability;
+        std::vector<double>  simultaneous_error_probability;
         size_t               total_errors;
         histogram_t          error_histogram;
 
@@ -442,6 +600,11 @@ namespace qx
         size_t               z_errors;
         size_t               y_errors;
 
+        std::vector<qx::gate *>   error_gates[3];
+        std::vector<bool>         affected;
+        std::vector<error_type_t> pending_types;
+        std::vector<size_t>       pending_qubits;
+
    };
 }
 
@@ -3,6 +3,12 @@
 
 #include "qx/core/error_injector.h"
 #include "qx/core/depolarizing_channel.h"
+#include "qx/core/damping_channel.h"
+
+#include <random>
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
 
 namespace qx
 {
@@ -13,20 +19,189 @@ namespace qx
    {
       __depolarizing_channel__,
       __amplitude_damping__,
+      __phase_damping__,
       __unknown_error_model__
    } error_model_t;
 
 
-   qx::circuit * noisy_dep_ch(qx::circuit * c, double p, size_t& total_errors)
+   /**
+    * \brief relaxation times of the damping error models :
+    *    "amplitude_damping, t1[, t2]" and "phase_damping, t2", in the
+    *    units of the gate durations
+    * \return false if the parameters are invalid (t2 > 2*t1)
+    */
+   inline bool damping_times(error_model_t model, const std::vector<double>& parameters, double& t1, double& t2)
+   {
+      t1 = 0;
+      t2 = 0;
+      if (parameters.empty())
+         return false;
+      if (model == __amplitude_damping__)
+      {
+         t1 = parameters[0];
+         t2 = (parameters.size() > 1 ? parameters[1] : 2*t1);
+         return ((t1 > 0) && (t2 > 0) && (t2 <= 2*t1));
+      }
+      if (model == __phase_damping__)
+      {
+         t2 = parameters[0];
+         return (t2 > 0);
+      }
+      return false;
+   }
+
+   /**
+    * \brief execute <c> on <reg> with the errors of a depolarizing channel
+    *    of probability <p> applied on the fly
+    */
+   void execute_dep_ch(qx::circuit * c, qx::qu_register& reg, double p, size_t& total_errors, bool silent=false)
+   {
+      if (!c || (c->size() == 0))
+         return;
+      qx::depolarizing_channel dep_ch(c, c->get_qubit_count(), p);
+      c->execute(reg, dep_ch, silent);
+      total_errors += dep_ch.get_total_errors();
+   }
+
+   /**
+    * \brief number of trajectories that can run concurrently on registers
+    *    of <qubits> qubits : at most <threads> (0 : all the openmp threads),
+    *    and no more registers than fit in <memory_budget> bytes (0 : no limit)
+    */
+   inline size_t trajectory_workers(size_t qubits, qx::precision_t precision, size_t threads, size_t memory_budget)
+   {
+#ifdef USE_OPENMP
+      size_t workers = (threads ? threads : omp_get_max_threads());
+#else
+      size_t workers = 1;
+#endif
+      if (memory_budget)
+      {
+         size_t amplitude = (precision == __single_precision__ ? sizeof(complex_f_t) : sizeof(complex_t));
+         size_t fit = memory_budget / ((1ULL << qubits)*amplitude);
+         workers = std::min(workers, fit);
+      }
+      return std::max<size_t>(workers, 1);
+   }
+
+   /**
+    * \brief run <shots> noisy trajectories of <circuits>, spread over
+    *    <workers> concurrent workers : each worker owns its register, error
+    *    channels (built by <create> for each circuit) and random streams and
+    *    measures all the qubits at the end of every trajectory. the per-qubit
+    *    measurement statistics of all the workers are merged into <reg>, and
+    *    the state and outcomes of the last shot (run by the last worker)
+    *    are left in it, as after a sequential run.
+    */
+   template <typename channel_t, typename factory_t>
+   void run_trajectories(std::vector<qx::circuit*>& circuits, qx::qu_register& reg, size_t shots, size_t workers, size_t& total_errors, factory_t create)
    {
-      if (c)
+      size_t qubits = reg.size();
+      size_t nc     = circuits.size();
+      workers = std::max<size_t>(std::min(workers, shots), 1);
+
+      // channels are built upfront, their constructor isn't thread safe
+      std::vector<channel_t *>       channels(workers*nc, NULL);
+      std::vector<qx::qu_register *> registers(workers, NULL);
+      uint64_t seed = std::random_device()() ^ (uint64_t)(xpu::timer().current()*1e6);
+      for (size_t w=0; w<workers; ++w)
+      {
+         registers[w] = (w ? new qx::qu_register(qubits, reg.get_precision()) : &reg);
+         registers[w]->seed(seed + 2*w*0x9e3779b97f4a7c15ULL);
+         for (size_t i=0; i<nc; ++i)
+         {
+            if (circuits[i]->size() == 0)
+               continue;
+            channels[w*nc+i] = create(circuits[i]);
+            channels[w*nc+i]->seed(seed + (2*(w*nc+i)+1)*0x9e3779b97f4a7c15ULL);
+         }
+      }
+
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(workers) schedule(static,1)
+#endif
+      for (int64_t w=0; w<(int64_t)workers; ++w)
+      {
+         qx::qu_register& r = *registers[w];
+         qx::measure m;
+         size_t first = (shots*w)/workers;
+         size_t last  = (shots*(w+1))/workers;
+         for (size_t s=first; s<last; ++s)
+         {
+            r.reset();
+            for (size_t i=0; i<nc; ++i)
+               if (channels[w*nc+i])
+                  circuits[i]->execute(r,*channels[w*nc+i],true);
+            m.apply(r);
+         }
+      }
+
+      for (size_t w=0; w<workers; ++w)
       {
-         qx::depolarizing_channel dep_ch(c, c->get_qubit_count(), p);
-         qx::circuit * noisy_c = dep_ch.inject(false); //true);
-         total_errors += dep_ch.get_total_errors();
-         return noisy_c;
+         for (size_t i=0; i<nc; ++i)
+         {
+            if (!channels[w*nc+i])
+               continue;
+            total_errors += channels[w*nc+i]->get_total_errors();
+            delete channels[w*nc+i];
+         }
+         if (!w)
+            continue;
+         for (size_t q=0; q<qubits; ++q)
+         {
+            reg.measurement_averaging[q].ground_states += registers[w]->measurement_averaging[q].ground_states;
+            reg.measurement_averaging[q].exited_states += registers[w]->measurement_averaging[q].exited_states;
+         }
+         if (w == workers-1)
+         {
+            qx::qu_register& r = *registers[w];
+            if (reg.single_precision())
+               std::copy(r.get_data_f().begin(), r.get_data_f().end(), reg.get_data_f().begin());
+            else
+               std::copy(r.get_data().begin(), r.get_data().end(), reg.get_data().begin());
+            for (size_t q=0; q<qubits; ++q)
+            {
+               reg.set_measurement(q, r.get_measurement(q));
+               reg.set_measurement_prediction(q, r.get_measurement_prediction(q));
+            }
+         }
+         delete registers[w];
       }
-      return NULL;
+   }
+
+   /**
+    * \brief run <shots> noisy trajectories of <circuits> under a depolarizing
+    *    channel of probability <p> (see run_trajectories())
+    */
+   void run_dep_ch_trajectories(std::vector<qx::circuit*>& circuits, qx::qu_register& reg, double p, size_t shots, size_t workers, size_t& total_errors)
+   {
+      size_t qubits = reg.size();
+      run_trajectories<qx::depolarizing_channel>(circuits, reg, shots, workers, total_errors,
+                                                 [=](qx::circuit * c) { return new qx::depolarizing_channel(c, qubits, p); });
+   }
+
+   /**
+    * \brief run <shots> quantum-jump trajectories of <circuits> under the
+    *    damping of relaxation times <t1> and <t2> (see run_trajectories())
+    */
+   void run_damping_trajectories(std::vector<qx::circuit*>& circuits, qx::qu_register& reg, double t1, double t2, size_t shots, size_t workers, size_t& total_errors)
+   {
+      size_t qubits = reg.size();
+      run_trajectories<qx::damping_channel>(circuits, reg, shots, workers, total_errors,
+                                            [=](qx::circuit * c) { return new qx::damping_channel(qubits, t1, t2); });
+   }
+
+   /**
+    * \brief execute <c> on <reg> with the damping of relaxation times <t1>
+    *    and <t2> applied on the fly
+    */
+   void execute_damping(qx::circuit * c, qx::qu_register& reg, double t1, double t2, size_t& total_errors, bool silent=false)
+   {
+      if (!c || (c->size() == 0))
+         return;
+      qx::damping_channel channel(reg.size(), t1, t2);
+      c->execute(reg, channel, silent);
+      total_errors += channel.get_total_errors();
    }
 
 };
@@ -17,6 +17,7 @@
 #include <emmintrin.h> // sse
 
 #include <algorithm>
+#include <stdexcept>
 
 #include "qx/core/hash_set.h"
 #include "qx/core/linalg.h"
@@ -26,6 +27,7 @@
 #include "qx/core/kronecker.h"
 
 #include "qx/compat.h"
+#include "qx/xpu/isa.h"
 
 #include <chrono>
 
@@ -99,7 +101,12 @@ namespace qx
       __classical_not_gate__,
       __qft_gate__,
       __prepare_gate__,
-      __unitary_gate__
+      __unitary_gate__,
+      __dense_unitary_gate__,
+      __diagonal_unitary_gate__,
+      __permutation_gate__,
+      __tiled_gates__,
+      __controlled_unitary_gate__
    } gate_type_t;
 
 
@@ -120,6 +127,8 @@ namespace qx
 
    #define __rc(r,c,s) (r*s+c)
 
+   #define __single_eps__ (1e-12)
+
    /**
     * \brief common abstract gate interface for
     *   all gates implementation.
@@ -127,6 +136,8 @@ namespace qx
    class gate
    {
 	 public:
+
+	                                  gate() : duration(0) { }
 	   
 	   virtual int64_t                apply(qu_register& qureg) = 0;
 	   virtual std::vector<uint64_t>  qubits() = 0;
@@ -137,11 +148,46 @@ namespace qx
 	   virtual void                   dump() = 0;
 	   virtual                        ~gate() { };                
 
+	   /**
+	    * \brief matrix of a single-qubit gate, or of the target of a
+	    *    controlled gate, used by the fusion passes
+	    * \return false if the gate does not reduce to a 2x2 matrix
+	    */
+	   virtual bool                   get_matrix(cmatrix_t& m) { return false; }
+
+	   /**
+	    * \brief check whether the gate only changes the phases of the
+	    *    basis states, in which case get_matrix() (if any) is diagonal
+	    *    and the gate commutes with the other diagonal gates
+	    */
+	   virtual bool                   is_diagonal() { return false; }
+
+	   /**
+	    * \brief permutation of the qubits of a gate which only moves the
+	    *    qubit states around (swap...) : the state of qubits()[k] ends
+	    *    on qubit dest[k]. used by the permutation fusion.
+	    * \return false if the gate is not a permutation of its qubits
+	    */
+	   virtual bool                   get_permutation(std::vector<uint64_t>& dest) { return false; }
+
+	   /**
+	    * \brief phases of a diagonal gate on the basis states of qubits()
+	    *    (bit j of an index of <d> refers to qubits()[j])
+	    * \return false if the gate does not expose its diagonal
+	    */
+	   virtual bool                   get_diagonal(std::vector<complex_t>& d) { return false; }
+
 	   virtual void                   set_duration(uint64_t d) { duration = d; }
 	   virtual uint64_t               get_duration() { return duration; }
 	 
 	 protected:
 
+	   /**
+	    * \brief apply the gate to a register of any precision through
+	    *    its matrix (see get_matrix() and cu_apply())
+	    */
+	   int64_t                        apply_matrix(qu_register& qreg);
+
 	   uint64_t                       duration;
 
    };
@@ -289,22 +335,17 @@ namespace qx
 
    }
 
-   void __apply_m(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const std::size_t stride0, const std::size_t stride1, const complex_t * matrix)
+   /**
+    * \brief generic 2x2 matrix kernel, on complex_t arithmetic : the
+    *    fallback of the avx2 and avx-512 kernels
+    */
+   void __apply_m_generic(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const std::size_t stride0, const std::size_t stride1, const complex_t * matrix)
    {
-
-#if 0
-      __m128d m00 = matrix[0].xmm;
-      __m128d m01 = matrix[1].xmm;
-      __m128d m10 = matrix[2].xmm;
-      __m128d m11 = matrix[3].xmm;
-#endif
-
       complex_t m00 = matrix[0];
       complex_t m01 = matrix[1];
       complex_t m10 = matrix[2];
       complex_t m11 = matrix[3];
 
-
 #ifdef USE_OPENMP
 #pragma omp parallel for // shared(m00,m01,m10,m11)
 #endif
@@ -318,18 +359,357 @@ namespace qx
             complex_t in1 = state[i1];
             state[i0] = m00*in0+m01*in1;
             state[i1] = m10*in0+m11*in1;
-#if 0
-            __m128d in0 = state[i0].xmm;
-            __m128d in1 = state[i1].xmm;
-            state[i0].xmm = _mm_add_pd(xpu::_mm_mulc_pd(m00, in0), xpu::_mm_mulc_pd(m10, in1));
-            state[i1].xmm = _mm_add_pd(xpu::_mm_mulc_pd(m10, in1), xpu::_mm_mulc_pd(m11, in1));
+         }
+   }
+
+   /**
+    * the avx2/avx-512 kernels below compute m*x as x*re(m) + swap(x)*(im(m),-im(m)) :
+    * complex_d is stored as (im,re), so after swapping the two halves of each
+    * amplitude the imaginary part of the coefficient is added to the imaginary
+    * lane and subtracted from the real lane, which keeps the whole 2x2 product
+    * in fused multiply-adds.
+    */
+   #define __cre__(c)  (c).re
+   #define __cim__(c)  (c).im
+
+   /**
+    * \brief 2x2 matrix broadcast over 256-bit registers
+    */
+   struct __m2x2_avx2
+   {
+      __m256d r[4];
+      __m256d i[4];
+   };
+
+   QX_TARGET_AVX2 inline void __load_m_avx2(const complex_t * matrix, __m2x2_avx2 & m)
+   {
+      for (size_t k=0; k<4; ++k)
+      {
+         m.r[k] = _mm256_set1_pd(__cre__(matrix[k]));
+         m.i[k] = _mm256_set_pd(-__cim__(matrix[k]), __cim__(matrix[k]), -__cim__(matrix[k]), __cim__(matrix[k]));
+      }
+   }
+
+   /**
+    * \brief apply m to two consecutive amplitude pairs (p0[0..1],p1[0..1])
+    */
+   QX_TARGET_AVX2 inline void __pair_m_avx2(double * p0, double * p1, const __m2x2_avx2 & m)
+   {
+      __m256d  a  = _mm256_loadu_pd(p0);
+      __m256d  b  = _mm256_loadu_pd(p1);
+      __m256d  as = _mm256_permute_pd(a, 5);
+      __m256d  bs = _mm256_permute_pd(b, 5);
+      __m256d  o0 = _mm256_mul_pd(bs, m.i[1]);
+      __m256d  o1 = _mm256_mul_pd(bs, m.i[3]);
+      o0 = _mm256_fmadd_pd(as, m.i[0], o0);
+      o1 = _mm256_fmadd_pd(as, m.i[2], o1);
+      o0 = _mm256_fmadd_pd(b, m.r[1], o0);
+      o1 = _mm256_fmadd_pd(b, m.r[3], o1);
+      o0 = _mm256_fmadd_pd(a, m.r[0], o0);
+      o1 = _mm256_fmadd_pd(a, m.r[2], o1);
+      _mm256_storeu_pd(p0, o0);
+      _mm256_storeu_pd(p1, o1);
+   }
+
+// gcc 12 reports the undefined vector _mm512_permute_pd and
+// _mm512_shuffle_f64x2 start from as uninitialized (false positive)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+   /**
+    * \brief 2x2 matrix broadcast over 512-bit registers
+    */
+   struct __m2x2_avx512
+   {
+      __m512d r[4];
+      __m512d i[4];
+   };
+
+   QX_TARGET_AVX512 inline void __load_m_avx512(const complex_t * matrix, __m2x2_avx512 & m)
+   {
+      for (size_t k=0; k<4; ++k)
+      {
+         m.r[k] = _mm512_set1_pd(__cre__(matrix[k]));
+         m.i[k] = _mm512_set_pd(-__cim__(matrix[k]), __cim__(matrix[k]), -__cim__(matrix[k]), __cim__(matrix[k]),
+                                -__cim__(matrix[k]), __cim__(matrix[k]), -__cim__(matrix[k]), __cim__(matrix[k]));
+      }
+   }
+
+   /**
+    * \brief apply m to four consecutive amplitude pairs (p0[0..3],p1[0..3])
+    */
+   QX_TARGET_AVX512 inline void __pair_m_avx512(double * p0, double * p1, const __m2x2_avx512 & m)
+   {
+      __m512d  a  = _mm512_loadu_pd(p0);
+      __m512d  b  = _mm512_loadu_pd(p1);
+      __m512d  as = _mm512_permute_pd(a, 0x55);
+      __m512d  bs = _mm512_permute_pd(b, 0x55);
+      __m512d  o0 = _mm512_mul_pd(bs, m.i[1]);
+      __m512d  o1 = _mm512_mul_pd(bs, m.i[3]);
+      o0 = _mm512_fmadd_pd(as, m.i[0], o0);
+      o1 = _mm512_fmadd_pd(as, m.i[2], o1);
+      o0 = _mm512_fmadd_pd(b, m.r[1], o0);
+      o1 = _mm512_fmadd_pd(b, m.r[3], o1);
+      o0 = _mm512_fmadd_pd(a, m.r[0], o0);
+      o1 = _mm512_fmadd_pd(a, m.r[2], o1);
+      _mm512_storeu_pd(p0, o0);
+      _mm512_storeu_pd(p1, o1);
+   }
+
+   /**
+    * \brief generic 2x2 matrix kernel (avx2) : two amplitude pairs per iteration
+    *    on qubit >= 1, one adjacent pair per iteration on qubit 0
+    */
+   QX_TARGET_AVX2 void __apply_m_avx2(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const complex_t * matrix)
+   {
+      double *  s     = (double *)state;
+      int64_t   pairs = (int64_t)((end-start) >> 1);
+
+      if (qubit == 0)
+      {
+         // (in0,in1) share a register : broadcast each input to both halves
+         // and multiply by the matching column of the matrix
+         __m256d c0r = _mm256_set_pd( __cre__(matrix[2]), __cre__(matrix[2]),  __cre__(matrix[0]), __cre__(matrix[0]));
+         __m256d c0i = _mm256_set_pd(-__cim__(matrix[2]), __cim__(matrix[2]), -__cim__(matrix[0]), __cim__(matrix[0]));
+         __m256d c1r = _mm256_set_pd( __cre__(matrix[3]), __cre__(matrix[3]),  __cre__(matrix[1]), __cre__(matrix[1]));
+         __m256d c1i = _mm256_set_pd(-__cim__(matrix[3]), __cim__(matrix[3]), -__cim__(matrix[1]), __cim__(matrix[1]));
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+         for (int64_t k=0; k<pairs; ++k)
+         {
+            double * p  = s + 2*(start + 2*k);
+            __m256d  v  = _mm256_loadu_pd(p);
+            __m256d  v0 = _mm256_permute2f128_pd(v, v, 0x00);
+            __m256d  v1 = _mm256_permute2f128_pd(v, v, 0x11);
+            __m256d  r  = _mm256_mul_pd(_mm256_permute_pd(v1, 5), c1i);
+            r = _mm256_fmadd_pd(_mm256_permute_pd(v0, 5), c0i, r);
+            r = _mm256_fmadd_pd(v1, c1r, r);
+            r = _mm256_fmadd_pd(v0, c0r, r);
+            _mm256_storeu_pd(p, r);
+         }
+         return;
+      }
+
+      __m2x2_avx2 m;
+      __load_m_avx2(matrix, m);
+      size_t mask = (1UL << qubit) - 1;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<pairs; k+=2)
+      {
+         size_t i0 = start + ((k >> qubit) << (qubit+1)) + (k & mask);
+         __pair_m_avx2(s + 2*i0, s + 2*(i0 + (1UL << qubit)), m);
+      }
+   }
+
+   /**
+    * \brief generic 2x2 matrix kernel (avx-512) : four amplitude pairs per
+    *    iteration on qubit >= 2, two adjacent pairs per iteration on qubit 0
+    */
+   QX_TARGET_AVX512 void __apply_m_avx512(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const complex_t * matrix)
+   {
+      double *  s     = (double *)state;
+      int64_t   pairs = (int64_t)((end-start) >> 1);
+
+      if (qubit == 0)
+      {
+         // (in0,in1,in0',in1') : broadcast the inputs of each pair over its
+         // two 128-bit lanes and multiply by the matching matrix column
+         __m512d c0r = _mm512_set_pd( __cre__(matrix[2]), __cre__(matrix[2]),  __cre__(matrix[0]), __cre__(matrix[0]),
+                                      __cre__(matrix[2]), __cre__(matrix[2]),  __cre__(matrix[0]), __cre__(matrix[0]));
+         __m512d c0i = _mm512_set_pd(-__cim__(matrix[2]), __cim__(matrix[2]), -__cim__(matrix[0]), __cim__(matrix[0]),
+                                     -__cim__(matrix[2]), __cim__(matrix[2]), -__cim__(matrix[0]), __cim__(matrix[0]));
+         __m512d c1r = _mm512_set_pd( __cre__(matrix[3]), __cre__(matrix[3]),  __cre__(matrix[1]), __cre__(matrix[1]),
+                                      __cre__(matrix[3]), __cre__(matrix[3]),  __cre__(matrix[1]), __cre__(matrix[1]));
+         __m512d c1i = _mm512_set_pd(-__cim__(matrix[3]), __cim__(matrix[3]), -__cim__(matrix[1]), __cim__(matrix[1]),
+                                     -__cim__(matrix[3]), __cim__(matrix[3]), -__cim__(matrix[1]), __cim__(matrix[1]));
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
 #endif
+         for (int64_t k=0; k<pairs; k+=2)
+         {
+            double * p  = s + 2*(start + 2*k);
+            __m512d  v  = _mm512_loadu_pd(p);
+            __m512d  v0 = _mm512_shuffle_f64x2(v, v, 0xA0);
+            __m512d  v1 = _mm512_shuffle_f64x2(v, v, 0xF5);
+            __m512d  r  = _mm512_mul_pd(_mm512_permute_pd(v1, 0x55), c1i);
+            r = _mm512_fmadd_pd(_mm512_permute_pd(v0, 0x55), c0i, r);
+            r = _mm512_fmadd_pd(v1, c1r, r);
+            r = _mm512_fmadd_pd(v0, c0r, r);
+            _mm512_storeu_pd(p, r);
+         }
+         return;
+      }
+
+      __m2x2_avx512 m;
+      __load_m_avx512(matrix, m);
+      size_t mask = (1UL << qubit) - 1;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<pairs; k+=4)
+      {
+         size_t i0 = start + ((k >> qubit) << (qubit+1)) + (k & mask);
+         __pair_m_avx512(s + 2*i0, s + 2*(i0 + (1UL << qubit)), m);
+      }
+   }
+
+   #undef __cre__
+   #undef __cim__
+
+   /**
+    * \brief generic 2x2 matrix kernel : selects the widest vector
+    *    implementation allowed by the active instruction set
+    */
+   void __apply_m(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const std::size_t stride0, const std::size_t stride1, const complex_t * matrix)
+   {
+      xpu::isa_t isa = xpu::get_isa();
+      size_t pairs = (end-start) >> 1;
+
+      if ((stride0 == 0) && (stride1 == (1UL << qubit)))
+      {
+         if ((isa == xpu::__isa_avx512__) && ((qubit >= 2) || ((qubit == 0) && (pairs >= 2))))
+         {
+            __apply_m_avx512(start, end, qubit, state, matrix);
+            return;
+         }
+         if (isa >= xpu::__isa_avx2__)
+         {
+            __apply_m_avx2(start, end, qubit, state, matrix);
+            return;
          }
+      }
+      __apply_m_generic(start, end, qubit, state, stride0, stride1, matrix);
+   }
+
+   /**
+    * \brief single precision kernel : 2x2 matrix <m> on qubit <t>, applied
+    *    to the pairs of amplitudes where all the bits of <cmask> are set
+    *    (0 for an uncontrolled gate)
+    */
+   void __apply_m_f_sse(complex_f_t * state, uint64_t n, uint64_t t, uint64_t cmask, cmatrix_t& m)
+   {
+      float    m00r = m(0,0).re, m00i = m(0,0).im, m01r = m(0,1).re, m01i = m(0,1).im;
+      float    m10r = m(1,0).re, m10i = m(1,0).im, m11r = m(1,1).re, m11i = m(1,1).im;
+      uint64_t step = (1UL << t);
+      int64_t  rs   = (int64_t)(1UL << (n-1));
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<rs; ++k)
+      {
+         uint64_t i0 = ((k >> t) << (t+1)) | (k & (step-1));
+         if ((i0 & cmask) != cmask)
+            continue;
+         complex_f_t& x0 = state[i0];
+         complex_f_t& x1 = state[i0+step];
+         float r0 = x0.re, j0 = x0.im, r1 = x1.re, j1 = x1.im;
+         x0.re = m00r*r0 - m00i*j0 + m01r*r1 - m01i*j1;
+         x0.im = m00r*j0 + m00i*r0 + m01r*j1 + m01i*r1;
+         x1.re = m10r*r0 - m10i*j0 + m11r*r1 - m11i*j1;
+         x1.im = m10r*j0 + m10i*r0 + m11r*j1 + m11i*r1;
+      }
+   }
+
+   /**
+    * \brief single precision kernel (avx2) : four amplitude pairs per
+    *    iteration, requires t >= 2 and no control on qubits 0 and 1
+    */
+   QX_TARGET_AVX2 void __apply_m_f_avx2(complex_f_t * state, uint64_t n, uint64_t t, uint64_t cmask, cmatrix_t& m)
+   {
+      // x*m = x*re(m) + swap(x)*(im(m),-im(m)) in the (im,re) layout
+      __m256   m00r = _mm256_set1_ps(m(0,0).re), m01r = _mm256_set1_ps(m(0,1).re);
+      __m256   m10r = _mm256_set1_ps(m(1,0).re), m11r = _mm256_set1_ps(m(1,1).re);
+      float    i00 = m(0,0).im, i01 = m(0,1).im, i10 = m(1,0).im, i11 = m(1,1).im;
+      __m256   m00i = _mm256_set_ps(-i00, i00, -i00, i00, -i00, i00, -i00, i00);
+      __m256   m01i = _mm256_set_ps(-i01, i01, -i01, i01, -i01, i01, -i01, i01);
+      __m256   m10i = _mm256_set_ps(-i10, i10, -i10, i10, -i10, i10, -i10, i10);
+      __m256   m11i = _mm256_set_ps(-i11, i11, -i11, i11, -i11, i11, -i11, i11);
+      uint64_t step = (1UL << t);
+      int64_t  rs   = (int64_t)(1UL << (n-1));
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<rs; k+=4)
+      {
+         uint64_t i0 = ((k >> t) << (t+1)) | (k & (step-1));
+         if ((i0 & cmask) != cmask)
+            continue;
+         float * p0 = (float *)(state + i0);
+         float * p1 = (float *)(state + i0 + step);
+         __m256 x0  = _mm256_loadu_ps(p0);
+         __m256 x1  = _mm256_loadu_ps(p1);
+         __m256 s0  = _mm256_permute_ps(x0, 0xb1);
+         __m256 s1  = _mm256_permute_ps(x1, 0xb1);
+         __m256 y0  = _mm256_fmadd_ps(x0, m00r, _mm256_fmadd_ps(s0, m00i, _mm256_fmadd_ps(x1, m01r, _mm256_mul_ps(s1, m01i))));
+         __m256 y1  = _mm256_fmadd_ps(x0, m10r, _mm256_fmadd_ps(s0, m10i, _mm256_fmadd_ps(x1, m11r, _mm256_mul_ps(s1, m11i))));
+         _mm256_storeu_ps(p0, y0);
+         _mm256_storeu_ps(p1, y1);
+      }
+   }
+
+   /**
+    * \brief single precision kernel (avx-512) : eight amplitude pairs per
+    *    iteration, requires t >= 3 and no control on qubits 0 to 2
+    */
+   QX_TARGET_AVX512 void __apply_m_f_avx512(complex_f_t * state, uint64_t n, uint64_t t, uint64_t cmask, cmatrix_t& m)
+   {
+      __m512   m00r = _mm512_set1_ps(m(0,0).re), m01r = _mm512_set1_ps(m(0,1).re);
+      __m512   m10r = _mm512_set1_ps(m(1,0).re), m11r = _mm512_set1_ps(m(1,1).re);
+      float    i00 = m(0,0).im, i01 = m(0,1).im, i10 = m(1,0).im, i11 = m(1,1).im;
+      __m512   m00i = _mm512_castpd_ps(_mm512_set1_pd(_mm_cvtsd_f64(_mm_castps_pd(_mm_set_ps(0, 0, -i00, i00)))));
+      __m512   m01i = _mm512_castpd_ps(_mm512_set1_pd(_mm_cvtsd_f64(_mm_castps_pd(_mm_set_ps(0, 0, -i01, i01)))));
+      __m512   m10i = _mm512_castpd_ps(_mm512_set1_pd(_mm_cvtsd_f64(_mm_castps_pd(_mm_set_ps(0, 0, -i10, i10)))));
+      __m512   m11i = _mm512_castpd_ps(_mm512_set1_pd(_mm_cvtsd_f64(_mm_castps_pd(_mm_set_ps(0, 0, -i11, i11)))));
+      uint64_t step = (1UL << t);
+      int64_t  rs   = (int64_t)(1UL << (n-1));
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<rs; k+=8)
+      {
+         uint64_t i0 = ((k >> t) << (t+1)) | (k & (step-1));
+         if ((i0 & cmask) != cmask)
+            continue;
+         float * p0 = (float *)(state + i0);
+         float * p1 = (float *)(state + i0 + step);
+         __m512 x0  = _mm512_loadu_ps(p0);
+         __m512 x1  = _mm512_loadu_ps(p1);
+         __m512 s0  = _mm512_permute_ps(x0, 0xb1);
+         __m512 s1  = _mm512_permute_ps(x1, 0xb1);
+         __m512 y0  = _mm512_fmadd_ps(x0, m00r, _mm512_fmadd_ps(s0, m00i, _mm512_fmadd_ps(x1, m01r, _mm512_mul_ps(s1, m01i))));
+         __m512 y1  = _mm512_fmadd_ps(x0, m10r, _mm512_fmadd_ps(s0, m10i, _mm512_fmadd_ps(x1, m11r, _mm512_mul_ps(s1, m11i))));
+         _mm512_storeu_ps(p0, y0);
+         _mm512_storeu_ps(p1, y1);
+      }
+   }
+
+   void __apply_m_f(complex_f_t * state, uint64_t n, uint64_t t, uint64_t cmask, cmatrix_t& m)
+   {
+      xpu::isa_t isa = xpu::get_isa();
+      if ((isa == xpu::__isa_avx512__) && (t >= 3) && !(cmask & 7))
+         __apply_m_f_avx512(state, n, t, cmask, m);
+      else if ((isa >= xpu::__isa_avx2__) && (t >= 2) && !(cmask & 3))
+         __apply_m_f_avx2(state, n, t, cmask, m);
+      else
+         __apply_m_f_sse(state, n, t, cmask, m);
    }
 
 #ifdef __SSE__
 // #ifdef __FMA__
-   void __apply_x(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const std::size_t stride0, const std::size_t stride1, const complex_t * matrix)
+   void __apply_x_sse(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const std::size_t stride0, const std::size_t stride1, const complex_t * matrix)
    {
 #ifdef USE_OPENMP
 #pragma omp parallel for // private(m00,r00,neg)    
@@ -354,11 +734,107 @@ namespace qx
 #error "SSE not available !"
 #endif // SSE
 
+   /**
+    * \brief pauli-x kernel (avx2) : swaps two amplitude pairs per iteration
+    */
+   QX_TARGET_AVX2 void __apply_x_avx2(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state)
+   {
+      double *  s     = (double *)state;
+      int64_t   pairs = (int64_t)((end-start) >> 1);
+
+      if (qubit == 0)
+      {
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+         for (int64_t k=0; k<pairs; ++k)
+         {
+            double * p = s + 2*(start + 2*k);
+            __m256d  v = _mm256_loadu_pd(p);
+            _mm256_storeu_pd(p, _mm256_permute2f128_pd(v, v, 0x01));
+         }
+         return;
+      }
+
+      size_t mask = (1UL << qubit) - 1;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<pairs; k+=2)
+      {
+         size_t   i0 = start + ((k >> qubit) << (qubit+1)) + (k & mask);
+         double * p0 = s + 2*i0;
+         double * p1 = s + 2*(i0 + (1UL << qubit));
+         __m256d  a  = _mm256_loadu_pd(p0);
+         _mm256_storeu_pd(p0, _mm256_loadu_pd(p1));
+         _mm256_storeu_pd(p1, a);
+      }
+   }
+
+   /**
+    * \brief pauli-x kernel (avx-512) : swaps four amplitude pairs per iteration
+    */
+   QX_TARGET_AVX512 void __apply_x_avx512(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state)
+   {
+      double *  s     = (double *)state;
+      int64_t   pairs = (int64_t)((end-start) >> 1);
+
+      if (qubit == 0)
+      {
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+         for (int64_t k=0; k<pairs; k+=2)
+         {
+            double * p = s + 2*(start + 2*k);
+            __m512d  v = _mm512_loadu_pd(p);
+            _mm512_storeu_pd(p, _mm512_shuffle_f64x2(v, v, 0xB1));
+         }
+         return;
+      }
+
+      size_t mask = (1UL << qubit) - 1;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<pairs; k+=4)
+      {
+         size_t   i0 = start + ((k >> qubit) << (qubit+1)) + (k & mask);
+         double * p0 = s + 2*i0;
+         double * p1 = s + 2*(i0 + (1UL << qubit));
+         __m512d  a  = _mm512_loadu_pd(p0);
+         _mm512_storeu_pd(p0, _mm512_loadu_pd(p1));
+         _mm512_storeu_pd(p1, a);
+      }
+   }
+
+   /**
+    * \brief pauli-x kernel : dispatch on the active instruction set
+    */
+   void __apply_x(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const std::size_t stride0, const std::size_t stride1, const complex_t * matrix)
+   {
+      xpu::isa_t isa = xpu::get_isa();
+      size_t pairs = (end-start) >> 1;
 
+      if ((stride0 == 0) && (stride1 == (1UL << qubit)))
+      {
+         if ((isa == xpu::__isa_avx512__) && ((qubit >= 2) || ((qubit == 0) && (pairs >= 2))))
+         {
+            __apply_x_avx512(start, end, qubit, state);
+            return;
+         }
+         if (isa >= xpu::__isa_avx2__)
+         {
+            __apply_x_avx2(start, end, qubit, state);
+            return;
+         }
+      }
+      __apply_x_sse(start, end, qubit, state, stride0, stride1, matrix);
+   }
 
 #ifdef __SSE__
 // #ifdef __FMA__
-   void __apply_h(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const std::size_t stride0, const std::size_t stride1, const complex_t * matrix)
+   void __apply_h_sse(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const std::size_t stride0, const std::size_t stride1, const complex_t * matrix)
    {
       __m128d   m00 = matrix[0].xmm;
       __m128d   r00 = _mm_shuffle_pd(m00,m00,3);         // 1 cyc
@@ -404,6 +880,116 @@ namespace qx
 #error "SSE not available !"
 #endif // SSE
 
+   /**
+    * \brief hadamard kernel (avx2) : out0 = r.(in0+in1), out1 = r.(in0-in1)
+    */
+   QX_TARGET_AVX2 void __apply_h_avx2(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const complex_t * matrix)
+   {
+      double *  s     = (double *)state;
+      int64_t   pairs = (int64_t)((end-start) >> 1);
+      double    r     = matrix[0].re;
+
+      if (qubit == 0)
+      {
+         __m256d sr = _mm256_set_pd(-r, -r, r, r);
+         __m256d rr = _mm256_set1_pd(r);
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+         for (int64_t k=0; k<pairs; ++k)
+         {
+            double * p  = s + 2*(start + 2*k);
+            __m256d  v  = _mm256_loadu_pd(p);
+            __m256d  sw = _mm256_permute2f128_pd(v, v, 0x01);
+            _mm256_storeu_pd(p, _mm256_fmadd_pd(v, sr, _mm256_mul_pd(sw, rr)));
+         }
+         return;
+      }
+
+      __m256d rr   = _mm256_set1_pd(r);
+      size_t  mask = (1UL << qubit) - 1;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<pairs; k+=2)
+      {
+         size_t   i0 = start + ((k >> qubit) << (qubit+1)) + (k & mask);
+         double * p0 = s + 2*i0;
+         double * p1 = s + 2*(i0 + (1UL << qubit));
+         __m256d  a  = _mm256_loadu_pd(p0);
+         __m256d  b  = _mm256_loadu_pd(p1);
+         _mm256_storeu_pd(p0, _mm256_mul_pd(_mm256_add_pd(a, b), rr));
+         _mm256_storeu_pd(p1, _mm256_mul_pd(_mm256_sub_pd(a, b), rr));
+      }
+   }
+
+   /**
+    * \brief hadamard kernel (avx-512)
+    */
+   QX_TARGET_AVX512 void __apply_h_avx512(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const complex_t * matrix)
+   {
+      double *  s     = (double *)state;
+      int64_t   pairs = (int64_t)((end-start) >> 1);
+      double    r     = matrix[0].re;
+
+      if (qubit == 0)
+      {
+         __m512d sr = _mm512_set_pd(-r, -r, r, r, -r, -r, r, r);
+         __m512d rr = _mm512_set1_pd(r);
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+         for (int64_t k=0; k<pairs; k+=2)
+         {
+            double * p  = s + 2*(start + 2*k);
+            __m512d  v  = _mm512_loadu_pd(p);
+            __m512d  sw = _mm512_shuffle_f64x2(v, v, 0xB1);
+            _mm512_storeu_pd(p, _mm512_fmadd_pd(v, sr, _mm512_mul_pd(sw, rr)));
+         }
+         return;
+      }
+
+      __m512d rr   = _mm512_set1_pd(r);
+      size_t  mask = (1UL << qubit) - 1;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<pairs; k+=4)
+      {
+         size_t   i0 = start + ((k >> qubit) << (qubit+1)) + (k & mask);
+         double * p0 = s + 2*i0;
+         double * p1 = s + 2*(i0 + (1UL << qubit));
+         __m512d  a  = _mm512_loadu_pd(p0);
+         __m512d  b  = _mm512_loadu_pd(p1);
+         _mm512_storeu_pd(p0, _mm512_mul_pd(_mm512_add_pd(a, b), rr));
+         _mm512_storeu_pd(p1, _mm512_mul_pd(_mm512_sub_pd(a, b), rr));
+      }
+   }
+
+   /**
+    * \brief hadamard kernel : dispatch on the active instruction set
+    */
+   void __apply_h(std::size_t start, std::size_t end, const std::size_t qubit, complex_t * state, const std::size_t stride0, const std::size_t stride1, const complex_t * matrix)
+   {
+      xpu::isa_t isa = xpu::get_isa();
+      size_t pairs = (end-start) >> 1;
+
+      if ((stride0 == 0) && (stride1 == (1UL << qubit)))
+      {
+         if ((isa == xpu::__isa_avx512__) && ((qubit >= 2) || ((qubit == 0) && (pairs >= 2))))
+         {
+            __apply_h_avx512(start, end, qubit, state, matrix);
+            return;
+         }
+         if (isa >= xpu::__isa_avx2__)
+         {
+            __apply_h_avx2(start, end, qubit, state, matrix);
+            return;
+         }
+      }
+      __apply_h_sse(start, end, qubit, state, stride0, stride1, matrix);
+   }
+
    uint64_t rw_process_ui(uint64_t is, uint64_t ie, uint64_t s, uint64_t n, uint64_t qubit, kronecker_ui m, cvector_t * v, cvector_t * res)
    {
       uint64_t k = n-qubit;
@@ -645,18 +1231,481 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 #endif // remove naive tensor computation
 
 
-   typedef enum    
-   {
-      __x180__, 
-      __x90__ , 
-      __y180__, 
-      __y90__ , 
-      __ym90__ 
-   } elementary_operation_t;
+   #define __phase_chunk__   (1UL << 10)  // amplitudes per task of the diagonal kernels
+   #define __phase_line__    (2)          // qubits of the amplitudes sharing a cache line
+   #define __diagonal_eps__  (1e-28)      // squared distance to 1 under which a phase is skipped
 
-   static const char * pulse_lt[][5] = 
+   /**
+    * \brief phases of a line (sse3) : a[j] *= f[j & 3] for j < count, in
+    *    the x*re(f) + swap(x)*(im(f),-im(f)) form of the 2x2 kernels
+    */
+   inline void __phase_run_sse(complex_t * a, const complex_t * f, uint64_t count)
    {
-      { "  pulse 9,0,0", "  pulse 10,0,0", "  pulse 11,0,0", "  pulse 12,0,0", "  pulse 14,0,0" },
+      __m128d sign = _mm_set_pd(-1.0, 1.0);
+      __m128d pr[4], pi[4];
+      for (size_t l=0; l<4; ++l)
+      {
+         pr[l] = _mm_unpackhi_pd(f[l].xmm, f[l].xmm);
+         pi[l] = _mm_mul_pd(_mm_unpacklo_pd(f[l].xmm, f[l].xmm), sign);
+      }
+      for (uint64_t j=0; j<count; ++j)
+      {
+         __m128d x = a[j].xmm;
+         a[j].xmm = _mm_add_pd(_mm_mul_pd(x, pr[j & 3]), _mm_mul_pd(_mm_shuffle_pd(x, x, 1), pi[j & 3]));
+      }
+   }
+
+   /**
+    * \brief phases of a line (avx2) : one line per iteration, <count> is
+    *    a multiple of 4
+    */
+   QX_TARGET_AVX2 void __phase_run_avx2(complex_t * a, const complex_t * f, uint64_t count)
+   {
+      double *       s    = (double *)a;
+      const double * p    = (const double *)f;
+      __m256d        sign = _mm256_set_pd(-1.0, 1.0, -1.0, 1.0);
+      __m256d        v0   = _mm256_loadu_pd(p);
+      __m256d        v1   = _mm256_loadu_pd(p + 4);
+      __m256d        pr0  = _mm256_permute_pd(v0, 0xF);
+      __m256d        pr1  = _mm256_permute_pd(v1, 0xF);
+      __m256d        pi0  = _mm256_mul_pd(_mm256_permute_pd(v0, 0x0), sign);
+      __m256d        pi1  = _mm256_mul_pd(_mm256_permute_pd(v1, 0x0), sign);
+      for (uint64_t j=0; j<2*count; j+=8)
+      {
+         __m256d x0 = _mm256_loadu_pd(s + j);
+         __m256d x1 = _mm256_loadu_pd(s + j + 4);
+         _mm256_storeu_pd(s + j,     _mm256_fmadd_pd(_mm256_permute_pd(x0, 0x5), pi0, _mm256_mul_pd(x0, pr0)));
+         _mm256_storeu_pd(s + j + 4, _mm256_fmadd_pd(_mm256_permute_pd(x1, 0x5), pi1, _mm256_mul_pd(x1, pr1)));
+      }
+   }
+
+   /**
+    * \brief phases of a line (avx-512) : one line per iteration, <count>
+    *    is a multiple of 4
+    */
+   QX_TARGET_AVX512 void __phase_run_avx512(complex_t * a, const complex_t * f, uint64_t count)
+   {
+      double *       s    = (double *)a;
+      __m512d        sign = _mm512_set_pd(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
+      __m512d        v    = _mm512_loadu_pd((const double *)f);
+      __m512d        pr   = _mm512_permute_pd(v, 0xFF);
+      __m512d        pi   = _mm512_mul_pd(_mm512_permute_pd(v, 0x00), sign);
+      for (uint64_t j=0; j<2*count; j+=8)
+      {
+         __m512d x = _mm512_loadu_pd(s + j);
+         _mm512_storeu_pd(s + j, _mm512_fmadd_pd(_mm512_permute_pd(x, 0x55), pi, _mm512_mul_pd(x, pr)));
+      }
+   }
+
+   /**
+    * \brief a[j] *= f[j & 3] for j < count, <a> starting a line : dispatch
+    *    on the instruction set <isa>
+    */
+   inline void __phase_run(complex_t * a, const complex_t * f, uint64_t count, xpu::isa_t isa)
+   {
+      if ((isa == xpu::__isa_avx512__) && !(count & 3))
+         __phase_run_avx512(a, f, count);
+      else if ((isa >= xpu::__isa_avx2__) && !(count & 3))
+         __phase_run_avx2(a, f, count);
+      else
+         __phase_run_sse(a, f, count);
+   }
+
+   /**
+    * \brief single precision phases of a line
+    */
+   inline void __phase_run(complex_f_t * a, const complex_t * f, uint64_t count, xpu::isa_t isa)
+   {
+      for (uint64_t j=0; j<count; ++j)
+      {
+         float re = a[j].re, im = a[j].im;
+         a[j].re = (float)(re*f[j & 3].re - im*f[j & 3].im);
+         a[j].im = (float)(re*f[j & 3].im + im*f[j & 3].re);
+      }
+   }
+
+   /**
+    * \brief phases of a row (sse3) : a[j] *= f[j] for j < count
+    */
+   inline void __phase_row_sse(complex_t * a, const complex_t * f, uint64_t count)
+   {
+      __m128d sign = _mm_set_pd(-1.0, 1.0);
+      for (uint64_t j=0; j<count; ++j)
+      {
+         __m128d x  = a[j].xmm;
+         __m128d pr = _mm_unpackhi_pd(f[j].xmm, f[j].xmm);
+         __m128d pi = _mm_mul_pd(_mm_unpacklo_pd(f[j].xmm, f[j].xmm), sign);
+         a[j].xmm = _mm_add_pd(_mm_mul_pd(x, pr), _mm_mul_pd(_mm_shuffle_pd(x, x, 1), pi));
+      }
+   }
+
+   /**
+    * \brief phases of a row (avx2) : two amplitudes per iteration, <count>
+    *    is even
+    */
+   QX_TARGET_AVX2 void __phase_row_avx2(complex_t * a, const complex_t * f, uint64_t count)
+   {
+      double *       s    = (double *)a;
+      const double * p    = (const double *)f;
+      __m256d        sign = _mm256_set_pd(-1.0, 1.0, -1.0, 1.0);
+      for (uint64_t j=0; j<2*count; j+=4)
+      {
+         __m256d x  = _mm256_loadu_pd(s + j);
+         __m256d v  = _mm256_loadu_pd(p + j);
+         __m256d pi = _mm256_mul_pd(_mm256_permute_pd(v, 0x0), sign);
+         _mm256_storeu_pd(s + j, _mm256_fmadd_pd(_mm256_permute_pd(x, 0x5), pi, _mm256_mul_pd(x, _mm256_permute_pd(v, 0xF))));
+      }
+   }
+
+   /**
+    * \brief phases of a row (avx-512) : four amplitudes per iteration,
+    *    <count> is a multiple of 4
+    */
+   QX_TARGET_AVX512 void __phase_row_avx512(complex_t * a, const complex_t * f, uint64_t count)
+   {
+      double *       s    = (double *)a;
+      const double * p    = (const double *)f;
+      __m512d        sign = _mm512_set_pd(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
+      for (uint64_t j=0; j<2*count; j+=8)
+      {
+         __m512d x  = _mm512_loadu_pd(s + j);
+         __m512d v  = _mm512_loadu_pd(p + j);
+         __m512d pi = _mm512_mul_pd(_mm512_permute_pd(v, 0x00), sign);
+         _mm512_storeu_pd(s + j, _mm512_fmadd_pd(_mm512_permute_pd(x, 0x55), pi, _mm512_mul_pd(x, _mm512_permute_pd(v, 0xFF))));
+      }
+   }
+
+   /**
+    * \brief a[j] *= f[j] for j < count : dispatch on the instruction set <isa>
+    */
+   inline void __phase_row(complex_t * a, const complex_t * f, uint64_t count, xpu::isa_t isa)
+   {
+      if ((isa == xpu::__isa_avx512__) && !(count & 3))
+         __phase_row_avx512(a, f, count);
+      else if ((isa >= xpu::__isa_avx2__) && !(count & 1))
+         __phase_row_avx2(a, f, count);
+      else
+         __phase_row_sse(a, f, count);
+   }
+
+   /**
+    * \brief single precision phases of a row
+    */
+   inline void __phase_row(complex_f_t * a, const complex_t * f, uint64_t count, xpu::isa_t isa)
+   {
+      for (uint64_t j=0; j<count; ++j)
+      {
+         float re = a[j].re, im = a[j].im;
+         a[j].re = (float)(re*f[j].re - im*f[j].im);
+         a[j].im = (float)(re*f[j].im + im*f[j].re);
+      }
+   }
+
+   /**
+    * \brief layout of the amplitudes whose index has given values on the
+    *    bits of a mask : the remaining 2^(n-k) indices are split in chunks
+    *    of up to 2^10, each made of contiguous runs of <len> amplitudes,
+    *    2*run apart up to the next bit of the mask
+    */
+   struct __runs_t
+   {
+      uint64_t bits[64];
+      size_t   k;
+      uint64_t run;
+      uint64_t chunk;
+      uint64_t len;
+      int64_t  chunks;
+   };
+
+   inline void __runs_init(__runs_t& r, uint64_t n, uint64_t mask)
+   {
+      r.k = 0;
+      for (size_t b=0; b<n; ++b)
+         if (mask & (1UL << b))
+            r.bits[r.k++] = b;
+      uint64_t group = (1UL << (r.k > 1 ? r.bits[1]-1 : n-r.k));
+      r.run    = (1UL << (r.k ? r.bits[0] : n));
+      r.chunk  = std::min<uint64_t>(group, __phase_chunk__);
+      r.len    = std::min<uint64_t>(r.run, r.chunk);
+      r.chunks = (int64_t)((1UL << (n-r.k))/r.chunk);
+   }
+
+   /**
+    * \brief first index of chunk <c>, with zeros on the bits of the mask
+    */
+   inline uint64_t __runs_base(const __runs_t& r, uint64_t c)
+   {
+      uint64_t base = c*r.chunk;
+      for (size_t b=0; b<r.k; ++b)
+         base = ((base >> r.bits[b]) << (r.bits[b]+1)) | (base & ((1UL << r.bits[b])-1));
+      return base;
+   }
+
+   /**
+    * \brief diagonal kernel : multiplies by <d> the amplitudes i such that
+    *    (i & mask) == value. they are visited in contiguous runs below the
+    *    lowest bit of <mask> above the cache line, so that a phase on the
+    *    |1> half of a qubit only reads half of the state; within a line,
+    *    the amplitudes left alone are multiplied by 1. each task covers
+    *    up to 2^10 amplitudes, in several runs when they are short.
+    */
+   template <typename amplitude_t>
+   void __apply_phase(amplitude_t * state, uint64_t n, uint64_t mask, uint64_t value, complex_t d)
+   {
+      uint64_t line   = (1UL << __phase_line__)-1;
+      uint64_t lmask  = (mask & line);
+      uint64_t lvalue = (value & line);
+      __runs_t r;
+      __runs_init(r, n, mask & ~line);
+
+      QX_ALIGNED(64) complex_t f[1UL << __phase_line__];
+      for (uint64_t j=0; j<(1UL << __phase_line__); ++j)
+         f[j] = (((j & lmask) == lvalue) ? d : complex_t(1.0,0.0));
+      const complex_t * pf  = f;
+      xpu::isa_t        isa = xpu::get_isa();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t c=0; c<r.chunks; ++c)
+      {
+         amplitude_t * a = state + (__runs_base(r, c) | (value & ~line));
+         for (uint64_t q=0; q<r.chunk/r.len; ++q)
+            __phase_run(a + 2*q*r.run, pf, r.len, isa);
+      }
+   }
+
+   /**
+    * \brief diagonal 2x2 matrix <m> on qubit <t>, controlled by the qubits
+    *    of <cmask> : each half is only visited if its phase is not 1, which
+    *    leaves the |1> half alone for z, s, sdag, t, tdag, rz and the
+    *    controlled phases
+    */
+   template <typename amplitude_t>
+   void __apply_diag(amplitude_t * state, uint64_t n, uint64_t t, uint64_t cmask, cmatrix_t& m)
+   {
+      uint64_t  mask = cmask | (1UL << t);
+      complex_t one(1.0,0.0);
+      if ((m(0,0)-one).norm() >= __diagonal_eps__)
+         __apply_phase(state, n, mask, cmask, m(0,0));
+      if ((m(1,1)-one).norm() >= __diagonal_eps__)
+         __apply_phase(state, n, mask, mask, m(1,1));
+   }
+
+   /**
+    * \brief apply the diagonal matrix <m> to qubit <t> of <qreg> (in any
+    *    precision), controlled by the qubits of <cmask>. the measurement
+    *    predictions are not affected by a diagonal gate.
+    */
+   inline void diag_apply(cmatrix_t& m, uint64_t t, uint64_t cmask, qu_register& qreg)
+   {
+      if (qreg.single_precision())
+         __apply_diag(qreg.get_data_f().data(), qreg.size(), t, cmask, m);
+      else
+         __apply_diag(qreg.get_data().data(), qreg.size(), t, cmask, m);
+   }
+
+   /**
+    * \brief controlled 2x2 matrix kernel (sse3) : <matrix> on qubit <t>,
+    *    applied only to the 2^(n-c-1) pairs of amplitudes where the <c>
+    *    bits of <cmask> are set, visited in the runs of __runs_t
+    */
+   void __apply_cu_sse(complex_t * state, uint64_t t, uint64_t cmask, const __runs_t& r, const complex_t * matrix)
+   {
+      complex_t m00 = matrix[0];
+      complex_t m01 = matrix[1];
+      complex_t m10 = matrix[2];
+      complex_t m11 = matrix[3];
+      uint64_t  step = (1UL << t);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t c=0; c<r.chunks; ++c)
+      {
+         complex_t * a = state + (__runs_base(r, c) | cmask);
+         for (uint64_t q=0; q<r.chunk/r.len; ++q)
+            for (complex_t * p=a+2*q*r.run; p<a+2*q*r.run+r.len; ++p)
+            {
+               complex_t in0 = p[0];
+               complex_t in1 = p[step];
+               p[0]    = m00*in0+m01*in1;
+               p[step] = m10*in0+m11*in1;
+            }
+      }
+   }
+
+   /**
+    * \brief controlled 2x2 matrix kernel (avx2) : two pairs per iteration,
+    *    requires runs of even length
+    */
+   QX_TARGET_AVX2 void __apply_cu_avx2(complex_t * state, uint64_t t, uint64_t cmask, const __runs_t& r, const complex_t * matrix)
+   {
+      __m2x2_avx2 m;
+      __load_m_avx2(matrix, m);
+      uint64_t step = (1UL << t);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t c=0; c<r.chunks; ++c)
+      {
+         double * a = (double *)(state + (__runs_base(r, c) | cmask));
+         for (uint64_t q=0; q<r.chunk/r.len; ++q)
+            for (double * p=a+4*q*r.run; p<a+4*q*r.run+2*r.len; p+=4)
+               __pair_m_avx2(p, p + 2*step, m);
+      }
+   }
+
+   /**
+    * \brief controlled 2x2 matrix kernel (avx-512) : four pairs per
+    *    iteration, requires runs of a multiple of 4 amplitudes
+    */
+   QX_TARGET_AVX512 void __apply_cu_avx512(complex_t * state, uint64_t t, uint64_t cmask, const __runs_t& r, const complex_t * matrix)
+   {
+      __m2x2_avx512 m;
+      __load_m_avx512(matrix, m);
+      uint64_t step = (1UL << t);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t c=0; c<r.chunks; ++c)
+      {
+         double * a = (double *)(state + (__runs_base(r, c) | cmask));
+         for (uint64_t q=0; q<r.chunk/r.len; ++q)
+            for (double * p=a+4*q*r.run; p<a+4*q*r.run+2*r.len; p+=8)
+               __pair_m_avx512(p, p + 2*step, m);
+      }
+   }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+   /**
+    * \brief multi-controlled 2x2 matrix kernel : <matrix> on qubit <t> of
+    *    a register of <n> qubits, controlled by any number of qubits
+    *    (<cmask>). only the amplitudes where all the controls are set are
+    *    read, in runs as long as the lowest qubit of the gate allows, so
+    *    that a gate with c controls costs 2^-c of a full pass.
+    */
+   void __apply_cu(complex_t * state, uint64_t n, uint64_t t, uint64_t cmask, const complex_t * matrix)
+   {
+      if (!cmask)
+      {
+         __apply_m(0, (1UL << n), t, state, 0, (1UL << t), matrix);
+         return;
+      }
+      __runs_t r;
+      __runs_init(r, n, cmask | (1UL << t));
+      xpu::isa_t isa = xpu::get_isa();
+      if ((isa == xpu::__isa_avx512__) && !(r.len & 3))
+         __apply_cu_avx512(state, t, cmask, r, matrix);
+      else if ((isa >= xpu::__isa_avx2__) && !(r.len & 1))
+         __apply_cu_avx2(state, t, cmask, r, matrix);
+      else
+         __apply_cu_sse(state, t, cmask, r, matrix);
+   }
+
+   /**
+    * \brief controlled 2x2 matrix <m> on qubit <t> of the <n> qubits of
+    *    <state> : diagonal matrices go through the phase kernel, the others
+    *    through __apply_cu() (__apply_m_f() in single precision)
+    */
+   inline void __apply_cmatrix(complex_t * state, uint64_t n, uint64_t t, uint64_t cmask, cmatrix_t& m)
+   {
+      if ((m(0,1).norm() < __diagonal_eps__) && (m(1,0).norm() < __diagonal_eps__))
+         __apply_diag(state, n, t, cmask, m);
+      else
+         __apply_cu(state, n, t, cmask, m.m);
+   }
+
+   inline void __apply_cmatrix(complex_f_t * state, uint64_t n, uint64_t t, uint64_t cmask, cmatrix_t& m)
+   {
+      if ((m(0,1).norm() < __diagonal_eps__) && (m(1,0).norm() < __diagonal_eps__))
+         __apply_diag(state, n, t, cmask, m);
+      else
+         __apply_m_f(state, n, t, cmask, m);
+   }
+
+   /**
+    * \brief apply the 2x2 matrix <m> to qubit <t> of <qreg> (in any
+    *    precision), controlled by the qubits of <cmask>. the measurement
+    *    predictions are left to the caller (see cu_predict()).
+    */
+   inline void cu_apply(cmatrix_t& m, uint64_t t, uint64_t cmask, qu_register& qreg)
+   {
+      if (qreg.single_precision())
+         __apply_cmatrix(qreg.get_data_f().data(), qreg.size(), t, cmask, m);
+      else
+         __apply_cmatrix(qreg.get_data().data(), qreg.size(), t, cmask, m);
+   }
+
+   /**
+    * \brief update the measurement prediction of the target <t> of the 2x2
+    *    matrix <m> controlled by the qubits <ctrl>
+    */
+   inline void cu_predict(cmatrix_t& m, uint64_t t, const std::vector<uint64_t>& ctrl, qu_register& qreg)
+   {
+      state_t c = __state_1__;
+      for (size_t i=0; i<ctrl.size(); ++i)
+      {
+         state_t s = qreg.get_measurement_prediction(ctrl[i]);
+         if (s == __state_0__)
+            c = __state_0__;
+         else if ((s == __state_unknown__) && (c != __state_0__))
+            c = __state_unknown__;
+      }
+
+      bool diagonal      = ((m(0,1).norm() < __single_eps__) && (m(1,0).norm() < __single_eps__));
+      bool anti_diagonal = ((m(0,0).norm() < __single_eps__) && (m(1,1).norm() < __single_eps__));
+      state_t s = qreg.get_measurement_prediction(t);
+      if ((c == __state_0__) || diagonal)
+         return;
+      if ((c == __state_1__) && anti_diagonal)
+      {
+         if (s != __state_unknown__)
+            qreg.set_measurement_prediction(t,(s == __state_1__ ? __state_0__ : __state_1__));
+      }
+      else
+         qreg.set_measurement_prediction(t,__state_unknown__);
+   }
+
+   /**
+    * \brief apply the (controlled) 2x2 matrix of the gate through
+    *    cu_apply() and update the measurement prediction of its target
+    */
+   int64_t gate::apply_matrix(qu_register& qreg)
+   {
+      cmatrix_t m;
+      if (!get_matrix(m))
+         throw std::runtime_error("gate not supported in single precision mode");
+
+      std::vector<uint64_t> ctrl  = control_qubits();
+      uint64_t              t     = target_qubits()[0];
+      uint64_t              cmask = 0;
+      for (size_t i=0; i<ctrl.size(); ++i)
+         cmask |= (1UL << ctrl[i]);
+
+      cu_apply(m, t, cmask, qreg);
+      cu_predict(m, t, ctrl, qreg);
+      return 0;
+   }
+
+
+   typedef enum    
+   {
+      __x180__, 
+      __x90__ , 
+      __y180__, 
+      __y90__ , 
+      __ym90__ 
+   } elementary_operation_t;
+
+   static const char * pulse_lt[][5] = 
+   {
+      { "  pulse 9,0,0", "  pulse 10,0,0", "  pulse 11,0,0", "  pulse 12,0,0", "  pulse 14,0,0" },
       { "  pulse 0,9,0", "  pulse 0,10,0", "  pulse 0,11,0", "  pulse 0,12,0", "  pulse 0,14,0" },
       { "  pulse 0,0,9", "  pulse 0,0,10", "  pulse 0,0,11", "  pulse 0,0,12", "  pulse 0,0,14" },
    };
@@ -685,6 +1734,8 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qureg)
          {
+            if (qureg.single_precision())
+               return apply_matrix(qureg);
             size_t qs = qureg.states();
             complex_t * data = qureg.get_data().data();
             // sqg_apply(m,qubit,qureg);
@@ -734,6 +1785,12 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
          gate_type_t type()
          {
             return __hadamard_gate__; 
@@ -836,6 +1893,8 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
+            if (qreg.single_precision())
+               return apply_matrix(qreg);
             // println("cnot " << control_qubit << "," << target_qubit);
 #ifdef CG_MATRIX
             uint64_t sn = qreg.states();
@@ -978,6 +2037,12 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
          }
 
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = build_matrix(pauli_x_c,2);
+            return true;
+         }
+
          gate_type_t type()
          {
             return __cnot_gate__; 
@@ -1065,69 +2130,7 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
-            uint64_t sn  = qreg.states();
-            uint64_t qn  = qreg.size();
-            uint64_t cq1 = control_qubit_1;
-            uint64_t cq2 = control_qubit_2;
-            uint64_t tq = target_qubit;
-
-            cvector_t& amp = qreg.get_data();
-
-            //println("\ntoffoli " << cq1 << "," << cq2 << "," << tq);
-#if 1
-            size_t c1=cq1;
-            size_t c2=cq2;
-            size_t c3=tq;
-            size_t t=tq;
-            size_t size=qn;
-
-            sort(c1,c2,c3);
-#ifdef USE_OPENMP
-#pragma omp parallel for
-#endif
-            for (int64_t i=__bit_set(__bit_set(__bit_set(0,c1),c2),c3); i<(int64_t)(1UL<<size); i += (1UL << (c3+1)))
-               for (size_t j=(size_t)i; j<((size_t)i+(1UL<<c3)); j += (1UL << (c2+1)))
-                  for (size_t k=j; k<(j+(1UL<<c2)); k+=(1UL << (c1+1)))
-                     for (size_t l=k; l<(k+(1UL<<(c1))); l++)
-                     {
-                        std::swap(amp[__bit_set(l,t)],amp[__bit_reset(l,t)]);
-                        // println("swap : " << __bit_set(l,t) << "," << __bit_reset(l,t));
-                     }
-#else
-            std::vector<uint64_t> done(sn, 0);
-            perm_t p = perms(qn,cq1,cq2,tq);
-
-            uint64_t p1,p2;
-
-            for (perm_t::iterator it = p.begin(); it != p.end(); it++)
-            {
-               p1 = it->first;
-               p2 = it->second;
-               if (!(done[p1] || done[p2]))
-                  //if (!(done[p1]))
-               {
-                  // std::swap(amp(p1),amp(p2)); // ublas
-                  std::swap(amp[p1],amp[p2]);
-                  //println("swap : " << p1 << "," << p2);
-                  done[p1] = 1;
-                  done[p2] = 1;
-               }
-            }
-#endif
-
-            if ((qreg.get_measurement_prediction(control_qubit_1) == __state_1__) && 
-                  (qreg.get_measurement_prediction(control_qubit_2) == __state_1__) )
-            {
-               qreg.flip_binary(target_qubit);
-            }
-            else if ((qreg.get_measurement_prediction(control_qubit_1) == __state_unknown__) ||
-                  (qreg.get_measurement_prediction(control_qubit_2) == __state_unknown__)  )
-            {
-               qreg.set_measurement_prediction(target_qubit,__state_unknown__);
-               // qreg.set_binary(target_qubit,__state_unknown__);
-            }
-
-            return 0;
+            return apply_matrix(qreg);
          }
 
 
@@ -1156,6 +2159,12 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
          }
 
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = build_matrix(pauli_x_c,2);
+            return true;
+         }
+
          gate_type_t type()
          {
             return __toffoli_gate__;
@@ -1185,14 +2194,8 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
    void fast_flip(uint64_t q, uint64_t n, cvector_t& amp)
    {
-      complex_t * x = amp.data();
-#ifdef USE_OPENMP
-#pragma omp parallel for 
-#endif 
-      for (int64_t i=0; i<(int64_t)(1UL << n); i+=(1UL << (q+1)))
-         for (size_t j=(size_t)i; j<((size_t)i+(1UL << q)); j++)
-            //__swap_xmm(x[j].xmm,x[__bit_flip(j,q)].xmm);
-            std::swap(x[j].xmm,x[__bit_flip(j,q)].xmm);
+      // same permutation as pauli-x : reuse its vector kernels
+      __apply_x(0, (1UL << n), q, amp.data(), 0, (1UL << q), pauli_x_c);
    }
 
 
@@ -1283,6 +2286,12 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
          gate_type_t type()
          {
             return __identity_gate__; 
@@ -1317,6 +2326,8 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
+            if (qreg.single_precision())
+               return apply_matrix(qreg);
             // #define FAST_FLIP
 #ifdef FAST_FLIP
             uint64_t qn = qreg.size();
@@ -1380,6 +2391,12 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
          gate_type_t type()
          {
             return __pauli_x_gate__; 
@@ -1410,6 +2427,8 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
+            if (qreg.single_precision())
+               return apply_matrix(qreg);
             sqg_apply(m,qubit,qreg);
             qreg.flip_binary(qubit);
             return 0;
@@ -1454,6 +2473,12 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
          gate_type_t type()
          {
             return __pauli_y_gate__; 
@@ -1483,7 +2508,7 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
-            sqg_apply(m,qubit,qreg);
+            diag_apply(m,qubit,0,qreg);
             return 0;
          }
 
@@ -1529,6 +2554,17 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
+         bool is_diagonal()
+         {
+            return true;
+         }
+
          gate_type_t type()
          {
             return __pauli_z_gate__; 
@@ -1557,7 +2593,7 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
-            sqg_apply(m,qubit,qreg);
+            diag_apply(m,qubit,0,qreg);
             return 0;
          }
 
@@ -1599,12 +2635,23 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
-         gate_type_t type()
+         bool get_matrix(cmatrix_t& gm)
          {
-            return __phase_gate__; 
+            gm = m;
+            return true;
          }
-   };
-
+
+         bool is_diagonal()
+         {
+            return true;
+         }
+
+         gate_type_t type()
+         {
+            return __phase_gate__; 
+         }
+   };
+
 
    /**
     * \brief S dag gate
@@ -1625,7 +2672,7 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
-            sqg_apply(m,qubit,qreg);
+            diag_apply(m,qubit,0,qreg);
             return 0;
          }
 
@@ -1654,6 +2701,17 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
+         bool is_diagonal()
+         {
+            return true;
+         }
+
          gate_type_t type()
          {
             return __sdag_gate__;
@@ -1681,7 +2739,7 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
 	   int64_t apply(qu_register& qreg)
 	   {
-		 sqg_apply(m,qubit,qreg);
+		 diag_apply(m,qubit,0,qreg);
 		 return 0;
 	   }
 
@@ -1711,6 +2769,17 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 	   }
 
 
+	   bool get_matrix(cmatrix_t& gm)
+	   {
+		 gm = m;
+		 return true;
+	   }
+
+	   bool is_diagonal()
+	   {
+		 return true;
+	   }
+
 	   gate_type_t type()
 	   {
 	      return __t_gate__; 
@@ -1738,7 +2807,7 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
-            sqg_apply(m,qubit,qreg);
+            diag_apply(m,qubit,0,qreg);
             return 0;
          }
 
@@ -1767,6 +2836,17 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
+         bool is_diagonal()
+         {
+            return true;
+         }
+
          gate_type_t type()
          {
             return __tdag_gate__;
@@ -1830,6 +2910,8 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
+            if (qreg.single_precision())
+               return apply_matrix(qreg);
             sqg_apply(m,qubit,qreg);
             qreg.set_measurement_prediction(qubit,__state_unknown__);
             // qreg.set_binary(qubit,__state_unknown__);
@@ -1866,6 +2948,12 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
          gate_type_t type()
          {
             return __unitary_gate__;
@@ -1896,6 +2984,8 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
+            if (qreg.single_precision())
+               return apply_matrix(qreg);
             sqg_apply(m,qubit,qreg);
             qreg.set_measurement_prediction(qubit,__state_unknown__);
             // qreg.set_binary(qubit,__state_unknown__);
@@ -1927,6 +3017,12 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
          gate_type_t type()
          {
             return __rx_gate__; 
@@ -1958,6 +3054,8 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
+            if (qreg.single_precision())
+               return apply_matrix(qreg);
             sqg_apply(m,qubit,qreg);
             qreg.set_measurement_prediction(qubit,__state_unknown__);
             //qreg.set_binary(qubit,__state_unknown__);
@@ -1990,6 +3088,12 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
          }
 
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
          gate_type_t type()
          {
             return __ry_gate__;
@@ -2020,9 +3124,7 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
-            sqg_apply(m,qubit,qreg);
-            qreg.set_measurement_prediction(qubit,__state_unknown__);
-            //qreg.set_binary(qubit,__state_unknown__);
+            diag_apply(m,qubit,0,qreg);
             return 0;
          }
 
@@ -2051,6 +3153,17 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
+         bool is_diagonal()
+         {
+            return true;
+         }
+
          gate_type_t type()
          {
             return __rz_gate__; 
@@ -2290,123 +3403,44 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
    }
 
    /**
-    * \brief qft 
-    */ 
-   class qft : public gate
-   {
-      private:
-
-         std::vector<uint64_t>     qubit;
-         cmatrix_t                 hm;
-
-      public:
-
-         qft(std::vector<uint64_t> qubit) : qubit(qubit)
-         {
-            hm = build_matrix(hadamard_c,2);
-         }
-
-         int64_t apply(qu_register& qreg)
-         { 
-            size_t n  = qreg.size();
-            size_t s = qreg.states();
-            cvector_t& in  = qreg.get_data();
-            cvector_t& out = qreg.get_aux(); 
-
-            // kronecker_ui kui(hm,2,(1 << (n-1)));
-            kronecker_ui kui(hadamard_c,2,(1 << (n-1)));
-            qft_1st_fold(n, 0, kui, in, out);
-            for (size_t i=1; i<n-1; ++i)
-            {
-               size_t q = qubit[i];
-               // kronecker_iui kiui(hm, 2, (1 << (n-q-1)), (1 << (q)));
-               kronecker_iui kiui(hadamard_c, 2, (1UL << (n-q-1)), (1UL << (q)));
-               qft_nth_fold(n, 0, kiui, in, out);
-            }
-            in.swap(out);
-            return 0;
-#if 0
-            // 1st fold
-            qft_worker(0, s, 1, n, in, out, kronecker_ui(m,2,s-2), 0);
-            return 0;
-            // ith fold
-            for (size_t i=1; i<qubit.size(); ++i)
-            {
-               size_t q = qubit[i];
-               kronecker_iui k(m, 2, (1UL << (n-q-1)), (1UL << (q)));
-               qft_worker(0, qreg.states(), 1, qreg.size(), (qreg.get_data()), (qreg.get_aux()), k, q);
-            }
-            // last fold
-            kronecker_iu k(m,2,(1UL << (n-1)));
-            sparse_mulmv(n,qubit[n-1],k,qreg.get_data(),qreg.get_aux());
-            in.swap(out);
-            return 0;
-#endif
-         }
-
-         void dump()
-         {
-            print("  [-] qft(");
-            for (size_t i=0; i<(qubit.size()-1); ++i)
-               print("q" << qubit[i] << ","); 
-            println("q" << qubit[qubit.size()-1] << ")");
-         }
-
-         std::vector<uint64_t>  qubits()
-         {
-            return qubit;
-         }
-
-         std::vector<uint64_t>  control_qubits()
-         {
-            return qubit;
-         }
-
-         std::vector<uint64_t>  target_qubits()
-         {
-            return qubit;
-         }
-
-         gate_type_t type()
-         {
-            return __qft_gate__; 
-         }
-   };
-
-   /**
-    * phase shifter
+    * \brief qft phase fold : multiply the amplitudes where qubit[i] is set
+    *    by the phases of all the controlled rotations from qubit[0..i-1]
+    *    onto qubit[i], in a single pass over the state (of complex_t or
+    *    complex_f_t amplitudes)
     */
-   void __apply_cm(complex_t * state, 
-         complex_t m[2][2],
-         std::size_t i11, std::size_t i12, std::size_t i13,
-         std::size_t i21, std::size_t i22, std::size_t i23,
-         std::size_t i31, std::size_t i32, std::size_t ish )
+   template<typename amplitude_t>
+   void qft_phase_fold(amplitude_t * state, uint64_t n, const std::vector<uint64_t>& qubit, size_t i)
    {
-      complex_t m00 = m[0][0],
-                m01 = m[0][1],
-                m10 = m[1][0],
-                m11 = m[1][1];
+      std::vector<complex_t> w(i);
+      for (size_t j=0; j<i; ++j)
+         w[j] = complex_t(cos(QX_PI/(1UL << (i-j))), sin(QX_PI/(1UL << (i-j))));
 
-      for(std::size_t r1 = i11; r1 < i12; r1 += i13)
+      uint64_t t    = qubit[i];
+      uint64_t mask = (1UL << t)-1;
+      int64_t  rs   = (int64_t)(1UL << (n-1));
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t k=0; k<rs; ++k)
       {
-         #ifdef USE_OPENMP
-         // #pragma omp parallel for
-         #endif
-         for(std::size_t r2 = r1 + i21; r2 < r1 + i22; r2 += i23)
-         {
-            for(std::size_t ind0 = r2 + i31; ind0 < r2 + i32; ind0++)
+         uint64_t  x = ((k >> t) << (t+1)) | (k & mask) | (1UL << t);
+         complex_t p(1.0,0.0);
+         bool      shift = false;
+         for (size_t j=0; j<i; ++j)
+            if (x & (1UL << qubit[j]))
             {
-               std::size_t ind1 = ind0 + ish;
-               complex_t    in0 = state[ind0], in1 = state[ind1];
-
-               state[ind0] = m00 * in0 + m01 * in1;
-               state[ind1] = m10 * in0 + m11 * in1;
+               p *= w[j];
+               shift = true;
             }
+         if (shift)
+         {
+            complex_t a = state[x];
+            a *= p;
+            state[x] = a;
          }
       }
    }
 
-
    /**
     * \brief  controlled phase shift by arbitrary phase angle or (2*pi/(2^(k=ctrl-target)))
     */ 
@@ -2487,26 +3521,9 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
          
          int64_t apply(qu_register& qreg)
          {
-            uint64_t     n  = qreg.size();
-            complex_t *  s  = qreg.get_data().data();
-            size_t       c  = ctrl_qubit;
-            size_t       t  = target_qubit;
-
-            if (c > t)
-               __apply_cm(qreg.get_data().data(),          
-                     m,                                    
-                     0UL, (1UL << n), 1UL << (c+1l),            
-                     1UL << c, 1UL << (c+1UL), 1UL << (t+1UL),  
-                     0UL,    1UL << t,    1UL << t);          
-            else
-               __apply_cm(qreg.get_data().data(),
-                     m,                          
-                     0UL, (1UL << n), 1UL << (t+1UL),     
-                     0UL,    1UL << t,    1UL << (c+1l),
-                     1UL << c, 1UL<< (c+1UL), 1UL << t);
-
-
-
+            cmatrix_t cm;
+            get_matrix(cm);
+            diag_apply(cm,target_qubit,(1UL << ctrl_qubit),qreg);
             return 0;
          }
 
@@ -2537,6 +3554,18 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm(0,0) = m[0][0]; gm(0,1) = m[0][1];
+            gm(1,0) = m[1][0]; gm(1,1) = m[1][1];
+            return true;
+         }
+
+         bool is_diagonal()
+         {
+            return true;
+         }
+
          gate_type_t type()
          {
             return __ctrl_phase_shift_gate__; 
@@ -2545,6 +3574,126 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
 
 
+   /**
+    * \brief qubit permutation kernel : the state of qubit qubits[k] moves to
+    *    qubit dest[k]. the amplitudes of the 2^m basis states of the m moved
+    *    qubits are exchanged along the cycles of the permutation, in place,
+    *    and the fixed points (e.g. |00> and |11> for a swap) are not read.
+    *    the amplitudes are visited in the runs of __runs_t, so that each
+    *    cycle moves contiguous blocks of amplitudes.
+    */
+   template <typename amplitude_t>
+   void __apply_permutation(amplitude_t * state, uint64_t n, const std::vector<uint64_t>& qubits, const std::vector<uint64_t>& dest)
+   {
+      std::vector<uint64_t> moved;
+      uint64_t              mask = 0;
+      for (size_t k=0; k<qubits.size(); ++k)
+         if (qubits[k] != dest[k])
+         {
+            moved.push_back(qubits[k]);
+            mask |= (1UL << qubits[k]);
+         }
+      if (moved.empty())
+         return;
+      std::sort(moved.begin(),moved.end());
+
+      // bit j of a local state refers to moved[j], and goes to bit to[j]
+      size_t              m = moved.size();
+      std::vector<size_t> to(m);
+      for (size_t j=0; j<m; ++j)
+      {
+         size_t k = std::find(qubits.begin(),qubits.end(),moved[j]) - qubits.begin();
+         to[j] = std::find(moved.begin(),moved.end(),dest[k]) - moved.begin();
+      }
+
+      // cycles of the local states, as offsets in the state vector
+      std::vector<uint64_t> cycles;
+      std::vector<size_t>   ends;
+      std::vector<bool>     seen(1UL << m, false);
+      for (uint64_t v=0; v<(1UL << m); ++v)
+      {
+         size_t first = cycles.size();
+         for (uint64_t x=v; !seen[x]; )
+         {
+            seen[x] = true;
+            uint64_t off = 0, y = 0;
+            for (size_t j=0; j<m; ++j)
+            {
+               off |= ((x >> j) & 1UL) << moved[j];
+               y   |= ((x >> j) & 1UL) << to[j];
+            }
+            cycles.push_back(off);
+            x = y;
+         }
+         if (cycles.size()-first == 1)
+            cycles.pop_back();
+         else if (cycles.size() > first)
+            ends.push_back(cycles.size());
+      }
+
+      __runs_t r;
+      __runs_init(r, n, mask);
+      const uint64_t * cy = cycles.data();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t c=0; c<r.chunks; ++c)
+      {
+         amplitude_t * a = state + __runs_base(r, c);
+         for (uint64_t q=0; q<r.chunk/r.len; ++q)
+         {
+            amplitude_t * p = a + 2*q*r.run;
+            size_t        s = 0;
+            for (size_t e=0; e<ends.size(); s=ends[e++])
+            {
+               if (ends[e]-s == 2)
+               {
+                  amplitude_t * x = p + cy[s];
+                  amplitude_t * y = p + cy[s+1];
+                  for (uint64_t j=0; j<r.len; ++j)
+                     std::swap(x[j], y[j]);
+                  continue;
+               }
+               // a[c(k+1)] = a[c(k)] along the cycle
+               for (uint64_t j=0; j<r.len; ++j)
+               {
+                  amplitude_t t = p[cy[ends[e]-1]+j];
+                  for (size_t k=ends[e]-1; k>s; --k)
+                     p[cy[k]+j] = p[cy[k-1]+j];
+                  p[cy[s]+j] = t;
+               }
+            }
+         }
+      }
+   }
+
+   /**
+    * \brief move the measurement prediction of qubit qubits[k] to dest[k]
+    */
+   inline void perm_predict(const std::vector<uint64_t>& qubits, const std::vector<uint64_t>& dest, qu_register& qreg)
+   {
+      std::vector<state_t> s(qubits.size());
+      for (size_t k=0; k<qubits.size(); ++k)
+         s[k] = qreg.get_measurement_prediction(qubits[k]);
+      for (size_t k=0; k<qubits.size(); ++k)
+         qreg.set_measurement_prediction(dest[k],s[k]);
+   }
+
+   /**
+    * \brief move the state of qubit qubits[k] of <qreg> (in any precision)
+    *    to qubit dest[k], with its measurement prediction
+    */
+   inline void perm_apply(const std::vector<uint64_t>& qubits, const std::vector<uint64_t>& dest, qu_register& qreg)
+   {
+      if (qreg.single_precision())
+         __apply_permutation(qreg.get_data_f().data(), qreg.size(), qubits, dest);
+      else
+         __apply_permutation(qreg.get_data().data(), qreg.size(), qubits, dest);
+      perm_predict(qubits, dest, qreg);
+   }
+
+
    /**
     * \brief  swap :
     *
@@ -2571,12 +3720,20 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
 
          int64_t apply(qu_register& qreg)
          {
-            cnot(qubit1,qubit2).apply(qreg);
-            cnot(qubit2,qubit1).apply(qreg);
-            cnot(qubit1,qubit2).apply(qreg);
+            std::vector<uint64_t> dest;
+            get_permutation(dest);
+            perm_apply(qubits(),dest,qreg);
             return 0;
          }
 
+         bool get_permutation(std::vector<uint64_t>& dest)
+         {
+            dest.clear();
+            dest.push_back(qubit2);
+            dest.push_back(qubit1);
+            return true;
+         }
+
 
          void    dump()
          {
@@ -2597,155 +3754,1168 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return r;
          }
 
-         std::vector<uint64_t>  target_qubits()
+         std::vector<uint64_t>  target_qubits()
+         {
+            std::vector<uint64_t> r;
+            r.push_back(qubit1);
+            r.push_back(qubit2);
+            return r;
+         }
+
+         gate_type_t type()
+         {
+            return __swap_gate__; 
+         }
+
+   };
+   
+   
+   /**
+    * \brief qft 
+    */ 
+   class qft : public gate
+   {
+      private:
+
+         std::vector<uint64_t>     qubit;
+         cmatrix_t                 hm;
+
+      public:
+
+         qft(std::vector<uint64_t> qubit) : qubit(qubit)
+         {
+            hm = build_matrix(hadamard_c,2);
+         }
+
+         /**
+          * \brief in-place qft on <qubit>, qubit[0] being the least
+          *    significant : a hadamard and a single phase pass per qubit,
+          *    then the qubit order is reversed by swaps
+          */
+         int64_t apply(qu_register& qreg)
+         { 
+            size_t n = qreg.size();
+            size_t m = qubit.size();
+            for (size_t i=m; i-- > 0; )
+            {
+               hadamard(qubit[i]).apply(qreg);
+               if (!i)
+                  continue;
+               if (qreg.single_precision())
+                  qft_phase_fold(qreg.get_data_f().data(), n, qubit, i);
+               else
+                  qft_phase_fold(qreg.get_data().data(), n, qubit, i);
+            }
+            for (size_t j=0; j<m/2; ++j)
+               swap(qubit[j],qubit[m-1-j]).apply(qreg);
+            return 0;
+         }
+
+         void dump()
+         {
+            print("  [-] qft(");
+            for (size_t i=0; i<(qubit.size()-1); ++i)
+               print("q" << qubit[i] << ","); 
+            println("q" << qubit[qubit.size()-1] << ")");
+         }
+
+         std::vector<uint64_t>  qubits()
+         {
+            return qubit;
+         }
+
+         std::vector<uint64_t>  control_qubits()
+         {
+            return qubit;
+         }
+
+         std::vector<uint64_t>  target_qubits()
+         {
+            return qubit;
+         }
+
+         gate_type_t type()
+         {
+            return __qft_gate__; 
+         }
+   };
+
+   /**
+    * \brief cphase
+    */
+   class cphase : public gate
+   {
+      private:
+
+         uint64_t  ctrl_qubit;
+         uint64_t  target_qubit;
+         cmatrix_t m;
+
+      public:
+
+         cphase(uint64_t ctrl_qubit, uint64_t target_qubit) : ctrl_qubit(ctrl_qubit), target_qubit(target_qubit)
+         {
+            m = build_matrix(pauli_z_c,2);
+         }
+
+         int64_t apply(qu_register& qreg)
+         {
+            diag_apply(m,target_qubit,(1UL << ctrl_qubit),qreg);
+            return 0;
+         }
+
+         void dump()
+         {
+            println("  [-] cphase(ctrl_qubit=" << ctrl_qubit << ", target_qubit=" << target_qubit << ")");
+         }
+
+         std::vector<uint64_t>  qubits()
+         {
+            std::vector<uint64_t> r;
+            r.push_back(ctrl_qubit);
+            r.push_back(target_qubit);
+            return r;
+         }
+
+         std::vector<uint64_t>  control_qubits()
+         {
+            std::vector<uint64_t> r;
+            r.push_back(ctrl_qubit);
+            return r;
+         }
+
+         std::vector<uint64_t>  target_qubits()
+         {
+            std::vector<uint64_t> r;
+            r.push_back(target_qubit);
+            return r;
+         }
+
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
+         bool is_diagonal()
+         {
+            return true;
+         }
+
+         gate_type_t type()
+         {
+            return __cphase_gate__; 
+         }
+
+   };
+
+   #define __custom_eps__ (1e-24)  // squared modulus under which a matrix entry is considered null
+
+   /**
+    * \brief  custom matrix gate
+    *     
+    */
+   class custom : public gate
+   {
+      private:
+
+         // std::vector<uint64_t> qubits;
+         uint64_t  qubit;
+         cmatrix_t m;
+
+      public:
+
+         // #ifdef __BUILTIN_LINALG__
+         //	   custom(std::vector<uint64_t>  qubits, qx::linalg::matrix<complex_t> m) : qubits(qubits), m(m)
+         // #else
+         custom(uint64_t  qubit, cmatrix_t m) : qubit(qubit), m(m)
+                                                // #endif 
+         {
+            //		 uint64_t size = 1 << qubits.size();
+            //		 if (size != m.size1() || size != m.size2())
+            //		    println("[x] error: cutom gate : the matrix size do not match the number of qubits !");
+            // verify also that the matrix is unitary
+            // #ifdef __BUILTIN_LINALG__
+            // cmatrix_t ctr(m.size2(),m.size1());
+            // qx::linalg::matrix<complex_t> ctr(m.size2(),m.size1());
+            // for (uint64_t i=0; i<m.size2(); ++i)
+            //    for (uint64_t j=0; j<m.size1(); ++j)
+            //       ctr(i,j) = m(j,i).conj();
+            // // cmatrix_t mxctr = mxm(m,ctr);
+            // qx::linalg::matrix<complex_t> mxctr = mxm(m,ctr);
+            // qx::linalg::identity_matrix<complex_t> id(m.size1());
+            // #else
+            // 		 cmatrix_t mxctr = mxm(m,ublas::trans(conj(m)));
+            // 		 ublas::identity_matrix<complex_t> id(m.size1());
+            // #endif
+
+            // #ifdef __BUILTIN_LINALG__
+            //		 if (qx::linalg::equals(mxctr,id))
+            // #else
+            // 		 if (equals(mxctr,id))
+            // #endif
+            //		    println("[x] error: custom gate : the specified matrix is not unitary !");
+         }
+
+         /**
+          * apply
+          */
+         int64_t apply(qu_register& qreg)
+         {
+            // a diagonal matrix keeps the basis state and an anti-diagonal one flips it
+            if (is_diagonal())
+            {
+               diag_apply(m,qubit,0,qreg);
+               return 0;
+            }
+            if (qreg.single_precision())
+               return apply_matrix(qreg);
+            sqg_apply(m,qubit,qreg);
+            if ((m(0,0).norm() < __custom_eps__) && (m(1,1).norm() < __custom_eps__))
+               qreg.flip_binary(qubit);
+            else
+               qreg.set_measurement_prediction(qubit,__state_unknown__);
+            return 0;
+         }
+
+         /**
+          * dump
+          */
+         void    dump()
+         {
+            println("  [-] custom matrix on qubit " << qubit);
+            // println("  [-] custom(qubits=" << qubits << ", matrix=" << m << ")");
+         }
+
+         std::vector<uint64_t>  qubits()
+         {
+            std::vector<uint64_t> r;
+            r.push_back(qubit);
+            return r;
+         }
+
+         std::vector<uint64_t>  control_qubits()
+         {
+            std::vector<uint64_t> r;
+            return r;
+         }
+
+         std::vector<uint64_t>  target_qubits()
+         {
+            std::vector<uint64_t> r;
+            r.push_back(qubit);
+            return r;
+         }
+
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
+         bool is_diagonal()
+         {
+            return ((m(0,1).norm() < __custom_eps__) && (m(1,0).norm() < __custom_eps__));
+         }
+
+         /**
+          * type
+          */
+         gate_type_t type()
+         {
+            return __custom_gate__; 
+         }
+   };
+  
+   
+
+   /**
+    * \brief 2x2 matrix on a target qubit controlled by any number of
+    *    qubits, applied by the multi-controlled kernel (see cu_apply())
+    */
+   class controlled_unitary : public gate
+   {
+      private:
+
+         std::vector<uint64_t> ctrl;
+         uint64_t              target;
+         cmatrix_t             m;
+
+      public:
+
+         controlled_unitary(std::vector<uint64_t> ctrl, uint64_t target, cmatrix_t m) : ctrl(ctrl), target(target), m(m)
+         {
+         }
+
+         int64_t apply(qu_register& qreg)
+         {
+            return apply_matrix(qreg);
+         }
+
+         void dump()
+         {
+            print("  [-] controlled unitary(ctrl_qubits=");
+            for (size_t c=0; c<ctrl.size(); ++c)
+               print((c ? "," : "") << ctrl[c]);
+            println(", target_qubit=" << target << ")");
+         }
+
+         std::vector<uint64_t>  qubits()
+         {
+            std::vector<uint64_t> r = ctrl;
+            r.push_back(target);
+            return r;
+         }
+
+         std::vector<uint64_t>  control_qubits()
+         {
+            return ctrl;
+         }
+
+         std::vector<uint64_t>  target_qubits()
+         {
+            std::vector<uint64_t> r;
+            r.push_back(target);
+            return r;
+         }
+
+         bool get_matrix(cmatrix_t& gm)
+         {
+            gm = m;
+            return true;
+         }
+
+         bool is_diagonal()
+         {
+            return ((m(0,1).norm() < __custom_eps__) && (m(1,0).norm() < __custom_eps__));
+         }
+
+         gate_type_t type()
+         {
+            return __controlled_unitary_gate__;
+         }
+   };
+
+
+   #define __dense_max_qubits__ 5
+
+   /**
+    * \brief offsets of the 2^k amplitudes of a sub-space relative to its
+    *    base index, and the dense matrix split in real and imaginary parts
+    *    (so that its entries can be broadcast straight from memory)
+    */
+   inline void __dense_setup(const std::vector<uint64_t>& qubits, const complex_t * matrix, uint64_t * offset, double * mre, double * mim)
+   {
+      size_t k   = qubits.size();
+      size_t dim = (1UL << k);
+      for (size_t j=0; j<dim; ++j)
+      {
+         offset[j] = 0;
+         for (size_t b=0; b<k; ++b)
+            if (j & (1UL << b))
+               offset[j] |= (1UL << qubits[b]);
+      }
+      for (size_t j=0; j<dim*dim; ++j)
+      {
+         mre[j] = matrix[j].re;
+         mim[j] = matrix[j].im;
+      }
+   }
+
+   /**
+    * \brief base index of the sub-space <x> : a zero bit is inserted at
+    *    the position of each (sorted) target qubit
+    */
+   inline uint64_t __dense_base(uint64_t x, const uint64_t * qubits, size_t k)
+   {
+      for (size_t b=0; b<k; ++b)
+         x = ((x >> qubits[b]) << (qubits[b]+1)) | (x & ((1UL << qubits[b])-1));
+      return x;
+   }
+
+   /**
+    * \brief dense k-qubit kernel (sse3) : one sub-space per iteration, the
+    *    products use the same x*re(m) + swap(x)*(im(m),-im(m)) form as the
+    *    single-qubit kernels
+    */
+   void __apply_dense_sse(complex_t * state, uint64_t n, const std::vector<uint64_t>& qubits, const complex_t * matrix)
+   {
+      size_t   k     = qubits.size();
+      size_t   dim   = (1UL << k);
+      int64_t  bases = (int64_t)(1UL << (n-k));
+      uint64_t offset[1UL << __dense_max_qubits__];
+      QX_ALIGNED(64) double mre[1UL << (2*__dense_max_qubits__)];
+      QX_ALIGNED(64) double mim[1UL << (2*__dense_max_qubits__)];
+      __dense_setup(qubits, matrix, offset, mre, mim);
+      const uint64_t * q    = qubits.data();
+      __m128d          sign = _mm_set_pd(-1.0, 1.0);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t b=0; b<bases; ++b)
+      {
+         complex_t * s = state + __dense_base(b, q, k);
+         __m128d     v[1UL << __dense_max_qubits__];
+         __m128d     sv[1UL << __dense_max_qubits__];
+         for (size_t c=0; c<dim; ++c)
+         {
+            v[c]  = s[offset[c]].xmm;
+            sv[c] = _mm_shuffle_pd(v[c], v[c], 1);
+         }
+         for (size_t r=0; r<dim; ++r)
+         {
+            __m128d re = _mm_setzero_pd();
+            __m128d im = _mm_setzero_pd();
+            for (size_t c=0; c<dim; ++c)
+            {
+               re = _mm_add_pd(re, _mm_mul_pd(v[c],  _mm_set1_pd(mre[r*dim+c])));
+               im = _mm_add_pd(im, _mm_mul_pd(sv[c], _mm_set1_pd(mim[r*dim+c])));
+            }
+            s[offset[r]].xmm = _mm_add_pd(re, _mm_mul_pd(im, sign));
+         }
+      }
+   }
+
+   /**
+    * \brief dense k-qubit kernel (avx2) : two adjacent sub-spaces per
+    *    iteration, requires at least two sub-spaces
+    */
+   QX_TARGET_AVX2 void __apply_dense_avx2(complex_t * state, uint64_t n, const std::vector<uint64_t>& qubits, const complex_t * matrix)
+   {
+      size_t   k     = qubits.size();
+      size_t   dim   = (1UL << k);
+      int64_t  bases = (int64_t)(1UL << (n-k));
+      uint64_t offset[1UL << __dense_max_qubits__];
+      QX_ALIGNED(64) double mre[1UL << (2*__dense_max_qubits__)];
+      QX_ALIGNED(64) double mim[1UL << (2*__dense_max_qubits__)];
+      __dense_setup(qubits, matrix, offset, mre, mim);
+      const uint64_t * q    = qubits.data();
+
+      if (qubits[0] == 0)
+      {
+         // adjacent sub-spaces are <step> apart : pair them in the two
+         // 128-bit lanes
+         uint64_t step = 1;
+         for (size_t j=0; (j<k) && (qubits[j] == j); ++j)
+            step <<= 1;
+         __m256d sign = _mm256_set_pd(-1.0, 1.0, -1.0, 1.0);
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+         for (int64_t b=0; b<bases; b+=2)
+         {
+            complex_t * s = state + __dense_base(b, q, k);
+            __m256d     v[1UL << __dense_max_qubits__];
+            __m256d     sv[1UL << __dense_max_qubits__];
+            for (size_t c=0; c<dim; ++c)
+            {
+               v[c]  = _mm256_insertf128_pd(_mm256_castpd128_pd256(s[offset[c]].xmm), s[offset[c]+step].xmm, 1);
+               sv[c] = _mm256_permute_pd(v[c], 5);
+            }
+            for (size_t r=0; r<dim; ++r)
+            {
+               __m256d re = _mm256_setzero_pd();
+               __m256d im = _mm256_setzero_pd();
+               for (size_t c=0; c<dim; ++c)
+               {
+                  re = _mm256_fmadd_pd(v[c],  _mm256_broadcast_sd(mre+r*dim+c), re);
+                  im = _mm256_fmadd_pd(sv[c], _mm256_broadcast_sd(mim+r*dim+c), im);
+               }
+               __m256d o = _mm256_fmadd_pd(im, sign, re);
+               s[offset[r]].xmm      = _mm256_castpd256_pd128(o);
+               s[offset[r]+step].xmm = _mm256_extractf128_pd(o, 1);
+            }
+         }
+         return;
+      }
+
+      __m256d sign = _mm256_set_pd(-1.0, 1.0, -1.0, 1.0);
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t b=0; b<bases; b+=2)
+      {
+         double * s = (double *)(state + __dense_base(b, q, k));
+         __m256d  v[1UL << __dense_max_qubits__];
+         __m256d  sv[1UL << __dense_max_qubits__];
+         for (size_t c=0; c<dim; ++c)
+         {
+            v[c]  = _mm256_loadu_pd(s + 2*offset[c]);
+            sv[c] = _mm256_permute_pd(v[c], 5);
+         }
+         for (size_t r=0; r<dim; ++r)
+         {
+            __m256d re = _mm256_setzero_pd();
+            __m256d im = _mm256_setzero_pd();
+            for (size_t c=0; c<dim; ++c)
+            {
+               re = _mm256_fmadd_pd(v[c],  _mm256_broadcast_sd(mre+r*dim+c), re);
+               im = _mm256_fmadd_pd(sv[c], _mm256_broadcast_sd(mim+r*dim+c), im);
+            }
+            _mm256_storeu_pd(s + 2*offset[r], _mm256_fmadd_pd(im, sign, re));
+         }
+      }
+   }
+
+// same gcc 12 false positive in _mm512_permute_pd
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+   /**
+    * \brief dense k-qubit kernel (avx-512) : four adjacent sub-spaces per
+    *    iteration, requires the lowest target qubit to be >= 2
+    */
+   QX_TARGET_AVX512 void __apply_dense_avx512(complex_t * state, uint64_t n, const std::vector<uint64_t>& qubits, const complex_t * matrix)
+   {
+      size_t   k     = qubits.size();
+      size_t   dim   = (1UL << k);
+      int64_t  bases = (int64_t)(1UL << (n-k));
+      uint64_t offset[1UL << __dense_max_qubits__];
+      QX_ALIGNED(64) double mre[1UL << (2*__dense_max_qubits__)];
+      QX_ALIGNED(64) double mim[1UL << (2*__dense_max_qubits__)];
+      __dense_setup(qubits, matrix, offset, mre, mim);
+      const uint64_t * q    = qubits.data();
+      __m512d          sign = _mm512_set_pd(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t b=0; b<bases; b+=4)
+      {
+         double * s = (double *)(state + __dense_base(b, q, k));
+         __m512d  v[1UL << __dense_max_qubits__];
+         __m512d  sv[1UL << __dense_max_qubits__];
+         for (size_t c=0; c<dim; ++c)
+         {
+            v[c]  = _mm512_loadu_pd(s + 2*offset[c]);
+            sv[c] = _mm512_permute_pd(v[c], 0x55);
+         }
+         for (size_t r=0; r<dim; ++r)
+         {
+            __m512d re = _mm512_setzero_pd();
+            __m512d im = _mm512_setzero_pd();
+            for (size_t c=0; c<dim; ++c)
+            {
+               re = _mm512_fmadd_pd(v[c],  _mm512_set1_pd(mre[r*dim+c]), re);
+               im = _mm512_fmadd_pd(sv[c], _mm512_set1_pd(mim[r*dim+c]), im);
+            }
+            _mm512_storeu_pd(s + 2*offset[r], _mm512_fmadd_pd(im, sign, re));
+         }
+      }
+   }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+   /**
+    * \brief apply a dense 2^k x 2^k matrix (row-major, bit j of an index
+    *    refers to qubits[j]) to the sorted qubits <qubits>, k <= 5 : the
+    *    2^k amplitudes of each sub-space are loaded once and the whole
+    *    matrix, small enough to stay in L1, is applied to them
+    */
+   void __apply_dense(complex_t * state, uint64_t n, const std::vector<uint64_t>& qubits, const complex_t * matrix)
+   {
+      xpu::isa_t isa = xpu::get_isa();
+      if ((isa == xpu::__isa_avx512__) && (qubits[0] >= 2))
+         __apply_dense_avx512(state, n, qubits, matrix);
+      else if ((isa >= xpu::__isa_avx2__) && (qubits.size() < n))
+         __apply_dense_avx2(state, n, qubits, matrix);
+      else
+         __apply_dense_sse(state, n, qubits, matrix);
+   }
+
+   /**
+    * \brief single precision dense k-qubit kernel
+    */
+   void __apply_dense_f(complex_f_t * state, uint64_t n, const std::vector<uint64_t>& qubits, const complex_t * matrix)
+   {
+      size_t   k     = qubits.size();
+      size_t   dim   = (1UL << k);
+      int64_t  bases = (int64_t)(1UL << (n-k));
+      uint64_t offset[1UL << __dense_max_qubits__];
+      double   mre[1UL << (2*__dense_max_qubits__)];
+      double   mim[1UL << (2*__dense_max_qubits__)];
+      float    fre[1UL << (2*__dense_max_qubits__)];
+      float    fim[1UL << (2*__dense_max_qubits__)];
+      __dense_setup(qubits, matrix, offset, mre, mim);
+      for (size_t j=0; j<dim*dim; ++j)
+      {
+         fre[j] = (float)mre[j];
+         fim[j] = (float)mim[j];
+      }
+      const uint64_t * q = qubits.data();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int64_t b=0; b<bases; ++b)
+      {
+         complex_f_t * s = state + __dense_base(b, q, k);
+         float         vre[1UL << __dense_max_qubits__];
+         float         vim[1UL << __dense_max_qubits__];
+         for (size_t c=0; c<dim; ++c)
+         {
+            vre[c] = s[offset[c]].re;
+            vim[c] = s[offset[c]].im;
+         }
+         for (size_t r=0; r<dim; ++r)
+         {
+            float re = 0.f, im = 0.f;
+            for (size_t c=0; c<dim; ++c)
+            {
+               re += fre[r*dim+c]*vre[c] - fim[r*dim+c]*vim[c];
+               im += fre[r*dim+c]*vim[c] + fim[r*dim+c]*vre[c];
+            }
+            s[offset[r]] = complex_f_t(re,im);
+         }
+      }
+   }
+
+   /**
+    * \brief dense unitary on up to 5 qubits, produced by the multi-qubit
+    *    fusion pass : bit j of a row/column index refers to qubits[j]
+    */
+   class dense_unitary : public gate
+   {
+      private:
+
+         std::vector<uint64_t>   qubit;
+         std::vector<complex_t>  m;
+
+      public:
+
+         dense_unitary(std::vector<uint64_t> qubits, std::vector<complex_t> m) : qubit(qubits), m(m)
+         {
+            assert(qubit.size() <= __dense_max_qubits__);
+            assert(m.size() == ((1UL << qubit.size()) << qubit.size()));
+         }
+
+         int64_t apply(qu_register& qreg)
+         {
+            if (qreg.single_precision())
+               __apply_dense_f(qreg.get_data_f().data(), qreg.size(), qubit, m.data());
+            else
+               __apply_dense(qreg.get_data().data(), qreg.size(), qubit, m.data());
+
+            // a known basis state stays known if its column has a single non-zero entry
+            size_t   dim   = (1UL << qubit.size());
+            uint64_t c     = 0;
+            bool     known = true;
+            for (size_t q=0; q<qubit.size(); ++q)
+            {
+               state_t s = qreg.get_measurement_prediction(qubit[q]);
+               if (s == __state_unknown__)
+                  known = false;
+               else if (s == __state_1__)
+                  c |= (1UL << q);
+            }
+            if (known)
+            {
+               size_t nz = 0, row = 0;
+               for (size_t r=0; r<dim; ++r)
+                  if (m[r*dim+c].norm() >= __custom_eps__)
+                  {
+                     nz++;
+                     row = r;
+                  }
+               for (size_t q=0; q<qubit.size(); ++q)
+                  qreg.set_measurement_prediction(qubit[q], (nz != 1 ? __state_unknown__ : ((row >> q) & 1 ? __state_1__ : __state_0__)));
+               return 0;
+            }
+            for (size_t r=0; r<dim; ++r)
+               for (size_t k=0; k<dim; ++k)
+                  if ((r != k) && (m[r*dim+k].norm() >= __custom_eps__))
+                  {
+                     for (size_t q=0; q<qubit.size(); ++q)
+                        qreg.set_measurement_prediction(qubit[q],__state_unknown__);
+                     return 0;
+                  }
+            return 0;
+         }
+
+         void dump()
+         {
+            print("  [-] dense unitary on qubits (");
+            for (size_t q=0; q<qubit.size(); ++q)
+               print((q ? "," : "") << qubit[q]);
+            println(")");
+         }
+
+         /**
+          * \brief matrix of the gate (row-major, bit b of its indices is
+          *    qubit qubits()[b])
+          */
+         const std::vector<complex_t>& get_dense_matrix()
+         {
+            return m;
+         }
+
+         std::vector<uint64_t>  qubits()
+         {
+            return qubit;
+         }
+
+         std::vector<uint64_t>  control_qubits()
+         {
+            std::vector<uint64_t> r;
+            return r;
+         }
+
+         std::vector<uint64_t>  target_qubits()
+         {
+            return qubit;
+         }
+
+         gate_type_t type()
+         {
+            return __dense_unitary_gate__;
+         }
+   };
+
+
+   #define __diagonal_max_qubits__ 10
+
+   /**
+    * \brief index of the entry of a diagonal on the sorted qubits <qubits>
+    *    selected by the basis state <x>
+    */
+   inline uint64_t __diagonal_index(uint64_t x, const std::vector<uint64_t>& qubits)
+   {
+      uint64_t j = 0;
+      for (size_t b=0; b<qubits.size(); ++b)
+         j |= ((x >> qubits[b]) & 1UL) << b;
+      return j;
+   }
+
+   /**
+    * \brief apply the phases <d> of the basis states of the sorted qubits
+    *    <qubits> (bit j of an index of <d> refers to qubits[j]) in a single
+    *    pass over blocks of 2^10 amplitudes : the phases of a block combine
+    *    a table of the low bits of the indices, shared by all the blocks,
+    *    with the bits of the block, and are only gathered again when the
+    *    latter change
+    */
+   template <typename amplitude_t>
+   void __apply_diagonal(amplitude_t * state, uint64_t n, const std::vector<uint64_t>& qubits, const complex_t * d)
+   {
+      uint64_t              block  = std::min<uint64_t>(1UL << n, __phase_chunk__);
+      int64_t               blocks = (int64_t)((1UL << n)/block);
+      xpu::isa_t            isa    = xpu::get_isa();
+      std::vector<uint32_t> low(block);
+      for (uint64_t l=0; l<block; ++l)
+         low[l] = (uint32_t)__diagonal_index(l, qubits);
+
+#ifdef USE_OPENMP
+#pragma omp parallel
+#endif
+      {
+         // phases of the current block, rebuilt when the bits of the block change
+         std::vector<complex_t> row(block);
+         uint64_t               last = ~0UL;
+#ifdef USE_OPENMP
+#pragma omp for
+#endif
+         for (int64_t h=0; h<blocks; ++h)
+         {
+            uint64_t hi = __diagonal_index((uint64_t)h*block, qubits);
+            if (hi != last)
+            {
+               for (uint64_t l=0; l<block; ++l)
+                  row[l] = d[low[l] | hi];
+               last = hi;
+            }
+            __phase_row(state + (uint64_t)h*block, row.data(), block, isa);
+         }
+      }
+   }
+
+   /**
+    * \brief diagonal unitary on up to 10 qubits, produced by the fusion of
+    *    consecutive diagonal gates : the phase of the basis state i of the
+    *    qubits is d[i], bit j of i referring to qubits[j]
+    */
+   class diagonal_unitary : public gate
+   {
+      private:
+
+         std::vector<uint64_t>   qubit;
+         std::vector<complex_t>  d;
+
+      public:
+
+         diagonal_unitary(std::vector<uint64_t> qubits, std::vector<complex_t> d) : qubit(qubits), d(d)
+         {
+            assert(qubit.size() <= __diagonal_max_qubits__);
+            assert(d.size() == (1UL << qubit.size()));
+         }
+
+         int64_t apply(qu_register& qreg)
+         {
+            if (qreg.single_precision())
+               __apply_diagonal(qreg.get_data_f().data(), qreg.size(), qubit, d.data());
+            else
+               __apply_diagonal(qreg.get_data().data(), qreg.size(), qubit, d.data());
+            return 0;
+         }
+
+         void dump()
+         {
+            print("  [-] diagonal unitary on qubits (");
+            for (size_t q=0; q<qubit.size(); ++q)
+               print((q ? "," : "") << qubit[q]);
+            println(")");
+         }
+
+         std::vector<uint64_t>  qubits()
+         {
+            return qubit;
+         }
+
+         std::vector<uint64_t>  control_qubits()
+         {
+            std::vector<uint64_t> r;
+            return r;
+         }
+
+         std::vector<uint64_t>  target_qubits()
+         {
+            return qubit;
+         }
+
+         bool is_diagonal()
+         {
+            return true;
+         }
+
+         bool get_diagonal(std::vector<complex_t>& phases)
+         {
+            phases = d;
+            return true;
+         }
+
+         gate_type_t type()
+         {
+            return __diagonal_unitary_gate__;
+         }
+   };
+
+   #define __permutation_max_qubits__ 10
+
+   /**
+    * \brief permutation of up to 10 qubits, produced by the fusion of
+    *    consecutive swaps : the state of qubits[k] moves to qubit dest[k]
+    */
+   class qubit_permutation : public gate
+   {
+      private:
+
+         std::vector<uint64_t>   qubit;
+         std::vector<uint64_t>   dest;
+
+      public:
+
+         qubit_permutation(std::vector<uint64_t> qubits, std::vector<uint64_t> dest) : qubit(qubits), dest(dest)
+         {
+            assert(qubit.size() <= __permutation_max_qubits__);
+            assert(dest.size() == qubit.size());
+         }
+
+         int64_t apply(qu_register& qreg)
+         {
+            perm_apply(qubit,dest,qreg);
+            return 0;
+         }
+
+         bool get_permutation(std::vector<uint64_t>& d)
+         {
+            d = dest;
+            return true;
+         }
+
+         void dump()
+         {
+            print("  [-] qubit permutation (");
+            for (size_t q=0; q<qubit.size(); ++q)
+               print((q ? "," : "") << qubit[q] << "->" << dest[q]);
+            println(")");
+         }
+
+         std::vector<uint64_t>  qubits()
+         {
+            return qubit;
+         }
+
+         std::vector<uint64_t>  control_qubits()
+         {
+            std::vector<uint64_t> r;
+            return r;
+         }
+
+         std::vector<uint64_t>  target_qubits()
+         {
+            return qubit;
+         }
+
+         gate_type_t type()
+         {
+            return __permutation_gate__;
+         }
+   };
+
+   #define __tile_qubits__ 14
+
+   /**
+    * \brief consecutive gates acting on the qubits below __tile_qubits__,
+    *    produced by circuit::tile() : the gates are applied one block of
+    *    2^14 amplitudes (256 KiB in double precision) at a time, so that a
+    *    block stays in the cache from one gate to the next and the whole
+    *    group costs a single pass over the state vector. the gates must
+    *    expose their (controlled) 2x2 matrix, permutation or diagonal.
+    */
+   class tiled_gates : public gate
+   {
+      private:
+
+         typedef enum
+         {
+            __tile_matrix__,
+            __tile_permutation__,
+            __tile_diagonal__
+         } tile_op_t;
+
+         std::vector<gate *>                  gates;
+         std::vector<tile_op_t>               op;
+         std::vector<std::vector<uint64_t> >  qubit;
+         std::vector<uint64_t>                target;
+         std::vector<cmatrix_t>               m;
+         std::vector<uint64_t>                cmask;
+         std::vector<std::vector<uint64_t> >  dest;
+         std::vector<std::vector<complex_t> > d;
+
+         /**
+          * \brief apply the gates to each block of the <n> qubits of <state>
+          */
+         template <typename amplitude_t>
+         void apply_blocks(amplitude_t * state, uint64_t n)
+         {
+            int64_t blocks = (int64_t)(1UL << (n-__tile_qubits__));
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+            for (int64_t b=0; b<blocks; ++b)
+            {
+               amplitude_t * s = state + ((uint64_t)b << __tile_qubits__);
+               for (size_t i=0; i<gates.size(); ++i)
+               {
+                  switch (op[i])
+                  {
+                     case __tile_matrix__ :
+                        __apply_cmatrix(s, __tile_qubits__, target[i], cmask[i], m[i]);
+                        break;
+                     case __tile_permutation__ :
+                        __apply_permutation(s, __tile_qubits__, qubit[i], dest[i]);
+                        break;
+                     case __tile_diagonal__ :
+                        __apply_diagonal(s, __tile_qubits__, qubit[i], d[i].data());
+                        break;
+                  }
+               }
+            }
+         }
+
+      public:
+
+         /**
+          * \brief check whether <g> can be applied block by block
+          */
+         static bool supports(gate * g)
          {
-            std::vector<uint64_t> r;
-            r.push_back(qubit1);
-            r.push_back(qubit2);
-            return r;
+            std::vector<uint64_t>  qubits = g->qubits();
+            std::vector<uint64_t>  p;
+            std::vector<complex_t> phases;
+            cmatrix_t              gm;
+            for (size_t q=0; q<qubits.size(); ++q)
+               if (qubits[q] >= __tile_qubits__)
+                  return false;
+            if ((g->target_qubits().size() == 1) && g->get_matrix(gm))
+               return true;
+            return (g->get_permutation(p) || g->get_diagonal(phases));
          }
 
-         gate_type_t type()
+         tiled_gates(std::vector<gate *> group) : gates(group)
          {
-            return __swap_gate__; 
+            for (size_t i=0; i<gates.size(); ++i)
+            {
+               cmatrix_t              gm;
+               std::vector<uint64_t>  p;
+               std::vector<complex_t> phases;
+               std::vector<uint64_t>  ctrl = gates[i]->control_qubits();
+               uint64_t               c    = 0;
+               for (size_t k=0; k<ctrl.size(); ++k)
+                  c |= (1UL << ctrl[k]);
+               if ((gates[i]->target_qubits().size() == 1) && gates[i]->get_matrix(gm))
+                  op.push_back(__tile_matrix__);
+               else if (gates[i]->get_permutation(p))
+                  op.push_back(__tile_permutation__);
+               else
+               {
+                  gates[i]->get_diagonal(phases);
+                  op.push_back(__tile_diagonal__);
+               }
+               qubit.push_back(gates[i]->qubits());
+               target.push_back(gates[i]->target_qubits()[0]);
+               m.push_back(gm);
+               cmask.push_back(c);
+               dest.push_back(p);
+               d.push_back(phases);
+            }
          }
 
-   };
-   
-   
-   /**
-    * \brief cphase
-    */
-   class cphase : public gate
-   {
-      private:
-
-         uint64_t ctrl_qubit;
-         uint64_t target_qubit;
-
-      public:
-
-         cphase(uint64_t ctrl_qubit, uint64_t target_qubit) : ctrl_qubit(ctrl_qubit), target_qubit(target_qubit)
+         ~tiled_gates()
          {
+            for (size_t i=0; i<gates.size(); ++i)
+               delete gates[i];
          }
 
          int64_t apply(qu_register& qreg)
          {
-            hadamard(target_qubit).apply(qreg);
-            cnot(ctrl_qubit,target_qubit).apply(qreg);
-            hadamard(target_qubit).apply(qreg);
+            uint64_t n = qreg.size();
+            if (n <= __tile_qubits__)
+            {
+               for (size_t i=0; i<gates.size(); ++i)
+                  gates[i]->apply(qreg);
+               return 0;
+            }
+            if (qreg.single_precision())
+               apply_blocks(qreg.get_data_f().data(), n);
+            else
+               apply_blocks(qreg.get_data().data(), n);
+
+            // the predictions only depend on the previous predictions
+            for (size_t i=0; i<gates.size(); ++i)
+               if (op[i] == __tile_matrix__)
+                  cu_predict(m[i], target[i], gates[i]->control_qubits(), qreg);
+               else if (op[i] == __tile_permutation__)
+                  perm_predict(qubit[i], dest[i], qreg);
             return 0;
          }
 
          void dump()
          {
-            println("  [-] cphase(ctrl_qubit=" << ctrl_qubit << ", target_qubit=" << target_qubit << ")");
+            println("  [-] tiled gates (" << gates.size() << " gates on qubits < " << __tile_qubits__ << ") :");
+            for (size_t i=0; i<gates.size(); ++i)
+            {
+               print("   ");
+               gates[i]->dump();
+            }
+         }
+
+         std::vector<gate *> get_gates()
+         {
+            return gates;
          }
 
          std::vector<uint64_t>  qubits()
          {
             std::vector<uint64_t> r;
-            r.push_back(ctrl_qubit);
-            r.push_back(target_qubit);
+            for (size_t i=0; i<gates.size(); ++i)
+            {
+               std::vector<uint64_t> q = gates[i]->qubits();
+               for (size_t k=0; k<q.size(); ++k)
+                  if (std::find(r.begin(),r.end(),q[k]) == r.end())
+                     r.push_back(q[k]);
+            }
+            std::sort(r.begin(),r.end());
             return r;
          }
 
          std::vector<uint64_t>  control_qubits()
          {
             std::vector<uint64_t> r;
-            r.push_back(ctrl_qubit);
             return r;
          }
 
          std::vector<uint64_t>  target_qubits()
          {
-            std::vector<uint64_t> r;
-            r.push_back(target_qubit);
-            return r;
+            return qubits();
          }
 
          gate_type_t type()
          {
-            return __cphase_gate__; 
+            return __tiled_gates__;
          }
-
    };
 
    /**
-    * \brief  custom matrix gate
-    *     
+    * \brief check whether <g> can be rewritten on other qubits (see
+    *    relocate()) : single-qubit gates with any controls, permutations
+    *    and diagonal gates
     */
-   class custom : public gate
+   inline bool is_relocatable(gate * g)
    {
-      private:
-
-         // std::vector<uint64_t> qubits;
-         uint64_t  qubit;
-         cmatrix_t m;
-
-      public:
-
-         // #ifdef __BUILTIN_LINALG__
-         //	   custom(std::vector<uint64_t>  qubits, qx::linalg::matrix<complex_t> m) : qubits(qubits), m(m)
-         // #else
-         custom(uint64_t  qubit, cmatrix_t m) : qubit(qubit), m(m)
-                                                // #endif 
-         {
-            //		 uint64_t size = 1 << qubits.size();
-            //		 if (size != m.size1() || size != m.size2())
-            //		    println("[x] error: cutom gate : the matrix size do not match the number of qubits !");
-            // verify also that the matrix is unitary
-            // #ifdef __BUILTIN_LINALG__
-            // cmatrix_t ctr(m.size2(),m.size1());
-            // qx::linalg::matrix<complex_t> ctr(m.size2(),m.size1());
-            // for (uint64_t i=0; i<m.size2(); ++i)
-            //    for (uint64_t j=0; j<m.size1(); ++j)
-            //       ctr(i,j) = m(j,i).conj();
-            // // cmatrix_t mxctr = mxm(m,ctr);
-            // qx::linalg::matrix<complex_t> mxctr = mxm(m,ctr);
-            // qx::linalg::identity_matrix<complex_t> id(m.size1());
-            // #else
-            // 		 cmatrix_t mxctr = mxm(m,ublas::trans(conj(m)));
-            // 		 ublas::identity_matrix<complex_t> id(m.size1());
-            // #endif
-
-            // #ifdef __BUILTIN_LINALG__
-            //		 if (qx::linalg::equals(mxctr,id))
-            // #else
-            // 		 if (equals(mxctr,id))
-            // #endif
-            //		    println("[x] error: custom gate : the specified matrix is not unitary !");
-         }
-
-         /**
-          * apply
-          */
-         int64_t apply(qu_register& qreg)
-         {
-            sqg_apply(m,qubit,qreg);
-            qreg.set_measurement_prediction(qubit,__state_unknown__);
-            return 0;
-         }
-
-         /**
-          * dump
-          */
-         void    dump()
-         {
-            println("  [-] custom matrix on qubit " << qubit);
-            // println("  [-] custom(qubits=" << qubits << ", matrix=" << m << ")");
-         }
+      cmatrix_t              m;
+      std::vector<uint64_t>  p;
+      std::vector<complex_t> d;
+      if ((g->target_qubits().size() == 1) && g->get_matrix(m))
+         return true;
+      return (g->get_permutation(p) || g->get_diagonal(d));
+   }
 
-         /**
-          * type
-          */
-         gate_type_t type()
+   /**
+    * \brief new gate applying the relocatable gate <g> (see
+    *    is_relocatable()) to the qubits phys[q] instead of its qubits q
+    */
+   inline gate * relocate(gate * g, const std::vector<uint64_t>& phys)
+   {
+      std::vector<uint64_t>  qubits = g->qubits();
+      cmatrix_t              m;
+      std::vector<uint64_t>  p;
+      std::vector<complex_t> d;
+      if ((g->target_qubits().size() == 1) && g->get_matrix(m))
+      {
+         std::vector<uint64_t> ctrl = g->control_qubits();
+         uint64_t              t    = phys[g->target_qubits()[0]];
+         for (size_t c=0; c<ctrl.size(); ++c)
+            ctrl[c] = phys[ctrl[c]];
+         if (ctrl.empty())
+            return new custom(t,m);
+         return new controlled_unitary(ctrl,t,m);
+      }
+      if (g->get_permutation(p))
+      {
+         for (size_t k=0; k<qubits.size(); ++k)
          {
-            return __custom_gate__; 
+            qubits[k] = phys[qubits[k]];
+            p[k]      = phys[p[k]];
          }
-   };
-  
-   
+         return new qubit_permutation(qubits,p);
+      }
+      // bit k of the phases refers to qubits[k] : reorder them for the
+      // sorted new qubits
+      g->get_diagonal(d);
+      std::vector<uint64_t> sorted(qubits.size());
+      for (size_t k=0; k<qubits.size(); ++k)
+         sorted[k] = phys[qubits[k]];
+      std::sort(sorted.begin(),sorted.end());
+      std::vector<uint64_t> bit(qubits.size());
+      for (size_t k=0; k<qubits.size(); ++k)
+         bit[k] = std::find(sorted.begin(),sorted.end(),phys[qubits[k]]) - sorted.begin();
+      std::vector<complex_t> e(d.size());
+      for (size_t x=0; x<d.size(); ++x)
+      {
+         uint64_t j = 0;
+         for (size_t k=0; k<qubits.size(); ++k)
+            j |= ((x >> bit[k]) & 1UL) << k;
+         e[x] = d[j];
+      }
+      return new diagonal_unitary(sorted,e);
+   }
 
    double p1_worker(uint64_t cs, uint64_t ce, uint64_t qubit, cvector_t * p_data)
    {
@@ -2755,10 +4925,11 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
       uint64_t offset = 0;
 
       // We need to calculate the "offset_start" in order to maintain the 
-      // correctness of the index calculation in the parallel region
+      // correctness of the index calculation in the parallel region : the
+      // i-th amplitude with the qubit set is at i + (i/ref+1)*ref
       uint64_t reminder = cs % ref;
       uint64_t factor = std::floor((cs - reminder) / ref);
-      uint64_t offset_start = factor * ref;
+      uint64_t offset_start = factor * ref + ref;
 
       offset = offset_start;
 
@@ -2785,49 +4956,82 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
       return local_p1;
    }
 
-   inline double zero_worker_norm(uint64_t cs, uint64_t ce, cvector_t * p_data)
+   inline double zero_worker_norm_sse(uint64_t cs, uint64_t ce, cvector_t * p_data)
    {
-      uint64_t num_elts = ce - cs;
-      uint64_t tile_size = std::min<uint64_t>(num_elts, 32UL);
       complex_t * vd = p_data->data();
       double local_length = 0.;
 
-#if defined(__AVX__)
-      __m256d sum = _mm256_set1_pd(0.0);
-      for (uint64_t i=cs; i<ce; i+=tile_size)
-      {
-         for (uint64_t j=i, end=std::min(ce,tile_size+i); j<end; j+=2)
-         {
-            double * pvd = (double*)&vd[j];
-            sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_load_pd(pvd), _mm256_load_pd(pvd)));
-         }
-      }
-      __m256d r2 = _mm256_hadd_pd(sum, sum);
-      local_length = _mm_cvtsd_f64(_mm_add_pd(_mm256_extractf128_pd(r2, 1),
-                                              _mm256_castpd256_pd128(r2)));
-#elif defined(__SSE__)
+#if defined(__SSE__)
       __m128d sum = _mm_set1_pd(0.0);
-      for (uint64_t i=cs; i<ce; i+=tile_size)
+      for (uint64_t j=cs; j<ce; ++j)
       {
-         for (uint64_t j=i, end=std::min(ce,tile_size+i); j<end; ++j)
-         {
-            double * pvd = (double*)&vd[j];
-            sum = _mm_add_pd(sum, _mm_mul_pd(_mm_load_pd(pvd), _mm_load_pd(pvd)));
-         }
+         double * pvd = (double*)&vd[j];
+         sum = _mm_add_pd(sum, _mm_mul_pd(_mm_load_pd(pvd), _mm_load_pd(pvd)));
       }
       local_length = _mm_cvtsd_f64(_mm_hadd_pd(sum, sum));
 #else
-      for (uint64_t i=cs; i<ce; i+=tile_size)
+      for (uint64_t j=cs; j<ce; ++j)
+         local_length += vd[j].norm();
+#endif
+      return local_length;
+   }
+
+   QX_TARGET_AVX2 inline double zero_worker_norm_avx2(uint64_t cs, uint64_t ce, cvector_t * p_data)
+   {
+      complex_t * vd = p_data->data();
+      uint64_t    j  = cs;
+
+      __m256d sum = _mm256_set1_pd(0.0);
+      for (; j+2<=ce; j+=2)
       {
-         for (uint64_t j=i, end=std::min(ce,tile_size+i); j<end; j+=2) 
-         {
-            local_length += data[j].norm() + data[j+1].norm();
-         }
+         __m256d v = _mm256_loadu_pd((double*)&vd[j]);
+         sum = _mm256_fmadd_pd(v, v, sum);
       }
+      __m128d r = _mm_add_pd(_mm256_extractf128_pd(sum, 1), _mm256_castpd256_pd128(sum));
+      double local_length = _mm_cvtsd_f64(_mm_hadd_pd(r, r));
+      for (; j<ce; ++j)
+         local_length += vd[j].norm();
+      return local_length;
+   }
+
+// same gcc 12 false positive in _mm512_reduce_add_pd
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
 #endif
+
+   QX_TARGET_AVX512 inline double zero_worker_norm_avx512(uint64_t cs, uint64_t ce, cvector_t * p_data)
+   {
+      complex_t * vd = p_data->data();
+      uint64_t    j  = cs;
+
+      __m512d sum = _mm512_set1_pd(0.0);
+      for (; j+4<=ce; j+=4)
+      {
+         __m512d v = _mm512_loadu_pd((double*)&vd[j]);
+         sum = _mm512_fmadd_pd(v, v, sum);
+      }
+      double local_length = _mm512_reduce_add_pd(sum);
+      for (; j<ce; ++j)
+         local_length += vd[j].norm();
       return local_length;
    }
 
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+   inline double zero_worker_norm(uint64_t cs, uint64_t ce, cvector_t * p_data)
+   {
+      switch (xpu::get_isa())
+      {
+         case xpu::__isa_avx512__ : return zero_worker_norm_avx512(cs, ce, p_data);
+         case xpu::__isa_avx2__   : return zero_worker_norm_avx2(cs, ce, p_data);
+         default                  : return zero_worker_norm_sse(cs, ce, p_data);
+      }
+   }
+
    inline double zero_worker_true(uint64_t cs, uint64_t ce, uint64_t s, /*double * length,*/ uint64_t qubit, /*xpu::lockable * l, */cvector_t * p_data)
    {
       cvector_t &data = * p_data;
@@ -2863,7 +5067,7 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
       return zero_worker_norm(cs, ce, p_data);
    }
 
-   int renorm_worker(uint64_t cs, uint64_t ce, uint64_t s, double * length, cvector_t * p_data)
+   int renorm_worker_sse(uint64_t cs, uint64_t ce, uint64_t s, double * length, cvector_t * p_data)
    {
       cvector_t &data = * p_data;
       double l = *length;
@@ -2872,70 +5076,87 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
       uint64_t tile_size = std::min<uint64_t>(num_elts, 16UL);
       complex_t * vd = p_data->data();
 
-#ifdef __AVX512F__
-      __m512d vl = _mm512_set1_pd(l_rec);
+#if defined(__SSE__)
+      __m128d vl = _mm_set1_pd(l_rec);
 #ifdef USE_OPENMP
 #pragma omp parallel for
 #endif
-      for (uint64_t i=cs; i<ce; i+=tile_size)
+      for (int64_t i=cs; i<(int64_t)ce; i+=tile_size)
       {
-         for (uint64_t j=i, end=std::min(ce,tile_size+i); j<end; j+=4)
+         for (uint64_t j=(uint64_t)i, end=std::min(ce,tile_size+(uint64_t)i); j<end; ++j)
          {
             double * pvd = (double*)&vd[j];
-            _mm512_store_pd(pvd, _mm512_mul_pd(_mm512_load_pd(pvd), vl));
+            _mm_store_pd(pvd, _mm_mul_pd(_mm_load_pd(pvd), vl));
          }
       }
-#elif defined(__AVX__)
-      __m256d vl = _mm256_set1_pd(l_rec);
+#else
 #ifdef USE_OPENMP
 #pragma omp parallel for
 #endif
       for (int64_t i=cs; i<(int64_t)ce; i+=tile_size)
       {
-         for (uint64_t j=(uint64_t)i, end=std::min(ce,tile_size+(uint64_t)i); j<end; j+=2)
+         for (uint64_t j=(uint64_t)i, end=std::min(ce,tile_size+(uint64_t)i); j<end; ++j)
          {
-            double * pvd = (double*)&vd[j];
-            _mm256_store_pd(pvd, _mm256_mul_pd(_mm256_load_pd(pvd), vl));
+            data[j] *= l_rec;
          }
       }
-#elif defined(__SSE__)
-      __m128d vl = _mm_set1_pd(l_rec);
+#endif
+
+      return 0;
+   }
+
+   QX_TARGET_AVX2 int renorm_worker_avx2(uint64_t cs, uint64_t ce, uint64_t s, double * length, cvector_t * p_data)
+   {
+      double l_rec = 1./(*length);
+      complex_t * vd = p_data->data();
+      __m256d vl = _mm256_set1_pd(l_rec);
+
 #ifdef USE_OPENMP
 #pragma omp parallel for
 #endif
-      for (int64_t i=cs; i<(int64_t)ce; i+=tile_size)
+      for (int64_t j=cs; j<(int64_t)ce; j+=2)
       {
-         for (uint64_t j=(uint64_t)i, end=std::min(ce,tile_size+(uint64_t)i); j<end; ++j)
-         {
-            double * pvd = (double*)&vd[j];
-            _mm_store_pd(pvd, _mm_mul_pd(_mm_load_pd(pvd), vl));
-         }
+         double * pvd = (double*)&vd[j];
+         _mm256_storeu_pd(pvd, _mm256_mul_pd(_mm256_loadu_pd(pvd), vl));
       }
-#else
+
+      return 0;
+   }
+
+   QX_TARGET_AVX512 int renorm_worker_avx512(uint64_t cs, uint64_t ce, uint64_t s, double * length, cvector_t * p_data)
+   {
+      double l_rec = 1./(*length);
+      complex_t * vd = p_data->data();
+      __m512d vl = _mm512_set1_pd(l_rec);
+
 #ifdef USE_OPENMP
 #pragma omp parallel for
 #endif
-      for (int64_t i=cs; i<(int64_t)ce; i+=tile_size)
+      for (int64_t j=cs; j<(int64_t)ce; j+=4)
       {
-         for (uint64_t j=(uint64_t)i, end=std::min(ce,tile_size+(uint64_t)i); j<end; ++j)
-         {
-            data[j] *= l_rec;
-         }
+         double * pvd = (double*)&vd[j];
+         _mm512_storeu_pd(pvd, _mm512_mul_pd(_mm512_loadu_pd(pvd), vl));
       }
-#endif
-
-      // // Update the remaining elements if there are any
-      // uint64_t reminder = num_elts % tile_size;
-      // if (reminder) {
-      //    for (uint64_t i=ce-reminder; i<ce; ++i)
-      //    {
-      //       data[i] *= l_rec;
-      //    }
-      // }
 
       return 0;
    }
 
+   /**
+    * \brief scale the amplitudes in [cs,ce) by 1/length : the vector
+    *    versions need a range that is a multiple of their width
+    */
+   int renorm_worker(uint64_t cs, uint64_t ce, uint64_t s, double * length, cvector_t * p_data)
+   {
+      xpu::isa_t isa = xpu::get_isa();
+      uint64_t   n   = ce - cs;
+
+      if ((isa == xpu::__isa_avx512__) && !(n & 3))
+         return renorm_worker_avx512(cs, ce, s, length, p_data);
+      if ((isa >= xpu::__isa_avx2__) && !(n & 1))
+         return renorm_worker_avx2(cs, ce, s, length, p_data);
+      return renorm_worker_sse(cs, ce, s, length, p_data);
+   }
+
 
 
    
@@ -2960,6 +5181,39 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
          {
          }
 
+         /**
+          * \brief single precision measurement : draw the outcome of <qubit>
+          *    from <f>, project and renormalize the state in two passes
+          */
+         int64_t collapse_single(qu_register& qreg, double f)
+         {
+            complex_f_t * data = qreg.get_data_f().data();
+            uint64_t      t    = qubit;
+            int64_t       rs   = (int64_t)(1UL << (qreg.size()-1));
+            double        p    = 0;
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+: p)
+#endif
+            for (int64_t k=0; k<rs; ++k)
+               p += data[((k >> t) << (t+1)) | (k & ((1UL << t)-1)) | (1UL << t)].norm();
+
+            int64_t  value  = (f < p ? 1 : 0);
+            float    scale  = (float)(1./std::sqrt(value ? p : 1-p));
+            uint64_t keep   = (value ? (1UL << t) : 0);
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+            for (int64_t k=0; k<rs; ++k)
+            {
+               uint64_t i0 = ((k >> t) << (t+1)) | (k & ((1UL << t)-1));
+               complex_f_t& a = data[i0 | keep];
+               a.re *= scale;
+               a.im *= scale;
+               data[i0 | ((1UL << t) ^ keep)] = 0.0;
+            }
+            return value;
+         }
+
          int64_t apply(qu_register& qreg)
          {
             if (measure_all)
@@ -2981,7 +5235,9 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             // Basically, this "if" operator determines what to do if we have more than 64 qubits.
             // It also determines whether to invoke parallel or sequential computations. As of now,
             // we set parallel execution as the default one.
-            if (1)//size > 64)
+            if (qreg.single_precision())
+               value = collapse_single(qreg, f);
+            else if (1)//size > 64)
             // if (size > 64)
             {
                // #define PARALLEL_MEASUREMENT
@@ -3112,6 +5368,14 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return value;
          }
 
+         /**
+          * \brief measured qubit, when not measuring the whole register
+          */
+         uint64_t get_qubit()
+         {
+            return qubit;
+         }
+
          void dump()
          {
             if (measure_all)
@@ -3855,6 +6119,26 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
             return gates;
          }
 
+         /**
+          * \brief the gates, without copying them (for the hot paths)
+          */
+         const std::vector<gate *>& gate_list() const
+         {
+            return gates;
+         }
+
+         /**
+          * \brief the gates run in parallel : the duration of the
+          *    longest one, unless set explicitly
+          */
+         uint64_t get_duration()
+         {
+            uint64_t d = duration;
+            for (size_t i=0; (i<gates.size()) && !duration; ++i)
+               d = std::max(d, gates[i]->get_duration());
+            return d;
+         }
+
          std::vector<uint64_t>  qubits()
          {
             std::vector<uint64_t> r;
@@ -3930,7 +6214,6 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
          int64_t apply(qu_register& qreg)
          {
             qreg.reset();
-            cvector_t&  q = qreg.get_data();
             double      norm = 0;
 
             for (quantum_state_t::iterator i=state->begin(); i != state->end(); ++i)
@@ -3938,7 +6221,7 @@ pr[bc] = (pv[c1]*(m.get(bc,c1))) + (pv[c2]*(m.get(bc,c2)));
                basis_state_t bs = (*i).first;
                complex_t     c  = (*i).second;
                // println("bs=" << bs << ", a=" << c);
-               q[bs] = c;
+               qreg.set_amplitude(bs,c);
                norm += c.norm(); //std::norm(c);
             }
 
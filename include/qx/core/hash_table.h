@@ -352,6 +352,12 @@ namespace xpu {
                 return make_pair(iterator(newNode, this), true);
             }
 
+            // exchange the contents of two tables without copying their nodes
+            void swap(hash_table_t& ht) {
+                buckets.swap(ht.buckets);
+                std::swap(num_elements, ht.num_elements);
+            }
+
             void clear() {
                 for (size_t b = 0; b < buckets.size(); ++b) {
                     node_t* node = buckets[b];
@@ -51,6 +51,9 @@ namespace qx
 // 	 typedef ublas::identity_matrix<complex_t> cidentity_t;
 // #else
 	 typedef std::vector<complex_t,xpu::aligned_memory_allocator<complex_t,64> >  cvector_t;
+	 // single precision state vectors
+	 typedef xpu::complex_f complex_f_t;
+	 typedef std::vector<complex_f_t,xpu::aligned_memory_allocator<complex_f_t,64> >  cvector_f_t;
 	 // typedef xpu::vector<complex_t,16>  cvector_t;
 	 // typedef qx::linalg::matrix<complex_t>  cmatrix_t;
 	 typedef qx::linalg::tiny_matrix<complex_t,2>  cmatrix_t;
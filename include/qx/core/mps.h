@@ -0,0 +1,1064 @@
+/**
+ * @file    mps.h
+ * @brief   matrix product state simulation of circuits with a limited
+ *          entanglement : the qubits form a chain of tensors whose bond
+ *          dimensions are capped, so that shallow circuits on tens to
+ *          hundreds of qubits fit in memory
+ */
+
+#ifndef QX_MPS_H
+#define QX_MPS_H
+
+#include <vector>
+#include <string>
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "qx/core/circuit.h"
+
+namespace qx
+{
+   /**
+    * \brief default largest bond dimension of a matrix product state
+    */
+   #define __mps_default_max_bond__ 256
+
+   /**
+    * \brief default truncation threshold : largest weight (sum of the
+    *    squared singular values, relative to the norm) discarded when a
+    *    two-qubit gate splits its tensor
+    */
+   #define __mps_default_cutoff__ 1e-12
+
+   /**
+    * \brief smallest register simulated on a matrix product state when
+    *    the backend is picked automatically (a state vector of 31 qubits
+    *    takes 32 GiB)
+    */
+   #define __mps_auto_min_qubits__ 31
+
+   /**
+    * \brief largest register whose amplitudes are listed by get_state()
+    */
+   #define __mps_state_max_qubits__ 16
+
+   /**
+    * \brief sweeps of the jacobi svd before giving up on convergence
+    */
+   #define __mps_svd_max_sweeps__ 64
+
+   typedef std::vector<complex_t> tensor_t;
+
+   /**
+    * \brief matrix product state register : qubit q is the tensor A[q] of
+    *    shape (bonds[q], 2, bonds[q+1]), stored at (l*2+s)*bonds[q+1]+r,
+    *    and the amplitude of |s_0..s_n-1> is the product of the matrices
+    *    A[0](s_0)...A[n-1](s_n-1). the tensors left of the orthogonality
+    *    center are left-canonical and the ones right of it right-canonical,
+    *    so that the center holds the norm and the local probabilities.
+    *    a two-qubit gate contracts the two (adjacent) tensors, applies the
+    *    4x4 unitary and splits them back with an svd, dropping the smallest
+    *    singular values beyond the largest bond dimension or below the
+    *    cutoff; the product of the kept weights is the truncation fidelity.
+    *    gates on distant qubits are brought together by swaps. the
+    *    measurement register and averaging follow qu_register.
+    */
+   class mps_register
+   {
+      private:
+
+         size_t                                 n_qubits;
+         size_t                                 max_bond;
+         double                                 cutoff;
+         std::vector<tensor_t>                  tensors;
+         std::vector<size_t>                    bonds;
+         size_t                                 center;
+         size_t                                 peak_bond;
+         double                                 fidelity;
+         std::default_random_engine             rgenerator;
+         std::uniform_real_distribution<double> udistribution;
+
+         /**
+          * \brief one-sided (hestenes) jacobi svd of the m x n matrix <a>
+          *    (column-major, m >= n) : pairs of columns are rotated until
+          *    all of them are orthogonal, so that a becomes u.s, the
+          *    rotations being accumulated in the n x n matrix <v>
+          *    (column-major) with the original a = (u.s) v^+. each sweep
+          *    visits the pairs in a round-robin order whose rounds are made
+          *    of disjoint pairs, rotated in parallel.
+          */
+         static void jacobi_svd(tensor_t& a, size_t m, size_t n, tensor_t& v)
+         {
+            v.assign(n*n, complex_t(0,0));
+            for (size_t i=0; i<n; ++i)
+               v[i*n+i] = 1;
+            size_t              players = n + (n & 1);
+            std::vector<size_t> seats(players);
+            std::vector<double> norms(n);
+            for (size_t i=0; i<players; ++i)
+               seats[i] = i;
+            for (size_t sweep=0; sweep<__mps_svd_max_sweeps__; ++sweep)
+            {
+               double total = 0;
+               for (size_t i=0; i<n; ++i)
+               {
+                  double x = 0;
+                  for (size_t k=0; k<m; ++k)
+                     x += a[i*m+k].re*a[i*m+k].re + a[i*m+k].im*a[i*m+k].im;
+                  norms[i] = x;
+                  total   += x;
+               }
+               // overlaps below the rounding of the whole matrix do not
+               // change the result but would keep rotating noise
+               double floor = 1e-16*total;
+               int64_t rotations = 0;
+               for (size_t round=0; round+1<players; ++round)
+               {
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+:rotations) if (n >= 64)
+#endif
+                  for (int64_t p=0; p<(int64_t)(players/2); ++p)
+                  {
+                     size_t i = std::min(seats[p], seats[players-1-p]);
+                     size_t j = std::max(seats[p], seats[players-1-p]);
+                     if (j >= n)
+                        continue;
+                     complex_t * ci = &a[i*m];
+                     complex_t * cj = &a[j*m];
+                     double gr = 0, gi = 0;
+                     for (size_t k=0; k<m; ++k)
+                     {
+                        gr += ci[k].re*cj[k].re + ci[k].im*cj[k].im;
+                        gi += ci[k].re*cj[k].im - ci[k].im*cj[k].re;
+                     }
+                     // hypot : squaring tiny overlaps would underflow and
+                     // leave a non-unitary phase
+                     double g     = std::hypot(gr, gi);
+                     double alpha = norms[i], beta = norms[j];
+                     if ((g <= floor) || (g <= 1e-15*std::sqrt(alpha)*std::sqrt(beta)))
+                        continue;
+                     rotations++;
+                     // column j is rephased by conj(gamma)/|gamma| to get a
+                     // real overlap, then the pair is rotated as in the real case
+                     double zeta = (beta-alpha)/(2*g);
+                     double t    = (zeta >= 0 ? 1. : -1.)/(std::abs(zeta)+std::sqrt(1+zeta*zeta));
+                     double c    = 1/std::sqrt(1+t*t);
+                     double s    = c*t;
+                     double er   = gr/g, ei = -gi/g;
+                     rotate(ci, cj, m, c, s, er, ei);
+                     rotate(&v[i*n], &v[j*n], n, c, s, er, ei);
+                     norms[i] = alpha - t*g;
+                     norms[j] = beta + t*g;
+                  }
+                  std::rotate(seats.begin()+1, seats.end()-1, seats.end());
+               }
+               if (!rotations)
+                  break;
+            }
+         }
+
+         /**
+          * \brief x <- c.x - s.e.y, y <- s.x + c.e.y with e = er + i.ei
+          */
+         static void rotate(complex_t * x, complex_t * y, size_t m, double c, double s, double er, double ei)
+         {
+            for (size_t k=0; k<m; ++k)
+            {
+               double yr = y[k].re*er - y[k].im*ei;
+               double yi = y[k].re*ei + y[k].im*er;
+               double xr = x[k].re, xi = x[k].im;
+               x[k].re = c*xr - s*yr;
+               x[k].im = c*xi - s*yi;
+               y[k].re = s*xr + c*yr;
+               y[k].im = s*xi + c*yi;
+            }
+         }
+
+         /**
+          * \brief householder qr of the m x n matrix <a> (column-major,
+          *    m >= n) with column pivoting : a P = Q R. the reflectors are
+          *    left in <a> (below the diagonal, and their norms in <betas>)
+          *    and c = R P^T is returned conjugate-transposed in <ch>
+          *    (n x rank, column-major), the columns left being negligible.
+          * \return the numerical rank
+          */
+         static size_t pivoted_qr(tensor_t& a, size_t m, size_t n, std::vector<double>& betas, tensor_t& ch)
+         {
+            std::vector<size_t> perm(n);
+            std::vector<double> norms(n);
+            double total = 0;
+            for (size_t j=0; j<n; ++j)
+            {
+               perm[j] = j;
+               double x = 0;
+               for (size_t i=0; i<m; ++i)
+                  x += a[j*m+i].re*a[j*m+i].re + a[j*m+i].im*a[j*m+i].im;
+               norms[j] = x;
+               total   += x;
+            }
+            betas.clear();
+            size_t rank = 0;
+            for (size_t k=0; k<n; ++k, ++rank)
+            {
+               size_t p = k;
+               for (size_t j=k+1; j<n; ++j)
+                  if (norms[j] > norms[p])
+                     p = j;
+               if (norms[p] <= 1e-30*total)
+                  break;
+               if (p != k)
+               {
+                  std::swap_ranges(&a[k*m], &a[k*m]+m, &a[p*m]);
+                  std::swap(perm[k], perm[p]);
+                  std::swap(norms[k], norms[p]);
+               }
+               // reflector v = x - alpha.e1, alpha = -phase(x0).|x|
+               complex_t * x     = &a[k*m+k];
+               size_t      l     = m-k;
+               double      sigma = 0;
+               for (size_t i=0; i<l; ++i)
+                  sigma += x[i].re*x[i].re + x[i].im*x[i].im;
+               sigma = std::sqrt(sigma);
+               double    x0    = std::hypot(x[0].re, x[0].im);
+               complex_t phase = (x0 > 0 ? complex_t(x[0].re/x0, x[0].im/x0) : complex_t(1,0));
+               complex_t alpha(-phase.re*sigma, -phase.im*sigma);
+               x[0] -= alpha;
+               double beta = 2*sigma*sigma + 2*sigma*x0;
+               for (size_t j=k+1; j<n; ++j)
+               {
+                  complex_t * y = &a[j*m+k];
+                  double dr = 0, di = 0;
+                  for (size_t i=0; i<l; ++i)
+                  {
+                     dr += x[i].re*y[i].re + x[i].im*y[i].im;
+                     di += x[i].re*y[i].im - x[i].im*y[i].re;
+                  }
+                  dr *= 2/beta;  di *= 2/beta;
+                  for (size_t i=0; i<l; ++i)
+                  {
+                     y[i].re -= x[i].re*dr - x[i].im*di;
+                     y[i].im -= x[i].re*di + x[i].im*dr;
+                  }
+                  double rest = 0;
+                  for (size_t i=1; i<l; ++i)
+                     rest += y[i].re*y[i].re + y[i].im*y[i].im;
+                  norms[j] = rest;
+               }
+               betas.push_back(beta);
+               // r(k,k) = alpha is kept in the scratch of the norms
+               norms[k] = 0;
+               ch.resize(n*(rank+1));
+               ch[rank*n+perm[k]] = alpha.conj();
+            }
+            ch.resize(n*rank);
+            for (size_t k=0; k<rank; ++k)
+               for (size_t j=k+1; j<n; ++j)
+                  ch[k*n+perm[j]] = a[j*m+k].conj();
+            for (size_t k=0; k<rank; ++k)
+               for (size_t j=0; j<k; ++j)
+                  ch[k*n+perm[j]] = complex_t(0,0);
+            return rank;
+         }
+
+         /**
+          * \brief y <- Q y, Q being the product of the <rank> reflectors
+          *    left by pivoted_qr() in the m x n matrix <a>
+          */
+         static void apply_q(const tensor_t& a, size_t m, const std::vector<double>& betas, complex_t * y)
+         {
+            for (size_t k=betas.size(); k-- > 0; )
+            {
+               const complex_t * x = &a[k*m+k];
+               size_t l = m-k;
+               double dr = 0, di = 0;
+               for (size_t i=0; i<l; ++i)
+               {
+                  dr += x[i].re*y[k+i].re + x[i].im*y[k+i].im;
+                  di += x[i].re*y[k+i].im - x[i].im*y[k+i].re;
+               }
+               dr *= 2/betas[k];  di *= 2/betas[k];
+               for (size_t i=0; i<l; ++i)
+               {
+                  y[k+i].re -= x[i].re*dr - x[i].im*di;
+                  y[k+i].im -= x[i].re*di + x[i].im*dr;
+               }
+            }
+         }
+
+         /**
+          * \brief truncated svd of the m x n matrix <a> (column-major) :
+          *    a ~ u diag(s) vh with u m x k and vh k x n (column-major),
+          *    keeping the largest singular values up to <bond> of them,
+          *    while the discarded weight stays below <threshold>. the kept
+          *    singular values are rescaled to the norm of <a> and the
+          *    fidelity lowered by the discarded weight.
+          *    the jacobi svd runs on the (conjugate-transposed) triangular
+          *    factor of a pivoted qr, whose graded rows converge in a few
+          *    sweeps and whose size is the numerical rank.
+          * \return k
+          */
+         size_t split(tensor_t& a, size_t m, size_t n, tensor_t& u, std::vector<double>& s, tensor_t& vh, size_t bond, double threshold)
+         {
+            // a^+ = v s u^+ : the roles of u and v are swapped when m < n
+            bool transposed = (m < n);
+            if (transposed)
+            {
+               tensor_t b(n*m);
+               for (size_t j=0; j<n; ++j)
+                  for (size_t i=0; i<m; ++i)
+                     b[i*n+j] = a[j*m+i].conj();
+               a.swap(b);
+               std::swap(m,n);
+            }
+
+            // a = Q c, c^+ = u' s v'^+ : a = (Q v') s u'^+
+            std::vector<double> betas;
+            tensor_t            ch, w;
+            size_t              r = pivoted_qr(a, m, n, betas, ch);
+            if (r)
+               jacobi_svd(ch, n, r, w);
+
+            std::vector<double> sv(r);
+            std::vector<size_t> order(r);
+            double total = 0;
+            for (size_t i=0; i<r; ++i)
+            {
+               double x = 0;
+               for (size_t k=0; k<n; ++k)
+                  x += ch[i*n+k].re*ch[i*n+k].re + ch[i*n+k].im*ch[i*n+k].im;
+               sv[i]    = std::sqrt(x);
+               order[i] = i;
+               total   += x;
+            }
+            std::sort(order.begin(), order.end(), [&sv](size_t x, size_t y) { return sv[x] > sv[y]; });
+
+            // keep the largest singular values until the tail is negligible
+            size_t k    = r;
+            double tail = 0;
+            while ((k > 1) && ((k > bond) || (tail + sv[order[k-1]]*sv[order[k-1]] <= threshold*total)))
+            {
+               tail += sv[order[k-1]]*sv[order[k-1]];
+               k--;
+            }
+            if (total > 0)
+               fidelity *= (1-tail/total);
+            double scale = ((total > tail) ? std::sqrt(total/(total-tail)) : 1.);
+
+            // left vectors Q v' (m), right vectors u' (n)
+            size_t   rows = (transposed ? n : m);
+            size_t   cols = (transposed ? m : n);
+            tensor_t left(m);
+            k = std::max<size_t>(k,1);
+            u.assign(rows*k, complex_t(0,0));
+            vh.assign(k*cols, complex_t(0,0));
+            s.assign(k, 0.);
+            for (size_t x=0; (x<k) && (x<r); ++x)
+            {
+               size_t i  = order[x];
+               double si = sv[i];
+               s[x] = si*scale;
+               if (si == 0)
+                  continue;
+               std::fill(left.begin(), left.end(), complex_t(0,0));
+               std::copy(&w[i*r], &w[i*r]+r, left.begin());
+               apply_q(a, m, betas, left.data());
+               for (size_t j=0; j<n; ++j)
+               {
+                  complex_t y = ch[i*n+j];
+                  y /= si;
+                  if (transposed)
+                     u[x*rows+j] = y;
+                  else
+                     vh[j*k+x] = y.conj();
+               }
+               for (size_t j=0; j<m; ++j)
+               {
+                  if (transposed)
+                     vh[j*k+x] = left[j].conj();
+                  else
+                     u[x*rows+j] = left[j];
+               }
+            }
+            return k;
+         }
+
+         /**
+          * \brief move the orthogonality center one qubit to the right
+          */
+         void shift_right()
+         {
+            size_t   q = center;
+            size_t   l = bonds[q], r = bonds[q+1], r2 = bonds[q+2];
+            tensor_t a(2*l*r), u, vh;
+            std::vector<double> s;
+            for (size_t row=0; row<2*l; ++row)
+               for (size_t c=0; c<r; ++c)
+                  a[c*2*l+row] = tensors[q][row*r+c];
+            size_t k = split(a, 2*l, r, u, s, vh, r, 0);
+
+            tensor_t& aq = tensors[q];
+            aq.resize(2*l*k);
+            for (size_t row=0; row<2*l; ++row)
+               for (size_t x=0; x<k; ++x)
+                  aq[row*k+x] = u[x*2*l+row];
+
+            tensor_t next(k*2*r2, complex_t(0,0));
+            for (size_t x=0; x<k; ++x)
+               for (size_t c=0; c<r; ++c)
+               {
+                  complex_t f = vh[c*k+x]*complex_t(s[x],0);
+                  const complex_t * src = &tensors[q+1][c*2*r2];
+                  complex_t *       dst = &next[x*2*r2];
+                  for (size_t j=0; j<2*r2; ++j)
+                     dst[j] += f*src[j];
+               }
+            tensors[q+1].swap(next);
+            bonds[q+1] = k;
+            center     = q+1;
+         }
+
+         /**
+          * \brief move the orthogonality center one qubit to the left
+          */
+         void shift_left()
+         {
+            size_t   q = center;
+            size_t   l0 = bonds[q-1], l = bonds[q], r = bonds[q+1];
+            tensor_t a(l*2*r), u, vh;
+            std::vector<double> s;
+            for (size_t row=0; row<l; ++row)
+               for (size_t c=0; c<2*r; ++c)
+                  a[c*l+row] = tensors[q][row*2*r+c];
+            size_t k = split(a, l, 2*r, u, s, vh, l, 0);
+
+            tensor_t& aq = tensors[q];
+            aq.resize(k*2*r);
+            for (size_t x=0; x<k; ++x)
+               for (size_t c=0; c<2*r; ++c)
+                  aq[x*2*r+c] = vh[c*k+x];
+
+            tensor_t prev(l0*2*k, complex_t(0,0));
+            for (size_t row=0; row<l0*2; ++row)
+               for (size_t c=0; c<l; ++c)
+               {
+                  complex_t f = tensors[q-1][row*l+c];
+                  for (size_t x=0; x<k; ++x)
+                     prev[row*k+x] += f*u[x*l+c]*complex_t(s[x],0);
+               }
+            tensors[q-1].swap(prev);
+            bonds[q] = k;
+            center   = q-1;
+         }
+
+         /**
+          * \brief move the orthogonality center to <q>
+          */
+         void move_center(size_t q)
+         {
+            while (center < q)
+               shift_right();
+            while (center > q)
+               shift_left();
+         }
+
+         /**
+          * \brief apply the 4x4 unitary <g> (row-major, index bit 0 for
+          *    <q>, bit 1 for <q+1>) to the adjacent qubits <q> and <q+1>
+          */
+         void apply_adjacent(size_t q, const complex_t * g)
+         {
+            bool from_right = (center > q);
+            move_center(from_right ? q+1 : q);
+            size_t l = bonds[q], m = bonds[q+1], r = bonds[q+2];
+
+            // theta(l,s1,s2,r) = sum_m A[q](l,s1,m) A[q+1](m,s2,r)
+            tensor_t theta(l*4*r, complex_t(0,0));
+            for (size_t i=0; i<l; ++i)
+               for (size_t s1=0; s1<2; ++s1)
+                  for (size_t x=0; x<m; ++x)
+                  {
+                     complex_t         f   = tensors[q][(i*2+s1)*m+x];
+                     const complex_t * src = &tensors[q+1][x*2*r];
+                     complex_t *       dst = &theta[(i*2+s1)*2*r];
+                     for (size_t j=0; j<2*r; ++j)
+                        dst[j] += f*src[j];
+                  }
+
+            // gate, into the (l,s1) x (s2,r) column-major matrix to split
+            tensor_t a(l*2*2*r);
+            for (size_t i=0; i<l; ++i)
+               for (size_t j=0; j<r; ++j)
+               {
+                  complex_t t[4];
+                  for (size_t b=0; b<4; ++b)
+                     t[b] = theta[((i*2+(b & 1))*2+(b >> 1))*r+j];
+                  for (size_t b=0; b<4; ++b)
+                  {
+                     complex_t x = g[b*4]*t[0] + g[b*4+1]*t[1] + g[b*4+2]*t[2] + g[b*4+3]*t[3];
+                     a[((b >> 1)*r+j)*2*l + i*2+(b & 1)] = x;
+                  }
+               }
+
+            tensor_t u, vh;
+            std::vector<double> s;
+            size_t k = split(a, 2*l, 2*r, u, s, vh, max_bond, cutoff);
+
+            // the singular values go back to the side of the former center
+            tensor_t& aq = tensors[q];
+            tensor_t& an = tensors[q+1];
+            aq.resize(2*l*k);
+            an.resize(k*2*r);
+            for (size_t row=0; row<2*l; ++row)
+               for (size_t x=0; x<k; ++x)
+                  aq[row*k+x] = (from_right ? u[x*2*l+row]*complex_t(s[x],0) : u[x*2*l+row]);
+            for (size_t x=0; x<k; ++x)
+               for (size_t c=0; c<2*r; ++c)
+                  an[x*2*r+c] = (from_right ? vh[c*k+x] : vh[c*k+x]*complex_t(s[x],0));
+            bonds[q+1] = k;
+            center     = (from_right ? q : q+1);
+            peak_bond  = std::max(peak_bond, k);
+         }
+
+         /**
+          * \brief apply the 4x4 unitary <g> (index bit 0 for <a>, bit 1
+          *    for <b>, a < b) : <b> is swapped next to <a> and back
+          */
+         void apply_pair(size_t a, size_t b, const complex_t * g)
+         {
+            for (size_t k=b; k>a+1; --k)
+               apply_adjacent(k-1, swap_c);
+            apply_adjacent(a, g);
+            for (size_t k=a+2; k<=b; ++k)
+               apply_adjacent(k-1, swap_c);
+         }
+
+         /**
+          * \brief 4x4 unitary of the 2x2 matrix <m> on <target> controlled
+          *    by <control>, index bit 0 for the lowest of the two qubits
+          */
+         static void controlled_unitary(uint64_t control, uint64_t target, cmatrix_t& m, complex_t * u)
+         {
+            uint64_t tbit = ((target > control) ? 2 : 1);
+            uint64_t cbit = 3-tbit;
+            for (size_t i=0; i<16; ++i)
+               u[i] = complex_t(0,0);
+            for (uint64_t c=0; c<4; ++c)
+            {
+               if (!(c & cbit))
+               {
+                  u[c*4+c] = 1;
+                  continue;
+               }
+               size_t tc = ((c & tbit) ? 1 : 0);
+               u[(c & ~tbit)*4+c] = m(0,tc);
+               u[(c | tbit)*4+c]  = m(1,tc);
+            }
+         }
+
+         /**
+          * \brief populations of |0> and |1> of <q>, with the orthogonality
+          *    center on <q>
+          */
+         void populations(size_t q, double& p0, double& p1)
+         {
+            move_center(q);
+            size_t l = bonds[q], r = bonds[q+1];
+            p0 = p1 = 0;
+            for (size_t i=0; i<l; ++i)
+               for (size_t s=0; s<2; ++s)
+                  for (size_t j=0; j<r; ++j)
+                  {
+                     const complex_t& x = tensors[q][(i*2+s)*r+j];
+                     (s ? p1 : p0) += x.re*x.re + x.im*x.im;
+                  }
+         }
+
+      public:
+
+         measurement_register_t    measurement_register;
+         measurement_prediction_t  measurement_prediction;
+         measurement_averaging_t   measurement_averaging;
+         bool                      measurement_averaging_enabled;
+
+         /**
+          * ctor : product state |0...0> of <n_qubits> qubits, bond
+          *    dimensions capped to <max_bond>, singular values dropped
+          *    while their weight stays below <cutoff>
+          */
+         mps_register(size_t n_qubits, size_t max_bond=__mps_default_max_bond__, double cutoff=__mps_default_cutoff__) : n_qubits(n_qubits),
+                                                                                                                         max_bond(std::max<size_t>(max_bond,1)),
+                                                                                                                         cutoff(cutoff),
+                                                                                                                         rgenerator(xpu::timer().current()*10e5),
+                                                                                                                         udistribution(.0,1),
+                                                                                                                         measurement_register(n_qubits),
+                                                                                                                         measurement_prediction(n_qubits),
+                                                                                                                         measurement_averaging(n_qubits),
+                                                                                                                         measurement_averaging_enabled(true)
+         {
+            reset();
+         }
+
+         /**
+          * \brief reset the state to |0...0>
+          */
+         void reset()
+         {
+            tensors.assign(n_qubits, tensor_t(2, complex_t(0,0)));
+            bonds.assign(n_qubits+1, 1);
+            for (size_t q=0; q<n_qubits; ++q)
+            {
+               tensors[q][0]             = 1;
+               measurement_register[q]   = false;
+               measurement_prediction[q] = __state_0__;
+            }
+            center    = 0;
+            peak_bond = 1;
+            fidelity  = 1;
+         }
+
+         size_t size()
+         {
+            return n_qubits;
+         }
+
+         double rand()
+         {
+            return udistribution(rgenerator);
+         }
+
+         void seed(uint64_t s)
+         {
+            rgenerator.seed(s);
+            udistribution.reset();
+         }
+
+         bool test(uint64_t q)
+         {
+            return measurement_register[q];
+         }
+
+         bool get_measurement(uint64_t q)
+         {
+            return measurement_register[q];
+         }
+
+         void flip_measurement(uint64_t q)
+         {
+            measurement_register[q] = !measurement_register[q];
+         }
+
+         /**
+          * \brief product of the weights kept by the truncations since
+          *    the last reset : 1 when the simulation is exact
+          */
+         double get_fidelity()
+         {
+            return fidelity;
+         }
+
+         /**
+          * \brief largest bond dimension reached since the last reset
+          */
+         size_t bond_dimension()
+         {
+            return peak_bond;
+         }
+
+         /**
+          * \brief apply the 2x2 matrix <m> (row-major) to <q>
+          */
+         void apply_matrix(size_t q, const complex_t * m)
+         {
+            tensor_t& a = tensors[q];
+            size_t    l = bonds[q], r = bonds[q+1];
+            for (size_t i=0; i<l; ++i)
+               for (size_t j=0; j<r; ++j)
+               {
+                  complex_t x0 = a[(i*2)*r+j];
+                  complex_t x1 = a[(i*2+1)*r+j];
+                  a[(i*2)*r+j]   = m[0]*x0 + m[1]*x1;
+                  a[(i*2+1)*r+j] = m[2]*x0 + m[3]*x1;
+               }
+            measurement_prediction[q] = __state_unknown__;
+         }
+
+         /**
+          * \brief swap qubits <a> and <b>
+          */
+         void swap(size_t a, size_t b)
+         {
+            if (a == b)
+               return;
+            apply_pair(std::min(a,b), std::max(a,b), swap_c);
+            std::swap(measurement_prediction[a], measurement_prediction[b]);
+         }
+
+         /**
+          * \brief apply the 2x2 matrix <m> to <target> when <control> is set
+          */
+         void controlled(size_t control, size_t target, cmatrix_t& m)
+         {
+            complex_t u[16];
+            controlled_unitary(control, target, m, u);
+            apply_pair(std::min(control,target), std::max(control,target), u);
+            measurement_prediction[target] = __state_unknown__;
+         }
+
+         /**
+          * \brief probability of measuring |1> on <q>
+          */
+         double probability(size_t q)
+         {
+            double p0, p1;
+            populations(q, p0, p1);
+            return ((p0+p1) > 0 ? p1/(p0+p1) : 0.);
+         }
+
+         /**
+          * \brief measure <q> in the computational basis
+          */
+         bool measure(size_t q, bool disable_averaging=false)
+         {
+            double p0, p1;
+            populations(q, p0, p1);
+            bool   value = (rand()*(p0+p1) < p1);
+            double f     = 1/std::sqrt(value ? p1 : p0);
+            size_t l = bonds[q], r = bonds[q+1];
+            for (size_t i=0; i<l; ++i)
+               for (size_t s=0; s<2; ++s)
+                  for (size_t j=0; j<r; ++j)
+                  {
+                     complex_t& x = tensors[q][(i*2+s)*r+j];
+                     if ((s == 1) == value)
+                        x *= complex_t(f,0);
+                     else
+                        x = complex_t(0,0);
+                  }
+
+            measurement_prediction[q] = (value ? __state_1__ : __state_0__);
+            measurement_register[q]   = value;
+            if (!disable_averaging && measurement_averaging_enabled)
+            {
+               if (value)
+                  measurement_averaging[q].exited_states++;
+               else
+                  measurement_averaging[q].ground_states++;
+            }
+            return value;
+         }
+
+         /**
+          * \brief prepare <q> in |0>
+          */
+         void prepz(size_t q)
+         {
+            if (measure(q,true))
+               apply_matrix(q, pauli_x_c);
+            measurement_register[q]   = false;
+            measurement_prediction[q] = __state_0__;
+         }
+
+         /**
+          * \brief amplitude of the basis state <i> (up to 64 qubits)
+          */
+         complex_t amplitude(uint64_t i)
+         {
+            tensor_t v(1, complex_t(1,0));
+            for (size_t q=0; q<n_qubits; ++q)
+            {
+               size_t   l = bonds[q], r = bonds[q+1];
+               size_t   s = ((i >> q) & 1);
+               tensor_t w(r, complex_t(0,0));
+               for (size_t x=0; x<l; ++x)
+                  for (size_t j=0; j<r; ++j)
+                     w[j] += v[x]*tensors[q][(x*2+s)*r+j];
+               v.swap(w);
+            }
+            return v[0];
+         }
+
+         /**
+          * \brief draw <shots> measurements of the entire register without
+          *    collapsing the state : with the orthogonality center on the
+          *    first qubit, each shot draws the qubits one after another
+          *    from their conditional probabilities, in O(n.bond^2). the
+          *    histogram is only filled for up to 64 qubits; the measurement
+          *    register keeps the last shot.
+          */
+         shot_histogram_t sample(size_t shots)
+         {
+            shot_histogram_t histogram;
+            move_center(0);
+            tensor_t v, w;
+            for (size_t shot=0; shot<shots; ++shot)
+            {
+               uint64_t bits = 0;
+               v.assign(1, complex_t(1,0));
+               for (size_t q=0; q<n_qubits; ++q)
+               {
+                  size_t l = bonds[q], r = bonds[q+1];
+                  w.assign(2*r, complex_t(0,0));
+                  for (size_t x=0; x<l; ++x)
+                     for (size_t c=0; c<2*r; ++c)
+                        w[c] += v[x]*tensors[q][x*2*r+c];
+                  double p0 = 0, p1 = 0;
+                  for (size_t j=0; j<r; ++j)
+                  {
+                     p0 += w[j].re*w[j].re + w[j].im*w[j].im;
+                     p1 += w[r+j].re*w[r+j].re + w[r+j].im*w[r+j].im;
+                  }
+                  bool   value = (rand()*(p0+p1) < p1);
+                  double f     = 1/std::sqrt(value ? p1 : p0);
+                  v.resize(r);
+                  for (size_t j=0; j<r; ++j)
+                  {
+                     v[j] = w[(value ? r : 0)+j];
+                     v[j] *= complex_t(f,0);
+                  }
+                  if (value && (q < 64))
+                     bits |= (1ULL << q);
+                  measurement_register[q] = value;
+                  if (measurement_averaging_enabled)
+                  {
+                     if (value)
+                        measurement_averaging[q].exited_states++;
+                     else
+                        measurement_averaging[q].ground_states++;
+                  }
+               }
+               if (n_qubits <= 64)
+                  histogram[bits]++;
+            }
+            return histogram;
+         }
+
+         /**
+          * \brief check whether <g> can be applied to a matrix product
+          *    state : single-qubit gates and gates with one control
+          */
+         static bool supports(gate * g)
+         {
+            cmatrix_t m;
+            switch (g->type())
+            {
+               case __identity_gate__      :
+               case __swap_gate__          :
+               case __measure_gate__       :
+               case __measure_reg_gate__   :
+               case __measure_x_gate__     :
+               case __measure_x_reg_gate__ :
+               case __measure_y_gate__     :
+               case __measure_y_reg_gate__ :
+               case __prepz_gate__         :
+               case __prepx_gate__         :
+               case __prepy_gate__         :
+               case __classical_not_gate__ :
+               case __display__            :
+               case __display_binary__     :
+                  return true;
+               case __bin_ctrl_gate__      :
+                  return supports(((bin_ctrl *)g)->get_gate());
+               case __parallel_gate__      :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        if (!supports(gates[i]))
+                           return false;
+                     return true;
+                  }
+               default :
+                  return (g->get_matrix(m) && (g->control_qubits().size() <= 1));
+            }
+         }
+
+         /**
+          * \brief check whether all the gates of <circuits> are supported
+          */
+         static bool supports(std::vector<circuit *>& circuits)
+         {
+            for (size_t c=0; c<circuits.size(); ++c)
+               for (size_t i=0; i<circuits[c]->size(); ++i)
+                  if (!supports(circuits[c]->get(i)))
+                     return false;
+            return true;
+         }
+
+         /**
+          * \brief apply <g> with the semantics of gate::apply()
+          */
+         int64_t apply(gate * g)
+         {
+            cmatrix_t m;
+            switch (g->type())
+            {
+               case __identity_gate__      : break;
+               case __swap_gate__          : swap(g->qubits()[0],g->qubits()[1]); break;
+               case __measure_gate__       : return measure(g->qubits()[0]);
+               case __measure_reg_gate__   :
+                  for (size_t q=0; q<n_qubits; ++q)
+                     measure(q);
+                  break;
+               case __measure_x_gate__     :
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  measure(g->qubits()[0]);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  break;
+               case __measure_x_reg_gate__ :
+                  for (size_t q=0; q<n_qubits; ++q)
+                  {
+                     apply_matrix(q, hadamard_c);
+                     measure(q);
+                     apply_matrix(q, hadamard_c);
+                  }
+                  break;
+               case __measure_y_gate__     :
+                  apply_matrix(g->qubits()[0], sdag_gate_c);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  measure(g->qubits()[0]);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  apply_matrix(g->qubits()[0], phase_c);
+                  break;
+               case __measure_y_reg_gate__ :
+                  for (size_t q=0; q<n_qubits; ++q)
+                  {
+                     apply_matrix(q, sdag_gate_c);
+                     apply_matrix(q, hadamard_c);
+                     measure(q);
+                     apply_matrix(q, hadamard_c);
+                     apply_matrix(q, phase_c);
+                  }
+                  break;
+               case __prepz_gate__         : prepz(g->qubits()[0]); break;
+               case __prepx_gate__         :
+                  prepz(g->qubits()[0]);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  break;
+               case __prepy_gate__         :
+                  prepz(g->qubits()[0]);
+                  apply_matrix(g->qubits()[0], hadamard_c);
+                  apply_matrix(g->qubits()[0], phase_c);
+                  break;
+               case __classical_not_gate__ : flip_measurement(((classical_not *)g)->get_bit()); break;
+               case __display__            : dump(); break;
+               case __display_binary__     : dump(true); break;
+               case __bin_ctrl_gate__      :
+                  {
+                     std::vector<size_t> bits = ((bin_ctrl *)g)->get_bits();
+                     for (size_t i=0; i<bits.size(); ++i)
+                        if (!test(bits[i]))
+                           return 0;
+                     return apply(((bin_ctrl *)g)->get_gate());
+                  }
+               case __parallel_gate__      :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        apply(gates[i]);
+                     break;
+                  }
+               default :
+                  {
+                     std::vector<uint64_t> controls = g->control_qubits();
+                     if (!g->get_matrix(m) || (controls.size() > 1))
+                     {
+                        println("[x] mps register : unsupported gate !");
+                        g->dump();
+                        return -1;
+                     }
+                     uint64_t target = g->target_qubits()[0];
+                     if (controls.empty())
+                        apply_matrix(target, m.m);
+                     else
+                        controlled(controls[0], target, m);
+                     break;
+                  }
+            }
+            return 0;
+         }
+
+         /**
+          * \brief execute <c> (honouring its iterations)
+          */
+         void execute(circuit * c)
+         {
+            for (size_t it=0; it<std::max<size_t>(c->get_iterations(),1); ++it)
+               for (size_t i=0; i<c->size(); ++i)
+                  apply(c->get(i));
+         }
+
+         /**
+          * \brief non-zero amplitudes of the state, one per line, for up
+          *    to __mps_state_max_qubits__ qubits, or the bond dimensions
+         */
+         std::string get_state()
+         {
+            std::stringstream ss;
+            if (n_qubits > __mps_state_max_qubits__)
+            {
+               ss << "mps of " << n_qubits << " qubits, bond dimensions :";
+               for (size_t q=1; q<n_qubits; ++q)
+                  ss << " " << bonds[q];
+               ss << ", truncation fidelity " << fidelity << "\n";
+               return ss.str();
+            }
+            for (uint64_t i=0; i<(1ULL << n_qubits); ++i)
+            {
+               complex_t a = amplitude(i);
+               if ((std::abs(a.re) > __amp_epsilon__) || (std::abs(a.im) > __amp_epsilon__))
+                  ss << "   " << std::showpos << std::setw(7) << a << " |" << qu_register::to_binary_string(i,n_qubits) << "> +\n";
+            }
+            return ss.str();
+         }
+
+         /**
+          * \brief dump the bond dimensions and the truncation fidelity
+          *    (unless <only_binary>), then the measurement averaging,
+          *    prediction and register as qu_register::dump(true) does
+          */
+         void dump(bool only_binary=false)
+         {
+            if (!only_binary)
+            {
+               println("--------------[matrix product state]------- ");
+               print("  [bond dimensions]");
+               for (size_t q=1; q<n_qubits; ++q)
+                  print(" " << bonds[q]);
+               println("");
+               println("  [truncation fidelity = " << fidelity << "]");
+            }
+            if (measurement_averaging_enabled)
+            {
+               println("------------------------------------------- ");
+               print("[>>] measurement averaging (ground state) :");
+               print(" ");
+               for (int i=measurement_averaging.size()-1; i>=0; --i)
+               {
+                  double gs = measurement_averaging[i].ground_states;
+                  double es = measurement_averaging[i].exited_states;
+                  double av = ((es+gs) != 0. ? (gs/(es+gs)) : 0.);
+                  print(" | " << std::setw(9) << av);
+               }
+               println(" |");
+            }
+            println("------------------------------------------- ");
+            print("[>>] measurement prediction               :");
+            print(" ");
+            for (int i=measurement_prediction.size()-1; i>=0; --i)
+               print(" | " <<  std::setw(9) << __format_bin(measurement_prediction[i]));
+            println(" |");
+            println("------------------------------------------- ");
+            print("[>>] measurement register                 :");
+            print(" ");
+            for (int i=measurement_register.size()-1; i>=0; --i)
+               print(" | " <<  std::setw(9) << (measurement_register[i] ? '1' : '0'));
+            println(" |");
+            println("------------------------------------------- ");
+         }
+   };
+}
+
+#endif // QX_MPS_H
@@ -0,0 +1,400 @@
+/**
+ * @file    pauli_frame.h
+ * @brief   pauli frame sampling of (noisy) clifford circuits : the shots
+ *          are deviations from a single reference simulation, tracked as
+ *          pauli frames propagated through the clifford gates, 64 shots
+ *          per machine word
+ */
+
+#ifndef QX_PAULI_FRAME_H
+#define QX_PAULI_FRAME_H
+
+#include <vector>
+#include <random>
+#include <cmath>
+
+#include "qx/core/stabilizer.h"
+#include "qx/core/depolarizing_channel.h"
+
+namespace qx
+{
+   /**
+    * \brief pauli frame sampler : the circuits are simulated once on a
+    *    stabilizer register to get reference measurement outcomes, then
+    *    batches of 64 shots propagate bit-packed x/z frames (the pauli
+    *    errors by which each shot differs from the reference) through the
+    *    gates. a measurement outcome is flipped by the x part of the frame
+    *    of its qubit. random z frames on fresh and measured qubits make
+    *    the outcomes of non-deterministic measurements random.
+    */
+   class pauli_frame_sampler
+   {
+      private:
+
+         typedef enum __frame_op_t
+         {
+            __frame_h__,
+            __frame_s__,
+            __frame_cnot__,
+            __frame_cz__,
+            __frame_swap__,
+            __frame_measure__,
+            __frame_prepz__,
+            __frame_ctrl_pauli__,
+            __frame_step__
+         } frame_op_t;
+
+         /**
+          * \brief operation on the frames : <ref> holds the reference outcome
+          *    of a measurement, or whether a binary-controlled pauli (<px>,<pz>)
+          *    was applied in the reference, <bits>/<ref_bits> being its
+          *    condition. steps mark the start of each gate of the circuits
+          *    (<g>), where the errors are sampled.
+          */
+         typedef struct __frame_instruction_t
+         {
+            frame_op_t          op;
+            size_t              a;
+            size_t              b;
+            bool                ref;
+            bool                px;
+            bool                pz;
+            std::vector<size_t> bits;
+            std::vector<bool>   ref_bits;
+            gate *              g;
+         } frame_instruction_t;
+
+         size_t                           n_qubits;
+         std::vector<frame_instruction_t> program;
+         std::vector<uint64_t>            x;
+         std::vector<uint64_t>            z;
+         std::vector<uint64_t>            flips;
+         std::mt19937_64                  rgenerator;
+
+         /**
+          * \brief pauli part of a gate, (x,z) bits, or false if the gate is
+          *    not a pauli
+          */
+         static bool pauli_bits(gate * g, bool& px, bool& pz)
+         {
+            switch (g->type())
+            {
+               case __pauli_x_gate__ : px = true;  pz = false; return true;
+               case __pauli_y_gate__ : px = true;  pz = true;  return true;
+               case __pauli_z_gate__ : px = false; pz = true;  return true;
+               default               : return false;
+            }
+         }
+
+         frame_instruction_t instruction(frame_op_t op, size_t a=0, size_t b=0)
+         {
+            frame_instruction_t i;
+            i.op        = op;
+            i.a         = a;
+            i.b         = b;
+            i.ref       = false;
+            i.px        = false;
+            i.pz        = false;
+            i.g         = NULL;
+            return i;
+         }
+
+         /**
+          * \brief apply <g> to the reference register and translate it into
+          *    frame operations
+          */
+         void compile(gate * g, stabilizer_register& reference)
+         {
+            switch (g->type())
+            {
+               case __hadamard_gate__ :
+                  program.push_back(instruction(__frame_h__,g->qubits()[0]));
+                  break;
+               case __phase_gate__ :
+               case __sdag_gate__  :
+                  program.push_back(instruction(__frame_s__,g->qubits()[0]));
+                  break;
+               case __cnot_gate__ :
+                  program.push_back(instruction(__frame_cnot__,g->control_qubits()[0],g->target_qubits()[0]));
+                  break;
+               case __cphase_gate__ :
+                  program.push_back(instruction(__frame_cz__,g->control_qubits()[0],g->target_qubits()[0]));
+                  break;
+               case __swap_gate__ :
+                  program.push_back(instruction(__frame_swap__,g->qubits()[0],g->qubits()[1]));
+                  break;
+               case __measure_gate__ :
+                  {
+                     frame_instruction_t i = instruction(__frame_measure__,g->qubits()[0]);
+                     reference.apply(g);
+                     i.ref = reference.get_measurement(i.a);
+                     program.push_back(i);
+                     return;
+                  }
+               case __measure_reg_gate__ :
+                  for (size_t q=0; q<n_qubits; ++q)
+                  {
+                     measure m(q);
+                     compile(&m,reference);
+                  }
+                  return;
+               case __prepz_gate__ :
+                  program.push_back(instruction(__frame_prepz__,g->qubits()[0]));
+                  break;
+               case __bin_ctrl_gate__ :
+                  {
+                     bin_ctrl *          bc = (bin_ctrl *)g;
+                     frame_instruction_t i  = instruction(__frame_ctrl_pauli__,bc->get_gate()->qubits()[0]);
+                     pauli_bits(bc->get_gate(),i.px,i.pz);
+                     i.bits = bc->get_bits();
+                     i.ref  = true;
+                     for (size_t k=0; k<i.bits.size(); ++k)
+                     {
+                        i.ref_bits.push_back(reference.test(i.bits[k]));
+                        i.ref = (i.ref && i.ref_bits.back());
+                     }
+                     program.push_back(i);
+                     break;
+                  }
+               case __parallel_gate__ :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t k=0; k<gates.size(); ++k)
+                        compile(gates[k],reference);
+                     return;
+                  }
+               default :
+                  // paulis, identity, classical not and displays leave the frames unchanged
+                  break;
+            }
+            reference.apply(g);
+         }
+
+         uint64_t random_word()
+         {
+            return rgenerator();
+         }
+
+         void pauli(size_t q, error_type_t e, uint64_t lanes)
+         {
+            if (e != __z_error__)
+               x[q] ^= lanes;
+            if (e != __x_error__)
+               z[q] ^= lanes;
+         }
+
+         /**
+          * \brief lanes of the batch in which the binary control of <i> differs
+          *    from the reference
+          */
+         uint64_t control_flips(frame_instruction_t& i)
+         {
+            uint64_t taken = ~0ULL;
+            for (size_t k=0; k<i.bits.size(); ++k)
+               taken &= (i.ref_bits[k] ? ~flips[i.bits[k]] : flips[i.bits[k]]);
+            return (i.ref ? ~taken : taken);
+         }
+
+      public:
+
+         /**
+          * \brief check whether the circuits can be sampled with pauli frames :
+          *    clifford gates, with binary control restricted to pauli gates
+          */
+         static bool supports(std::vector<circuit *>& circuits)
+         {
+            for (size_t c=0; c<circuits.size(); ++c)
+               for (size_t i=0; i<circuits[c]->size(); ++i)
+                  if (!supports(circuits[c]->get(i)))
+                     return false;
+            return true;
+         }
+
+         static bool supports(gate * g)
+         {
+            if (!stabilizer_register::supports(g))
+               return false;
+            if (g->type() == __bin_ctrl_gate__)
+            {
+               bool px, pz;
+               return pauli_bits(((bin_ctrl *)g)->get_gate(),px,pz);
+            }
+            if (g->type() == __parallel_gate__)
+            {
+               std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+               for (size_t k=0; k<gates.size(); ++k)
+                  if (!supports(gates[k]))
+                     return false;
+            }
+            return true;
+         }
+
+         /**
+          * ctor
+          */
+         pauli_frame_sampler(size_t n_qubits) : n_qubits(n_qubits), x(n_qubits), z(n_qubits), flips(n_qubits), rgenerator(xpu::timer().current()*10e5)
+         {
+         }
+
+         void seed(uint64_t s)
+         {
+            rgenerator.seed(s);
+         }
+
+         /**
+          * \brief sample <shots> runs of <circuits> followed by a measurement
+          *    of all the qubits, under the depolarizing channel <channel>
+          *    (noiseless if NULL). <reference> receives the measurement
+          *    averaging, and the measurement register of the last shot ; the
+          *    final measurements of each shot are counted in <histogram> if
+          *    given (up to 64 qubits).
+          */
+         void run(std::vector<circuit *>& circuits, stabilizer_register& reference, size_t shots, depolarizing_channel * channel=NULL, shot_histogram_t * histogram=NULL)
+         {
+            // reference simulation
+            program.clear();
+            reference.reset();
+            bool averaging = reference.measurement_averaging_enabled;
+            reference.measurement_averaging_enabled = false;
+            for (size_t c=0; c<circuits.size(); ++c)
+               for (size_t it=0; it<std::max<size_t>(circuits[c]->get_iterations(),1); ++it)
+                  for (size_t i=0; i<circuits[c]->size(); ++i)
+                  {
+                     frame_instruction_t s = instruction(__frame_step__,i);
+                     s.g = circuits[c]->get(i);
+                     program.push_back(s);
+                     compile(circuits[c]->get(i),reference);
+                  }
+            program.push_back(instruction(__frame_step__));
+            measure m;
+            compile(&m,reference);
+            reference.measurement_averaging_enabled = averaging;
+
+            // program index of the final measurements
+            size_t final_measurements = program.size()-n_qubits;
+
+            double p  = (channel ? channel->get_overall_error_probability() : 0);
+            double lp = std::log1p(-std::min(p,1.-1e-16));
+            std::uniform_real_distribution<double> uniform(0.,1.);
+            std::vector<uint64_t>                  errors_before;
+            std::vector<uint64_t>                  errors_after;
+            std::vector<uint64_t>                  outcomes(n_qubits);
+
+            for (size_t batch=0; batch<shots; batch+=64)
+            {
+               size_t   lanes = std::min<size_t>(64,shots-batch);
+               uint64_t valid = (lanes == 64 ? ~0ULL : ((1ULL << lanes)-1));
+               for (size_t q=0; q<n_qubits; ++q)
+               {
+                  x[q]     = 0;
+                  z[q]     = random_word();
+                  flips[q] = 0;
+               }
+
+               for (size_t k=0; k<program.size(); ++k)
+               {
+                  frame_instruction_t& i = program[k];
+                  switch (i.op)
+                  {
+                     case __frame_step__ :
+                        {
+                           // errors following the previous gate
+                           for (size_t e=0; e<errors_after.size(); ++e)
+                              pauli((errors_after[e] & 0xffffffff) >> 2, (error_type_t)(errors_after[e] & 3), 1ULL << (errors_after[e] >> 32));
+                           errors_after.clear();
+                           if (!i.g || (p <= 0))
+                              break;
+                           gate_type_t gt = i.g->type();
+                           if ((gt == __display__) || (gt == __display_binary__))
+                              break;
+                           // faulty lanes are drawn by geometric skips, the
+                           // errors themselves by the channel
+                           errors_before.clear();
+                           size_t lane = (size_t)(std::log(1.-uniform(rgenerator))/lp);
+                           while (lane < lanes)
+                           {
+                              bool   before;
+                              size_t n = channel->sample_errors(i.g,i.a,uniform(rgenerator)*p,before);
+                              for (size_t e=0; e<n; ++e)
+                              {
+                                 size_t       q;
+                                 error_type_t t = channel->get_sampled_error(e,q);
+                                 (before ? errors_before : errors_after).push_back(((uint64_t)lane << 32) | (q << 2) | t);
+                              }
+                              lane += 1 + (size_t)(std::log(1.-uniform(rgenerator))/lp);
+                           }
+                           for (size_t e=0; e<errors_before.size(); ++e)
+                              pauli((errors_before[e] & 0xffffffff) >> 2, (error_type_t)(errors_before[e] & 3), 1ULL << (errors_before[e] >> 32));
+                           break;
+                        }
+                     case __frame_h__ :
+                        std::swap(x[i.a],z[i.a]);
+                        break;
+                     case __frame_s__ :
+                        z[i.a] ^= x[i.a];
+                        break;
+                     case __frame_cnot__ :
+                        x[i.b] ^= x[i.a];
+                        z[i.a] ^= z[i.b];
+                        break;
+                     case __frame_cz__ :
+                        z[i.a] ^= x[i.b];
+                        z[i.b] ^= x[i.a];
+                        break;
+                     case __frame_swap__ :
+                        std::swap(x[i.a],x[i.b]);
+                        std::swap(z[i.a],z[i.b]);
+                        break;
+                     case __frame_measure__ :
+                        {
+                           uint64_t ones = (i.ref ? ~x[i.a] : x[i.a]) & valid;
+                           flips[i.a] = x[i.a];
+                           z[i.a]    ^= random_word();
+                           if (k >= final_measurements)
+                              outcomes[i.a] = ones;
+                           if (reference.measurement_averaging_enabled)
+                           {
+                              reference.measurement_averaging[i.a].exited_states += __qx_popcount(ones);
+                              reference.measurement_averaging[i.a].ground_states += lanes-__qx_popcount(ones);
+                           }
+                           break;
+                        }
+                     case __frame_prepz__ :
+                        x[i.a]     = 0;
+                        z[i.a]     = random_word();
+                        flips[i.a] = 0;
+                        break;
+                     case __frame_ctrl_pauli__ :
+                        {
+                           uint64_t diff = control_flips(i);
+                           if (i.px)
+                              x[i.a] ^= diff;
+                           if (i.pz)
+                              z[i.a] ^= diff;
+                           break;
+                        }
+                  }
+
+               }
+
+               if (histogram)
+               {
+                  for (size_t l=0; l<lanes; ++l)
+                  {
+                     uint64_t bits = 0;
+                     for (size_t q=0; (q<n_qubits) && (q<64); ++q)
+                        bits |= ((outcomes[q] >> l) & 1) << q;
+                     (*histogram)[bits]++;
+                  }
+               }
+
+               // measurement register of the last shot
+               size_t last = lanes-1;
+               for (size_t q=0; q<n_qubits; ++q)
+                  reference.set_measurement(q, (outcomes[q] >> last) & 1);
+            }
+         }
+   };
+}
+
+#endif // QX_PAULI_FRAME_H
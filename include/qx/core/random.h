@@ -38,6 +38,15 @@ namespace qx
 	    return distribution(generator);
 	 }
 
+	 /**
+	  * \brief restart the stream from <s>
+	  */
+	 void seed(uint64_t s)
+	 {
+	    generator.seed(s);
+	    distribution.reset();
+	 }
+
       private:
 
          double  min;
@@ -71,7 +80,14 @@ namespace qx
 	    return distribution(generator);
 	 }
 
-
+	 /**
+	  * \brief restart the stream from <s>
+	  */
+	 void seed(uint64_t s)
+	 {
+	    generator.seed(s);
+	    distribution.reset();
+	 }
 
       private:
 
@@ -38,11 +38,11 @@ uint64_t qx::qu_register::collapse(uint64_t entry)
 #ifdef USE_OPENMP
 #pragma omp parallel for
 #endif
-   for (int64_t i=0; i<(int64_t)data.size(); ++i)
+   for (int64_t i=0; i<(int64_t)states(); ++i)
    {
-      data[i] = 0.0;
+      set_amplitude(i, 0.0);
    }
-   data[entry] = 1;
+   set_amplitude(entry, 1.0);
    // set_binary(entry,n_qubits);
    set_measurement_prediction(entry,n_qubits);
    set_measurement(entry,n_qubits);
@@ -81,22 +81,24 @@ std::string  qx::qu_register::to_binary_string(uint64_t state, uint64_t nq)
  */
 // qx::qu_register::qu_register(uint64_t n_qubits) : data(1 << n_qubits), binary(n_qubits), n_qubits(n_qubits), rgenerator(xpu::timer().current()*10e5), udistribution(.0,1)
 //qx::qu_register::qu_register(uint64_t n_qubits) : data(1 << n_qubits), measurement_prediction(n_qubits), measurement_register(n_qubits), n_qubits(n_qubits), rgenerator(xpu::timer().current()*10e5), udistribution(.0,1)
-qx::qu_register::qu_register(uint64_t n_qubits) : data(1ULL << n_qubits), aux(1ULL << n_qubits), measurement_prediction(n_qubits), measurement_register(n_qubits), n_qubits(n_qubits), rgenerator(xpu::timer().current()*10e5), udistribution(.0,1), measurement_averaging_enabled(true), measurement_averaging(n_qubits)
+qx::qu_register::qu_register(uint64_t n_qubits, precision_t precision) : data(precision == __double_precision__ ? (1ULL << n_qubits) : 0), data_f(precision == __single_precision__ ? (1ULL << n_qubits) : 0), precision(precision), measurement_prediction(n_qubits), measurement_register(n_qubits), n_qubits(n_qubits), rgenerator(xpu::timer().current()*10e5), udistribution(.0,1), measurement_averaging_enabled(true), measurement_averaging(n_qubits)
 {
    if(n_qubits>63) {
 	   throw std::invalid_argument("hard limit of 63 qubits exceeded");
    }
 
+   // pick the vector kernels once for the whole process
+   xpu::select_isa();
+
    uint64_t num_elts = (1ULL << n_qubits);
 
 #ifdef USE_OPENMP
 #pragma omp parallel for
 #endif
    for (int64_t i=0; i<(int64_t)num_elts; ++i) {
-      data[i] = 0.0;
-      aux[i] = 0.0;
+      set_amplitude(i, 0.0);
    }
-   data[0] = complex_t(1,0);
+   set_amplitude(0, complex_t(1,0));
 
    for (uint64_t i=0; i<n_qubits; i++)
    {
@@ -123,9 +125,9 @@ void qx::qu_register::reset()
 #pragma omp parallel for
 #endif
    for (int64_t i=0; i<(int64_t)num_elts; ++i) {
-      data[i] = 0.0;
+      set_amplitude(i, 0.0);
    }
-   data[0] = complex_t(1,0);
+   set_amplitude(0, complex_t(1,0));
    
    for (uint64_t i=0; i<n_qubits; i++)
    {
@@ -144,11 +146,61 @@ cvector_t& qx::qu_register::get_data()
    return data;
 }
 
+/**
+ * \brief single precision data getter
+ */
+cvector_f_t& qx::qu_register::get_data_f()
+{
+   return data_f;
+}
+
+/**
+ * \brief amplitude precision
+ */
+qx::precision_t qx::qu_register::get_precision()
+{
+   return precision;
+}
+
+/**
+ * \brief ith amplitude, whatever the precision
+ */
+complex_t qx::qu_register::amplitude(uint64_t i)
+{
+   if (precision == __single_precision__)
+      return data_f[i];
+   return data[i];
+}
+
+/**
+ * \brief set the ith amplitude, whatever the precision
+ */
+void qx::qu_register::set_amplitude(uint64_t i, complex_t a)
+{
+   if (precision == __single_precision__)
+      data_f[i] = a;
+   else
+      data[i] = a;
+}
+
+/**
+ * \brief scratch state vector, allocated on first use
+ */
 cvector_t& qx::qu_register::get_aux()
 {
+   if (aux.size() != states())
+      cvector_t(states()).swap(aux);
    return aux;
 }
 
+/**
+ * \brief free the scratch state vector
+ */
+void qx::qu_register::release_aux()
+{
+   cvector_t().swap(aux);
+}
+
 /**
  * \brief data setter
  */
@@ -209,8 +261,8 @@ bool qx::qu_register::check()
 #ifdef USE_OPENMP
 #pragma omp parallel for reduction(+:sum)
 #endif
-   for (int64_t i=0; i<(int64_t)data.size(); ++i)
-      sum += data[i].norm();
+   for (int64_t i=0; i<(int64_t)states(); ++i)
+      sum += amplitude(i).norm();
       // sum += std::norm(data[i]);
    println("[+] register validity check : " << sum) ;
    return (std::fabs(sum-1) < QUBIT_ERROR_THRESHOLD);
@@ -231,10 +283,10 @@ int64_t qx::qu_register::measure()
    //double r = drand48();
    double r = this->rand();
    
-   for (int i=0; i<data.size(); ++i)
+   for (uint64_t i=0; i<states(); ++i)
    {
       // r -= std::norm(data[i]);
-      r -= data[i].norm();
+      r -= amplitude(i).norm();
       if (r <= 0)
       {
          collapse(i);
@@ -244,6 +296,77 @@ int64_t qx::qu_register::measure()
    return -1;
 }
 
+/**
+ * \brief draw <shots> measurements of the entire register : the uniform
+ *    draws are sorted so that the cumulative distribution is walked once
+ */
+qx::shot_histogram_t qx::qu_register::sample(size_t shots)
+{
+   shot_histogram_t histogram;
+   if (!shots)
+      return histogram;
+
+   double total = 0;
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+:total)
+#endif
+   for (int64_t i=0; i<(int64_t)states(); ++i)
+      total += amplitude(i).norm();
+
+   std::vector<double> draws(shots);
+   for (size_t s=0; s<shots; ++s)
+      draws[s] = this->rand()*total;
+   double collapse_draw = draws[0];
+   std::sort(draws.begin(),draws.end());
+
+   double   cumulative = 0;
+   size_t   s          = 0;
+   uint64_t last       = 0;
+   uint64_t outcome    = 0;
+   bool     collapsed  = false;
+   for (uint64_t i=0; (i<states()) && (s<shots); ++i)
+   {
+      double p = amplitude(i).norm();
+      if (p == 0)
+         continue;
+      cumulative += p;
+      last = i;
+      size_t n = 0;
+      while ((s < shots) && (draws[s] < cumulative))
+      {
+         ++s;
+         ++n;
+      }
+      if (n)
+         histogram[i] += n;
+      if (!collapsed && (collapse_draw < cumulative))
+      {
+         outcome   = i;
+         collapsed = true;
+      }
+   }
+   // draws lost to rounding go to the last reachable state
+   if (s < shots)
+      histogram[last] += (shots-s);
+   if (!collapsed)
+      outcome = last;
+
+   if (measurement_averaging_enabled)
+   {
+      for (shot_histogram_t::iterator it=histogram.begin(); it!=histogram.end(); ++it)
+         for (uint64_t q=0; q<n_qubits; ++q)
+         {
+            if ((it->first >> q) & 1)
+               measurement_averaging[q].exited_states += it->second;
+            else
+               measurement_averaging[q].ground_states += it->second;
+         }
+   }
+
+   collapse(outcome);
+   return histogram;
+}
+
 #define __amp_epsilon__ (0.000001f)
 
 /**
@@ -258,13 +381,14 @@ void qx::qu_register::dump(bool only_binary=false)
         // std::cout.precision(std::numeric_limits<double>::digits10);
         std::cout.precision(7); //std::numeric_limits<double>::digits10);
         std::cout << std::fixed;
-        for (std::size_t i=0; i<data.size(); ++i)
+        for (std::size_t i=0; i<states(); ++i)
         {
-            if ((std::abs(data[i].re) > __amp_epsilon__) ||
-                (std::abs(data[i].im) > __amp_epsilon__))
+            complex_t a = amplitude(i);
+            if ((std::abs(a.re) > __amp_epsilon__) ||
+                (std::abs(a.im) > __amp_epsilon__))
             {
-                print("  [p = " << std::showpos << data[i].norm() << "]");
-                print("  " << std::showpos << data[i] << " |");
+                print("  [p = " << std::showpos << a.norm() << "]");
+                print("  " << std::showpos << a << " |");
                 to_binary(i,n_qubits);
                 println("> +");
             }
@@ -310,11 +434,12 @@ std::string qx::qu_register::get_state(bool only_binary=false)
    if (!only_binary)
    {
       std::cout << std::fixed;
-      for (int i=0; i<data.size(); ++i)
+      for (uint64_t i=0; i<states(); ++i)
       {
-         if (data[i] != complex_t(0,0)) 
+         complex_t a = amplitude(i);
+         if (a != complex_t(0,0)) 
          {
-            ss << "   " << std::showpos << std::setw(7) << data[i] << " |"; ss << to_binary_string(i,n_qubits); ss << "> +";
+            ss << "   " << std::showpos << std::setw(7) << a << " |"; ss << to_binary_string(i,n_qubits); ss << "> +";
             ss << "\n";
          }
       }
@@ -431,7 +556,7 @@ double fidelity(qu_register& s1, qu_register& s2)
    double f = 0;  
    for (int i=0; i<s1.states(); ++i)
       // f += sqrt(std::norm(s1[i])*std::norm(s2[i]));
-      f += sqrt(s1[i].norm()*s2[i].norm());
+      f += sqrt(s1.amplitude(i).norm()*s2.amplitude(i).norm());
    
    return f;
 }
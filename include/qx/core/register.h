@@ -11,8 +11,11 @@
 
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <complex>
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <cfloat>
 #include <cassert>
 #include <ctime>
@@ -20,6 +23,7 @@
 #include <random>
 
 #include "qx/xpu/timer.h"
+#include "qx/xpu/isa.h"
 #include "qx/core/linalg.h"
 
 // #define SAFE_MODE 1  // state norm check
@@ -52,7 +56,17 @@ namespace qx
       size_t exited_states = 0;
    } integration_t;
 
+   /**
+    * amplitude precision of the state vector
+    */
+   typedef enum __precision_t
+   {
+      __double_precision__,
+      __single_precision__
+   } precision_t;
+
    typedef std::vector<state_t>        measurement_prediction_t;
+   typedef std::map<uint64_t,size_t>   shot_histogram_t;
    typedef std::vector<bool>           measurement_register_t;
    typedef std::vector<integration_t>  measurement_averaging_t;
 
@@ -63,8 +77,10 @@ namespace qx
    {
       private:
 
-         cvector_t  data;
-         cvector_t  aux;
+         cvector_t    data;
+         cvector_t    aux;
+         cvector_f_t  data_f;      // state vector in single precision mode
+         precision_t  precision;
          measurement_prediction_t  measurement_prediction; 
          measurement_register_t    measurement_register;
 
@@ -97,9 +113,11 @@ namespace qx
       public:
 
          /**
-          * \brief quantum register of n_qubit
+          * \brief quantum register of n_qubit : in single precision mode
+          *    the amplitudes are stored in get_data_f() and get_data() is
+          *    empty
           */
-         qu_register(uint64_t n_qubits);
+         qu_register(uint64_t n_qubits, precision_t precision=__double_precision__);
 
 
          /**
@@ -152,8 +170,45 @@ namespace qx
           */
          cvector_t& get_data();
 
+         /**
+          * \brief single precision data getter
+          */
+         cvector_f_t& get_data_f();
+
+         /**
+          * \brief amplitude precision
+          */
+         precision_t get_precision();
+
+         /**
+          * \return true if the amplitudes are stored in single precision
+          */
+         bool single_precision()
+         {
+            return (precision == __single_precision__);
+         }
+
+         /**
+          * \brief ith amplitude, whatever the precision
+          */
+         complex_t amplitude(uint64_t i);
+
+         /**
+          * \brief set the ith amplitude, whatever the precision
+          */
+         void set_amplitude(uint64_t i, complex_t a);
+
+         /**
+          * \brief scratch state vector for out-of-place kernels, allocated
+          *    on first use : release it with release_aux() when done
+          */
          cvector_t& get_aux();
 
+         /**
+          * \brief free the scratch state vector
+          */
+         void release_aux();
+
          /**
           * \brief data setter
           */
@@ -195,11 +250,51 @@ namespace qx
             return udistribution(rgenerator);
          }
 
+         /**
+          * \brief restart the random stream of the register from <s>
+          */
+         void seed(uint64_t s)
+         {
+            rgenerator.seed(s);
+            udistribution.reset();
+         }
+
+         /**
+          * \brief state of the random stream, in the text format of the
+          *    standard engines, to be resumed by set_random_state()
+          */
+         std::string get_random_state()
+         {
+            std::stringstream ss;
+            ss << rgenerator << " " << udistribution;
+            return ss.str();
+         }
+
+         /**
+          * \brief resume the random stream saved by get_random_state()
+          * \return false if <s> is not a saved random state
+          */
+         bool set_random_state(const std::string& s)
+         {
+            std::stringstream ss(s);
+            ss >> rgenerator >> udistribution;
+            return !ss.fail();
+         }
+
          /**
           * \brief measure the entire quantum register
           */
          int64_t measure();
 
+         /**
+          * \brief draw <shots> measurements of the entire register from the
+          *    current state, as if it had been prepared and measured <shots>
+          *    times. the register is collapsed to one of the outcomes and
+          *    the measurement averaging accounts for all of them.
+          * \return histogram of the measured basis states
+          */
+         shot_histogram_t sample(size_t shots);
+
          /**
           * \brief dump
           */
@@ -211,7 +306,7 @@ namespace qx
          std::string get_state(bool only_binary);
 
 
-         std::string  to_binary_string(uint64_t state, uint64_t nq);
+         static std::string  to_binary_string(uint64_t state, uint64_t nq);
 
          /**
           * \brief set the regiter to <state>
@@ -271,11 +366,12 @@ namespace qx
             std::stringstream ss;
             ss << std::fixed;
             ss << "START\n";
-            for (int i=0; i<data.size(); ++i)
+            for (uint64_t i=0; i<states(); ++i)
             {
-               if (data[i] != complex_t(0,0)) 
+               complex_t a = amplitude(i);
+               if (a != complex_t(0,0)) 
                {
-                  ss << "   " << std::fixed << data[i] << " |"; 
+                  ss << "   " << std::fixed << a << " |"; 
                   //to_binary(i,n_qubits); 
                   uint64_t k=0;
                   uint64_t nq = n_qubits;
@@ -294,11 +390,11 @@ namespace qx
          void normalize()
          {
             double length = 0;
-            for (size_t k = 0; k < data.size(); k++) 
-               length += data[k].norm(); // std::norm(data[k]);
+            for (size_t k = 0; k < states(); k++) 
+               length += amplitude(k).norm(); // std::norm(data[k]);
             length = std::sqrt(length);
-            for (size_t k = 0; k < data.size(); k++) 
-               data[k] /= length;
+            for (size_t k = 0; k < states(); k++) 
+               set_amplitude(k, amplitude(k)/length);
          }
 
          /**
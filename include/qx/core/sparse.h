@@ -0,0 +1,570 @@
+/**
+ * @file    sparse.h
+ * @brief   sparse state : the non-zero amplitudes of the register are
+ *          kept in a hash map indexed by their basis state, for the
+ *          arithmetic and oracle circuits (adders, modular arithmetic,
+ *          toffoli networks) whose states have a handful of them
+ */
+
+#ifndef QX_SPARSE_H
+#define QX_SPARSE_H
+
+#include <vector>
+#include <string>
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "qx/core/circuit.h"
+#include "qx/core/hash_map.h"
+
+namespace qx
+{
+   /**
+    * \brief the state switches to a dense state vector once more than
+    *    1/64 of the amplitudes are non-zero : a hashed amplitude takes
+    *    about four times the memory of a dense one, and updating it an
+    *    order of magnitude more time
+    */
+   #define __sparse_dense_ratio__ 64
+
+   /**
+    * \brief weight |a|^2 below which an amplitude is dropped from the
+    *    sparse state (residues of cancellations)
+    */
+   #define __sparse_tolerance__ 1e-30
+
+   /**
+    * \brief hash map of the amplitudes of a sparse state
+    */
+   typedef xpu::container::hash_map<uint64_t,complex_t> amplitude_map_t;
+
+   /**
+    * \brief sparse register : permutation gates (x, cnot, toffoli, swap,
+    *    qubit permutations) relabel the basis states of the amplitudes,
+    *    diagonal gates scale them and the other single-qubit (controlled)
+    *    gates mix the pairs of basis states they couple, so that the cost
+    *    of a gate follows the support of the state rather than 2^n. when
+    *    the support grows past the threshold, or a gate without a sparse
+    *    implementation comes, the state moves once and for all to a
+    *    dense qu_register which runs the rest of the circuit. the
+    *    measurement register and averaging follow qu_register.
+    */
+   class sparse_register
+   {
+      private:
+
+         size_t                                 n_qubits;
+         size_t                                 max_support;
+         amplitude_map_t                        amplitudes;
+         qu_register *                          dense;
+         size_t                                 peak;
+         std::default_random_engine             rgenerator;
+         std::uniform_real_distribution<double> udistribution;
+
+         /**
+          * \brief add <a> to the amplitude of <x> in <m>
+          */
+         static void accumulate(amplitude_map_t& m, uint64_t x, const complex_t& a)
+         {
+            (*m.insert(amplitude_map_t::value_type(x,complex_t(0,0))).first).second += a;
+         }
+
+         /**
+          * \brief population of |1> of qubit <q>, and total population
+          */
+         void populations(size_t q, double& p1, double& total)
+         {
+            p1    = 0;
+            total = 0;
+            for (amplitude_map_t::iterator it=amplitudes.begin(); it!=amplitudes.end(); ++it)
+            {
+               double w = (*it).second.norm();
+               total += w;
+               if (((*it).first >> q) & 1)
+                  p1 += w;
+            }
+         }
+
+         /**
+          * \brief move the state to a dense state vector, which carries the
+          *    measurements on
+          */
+         void densify()
+         {
+            dense = new qu_register(n_qubits);
+            dense->set_amplitude(0, complex_t(0,0));
+            for (amplitude_map_t::iterator it=amplitudes.begin(); it!=amplitudes.end(); ++it)
+               dense->set_amplitude((*it).first, (*it).second);
+            amplitude_map_t empty;
+            amplitudes.swap(empty);
+            for (size_t q=0; q<n_qubits; ++q)
+            {
+               dense->set_measurement(q, (bool)measurement_register[q]);
+               dense->set_measurement_prediction(q, measurement_prediction[q]);
+            }
+            dense->measurement_averaging         = measurement_averaging;
+            dense->measurement_averaging_enabled = measurement_averaging_enabled;
+            dense->seed(rgenerator());
+         }
+
+         /**
+          * \brief switch to the dense state vector when the support is too
+          *    large
+          */
+         void account()
+         {
+            peak = std::max(peak, amplitudes.size());
+            if (amplitudes.size() > max_support)
+               densify();
+         }
+
+      public:
+
+         measurement_register_t    measurement_register;
+         measurement_prediction_t  measurement_prediction;
+         measurement_averaging_t   measurement_averaging;
+         bool                      measurement_averaging_enabled;
+
+         /**
+          * ctor : state |0...0> of <n_qubits> qubits, kept sparse while at
+          *    most <max_support> amplitudes are non-zero (default : 1 in
+          *    __sparse_dense_ratio__)
+          */
+         sparse_register(size_t n_qubits, size_t max_support=0) : n_qubits(n_qubits),
+                                                                  max_support(max_support ? max_support : (size_t)(((1ULL << std::min<size_t>(n_qubits,63)) - 1) / __sparse_dense_ratio__)),
+                                                                  dense(NULL),
+                                                                  rgenerator(xpu::timer().current()*10e5),
+                                                                  udistribution(.0,1),
+                                                                  measurement_register(n_qubits),
+                                                                  measurement_prediction(n_qubits),
+                                                                  measurement_averaging(n_qubits),
+                                                                  measurement_averaging_enabled(true)
+         {
+            if (n_qubits > 63)
+               throw std::invalid_argument("hard limit of 63 qubits exceeded");
+            reset();
+         }
+
+         ~sparse_register()
+         {
+            delete dense;
+         }
+
+         /**
+          * \brief reset the state to |0...0>, sparse again
+          */
+         void reset()
+         {
+            if (dense)
+            {
+               measurement_averaging = dense->measurement_averaging;
+               delete dense;
+               dense = NULL;
+            }
+            amplitudes.clear();
+            amplitudes.insert(amplitude_map_t::value_type(0,complex_t(1,0)));
+            for (size_t q=0; q<n_qubits; ++q)
+            {
+               measurement_register[q]   = false;
+               measurement_prediction[q] = __state_0__;
+            }
+            peak = 0;
+            account();
+         }
+
+         size_t size()
+         {
+            return n_qubits;
+         }
+
+         double rand()
+         {
+            return udistribution(rgenerator);
+         }
+
+         void seed(uint64_t s)
+         {
+            rgenerator.seed(s);
+            udistribution.reset();
+            if (dense)
+               dense->seed(s);
+         }
+
+         bool test(uint64_t q)
+         {
+            return (dense ? dense->test(q) : measurement_register[q]);
+         }
+
+         bool get_measurement(uint64_t q)
+         {
+            return (dense ? dense->get_measurement(q) : measurement_register[q]);
+         }
+
+         void flip_measurement(uint64_t q)
+         {
+            if (dense)
+               dense->flip_measurement(q);
+            else
+               measurement_register[q] = !measurement_register[q];
+         }
+
+         /**
+          * \brief check whether the state moved to a dense state vector
+          */
+         bool is_dense()
+         {
+            return (dense != NULL);
+         }
+
+         /**
+          * \brief number of non-zero amplitudes (2^n once dense)
+          */
+         size_t support()
+         {
+            return (dense ? dense->states() : amplitudes.size());
+         }
+
+         /**
+          * \brief largest support of the sparse state since the last reset
+          */
+         size_t peak_support()
+         {
+            return peak;
+         }
+
+         /**
+          * \brief apply the relocatable gate <g> (see is_relocatable()) to
+          *    the sparse state
+          */
+         void apply_unitary(gate * g)
+         {
+            std::vector<uint64_t>  qubits = g->qubits();
+            std::vector<uint64_t>  dest;
+            std::vector<complex_t> d;
+            cmatrix_t              m;
+            if ((g->target_qubits().size() == 1) && g->get_matrix(m))
+            {
+               std::vector<uint64_t> ctrl  = g->control_qubits();
+               uint64_t              t     = g->target_qubits()[0];
+               uint64_t              cmask = 0;
+               for (size_t c=0; c<ctrl.size(); ++c)
+                  cmask |= (1ULL << ctrl[c]);
+               if (g->is_diagonal())
+               {
+                  for (amplitude_map_t::iterator it=amplitudes.begin(); it!=amplitudes.end(); ++it)
+                     if (((*it).first & cmask) == cmask)
+                        (*it).second *= m.m[((*it).first >> t) & 1 ? 3 : 0];
+               }
+               else
+               {
+                  // each amplitude goes to the one or two basis states its
+                  // column of the matrix reaches : the anti-diagonal gates
+                  // (x, cnot, toffoli...) only relabel them
+                  amplitude_map_t next(2*amplitudes.size());
+                  bool            cancel = false;
+                  for (amplitude_map_t::iterator it=amplitudes.begin(); it!=amplitudes.end(); ++it)
+                  {
+                     uint64_t x = (*it).first;
+                     if ((x & cmask) != cmask)
+                     {
+                        accumulate(next, x, (*it).second);
+                        continue;
+                     }
+                     uint64_t b = (x >> t) & 1;
+                     uint64_t x0 = x & ~(1ULL << t);
+                     uint64_t x1 = x | (1ULL << t);
+                     bool     r0 = (m.m[b] != complex_t(0,0));
+                     bool     r1 = (m.m[2+b] != complex_t(0,0));
+                     if (r0)
+                        accumulate(next, x0, m.m[b]*(*it).second);
+                     if (r1)
+                        accumulate(next, x1, m.m[2+b]*(*it).second);
+                     cancel |= (r0 && r1);
+                  }
+                  // drop the amplitudes cancelled by the mixing gates
+                  if (cancel)
+                  {
+                     amplitudes.clear();
+                     for (amplitude_map_t::iterator it=next.begin(); it!=next.end(); ++it)
+                        if ((*it).second.norm() > __sparse_tolerance__)
+                           amplitudes.insert(*it);
+                  }
+                  else
+                     amplitudes.swap(next);
+                  measurement_prediction[t] = __state_unknown__;
+               }
+            }
+            else if (g->get_permutation(dest))
+            {
+               uint64_t mask = 0;
+               for (size_t k=0; k<qubits.size(); ++k)
+                  mask |= (1ULL << qubits[k]);
+               amplitude_map_t next(amplitudes.size());
+               for (amplitude_map_t::iterator it=amplitudes.begin(); it!=amplitudes.end(); ++it)
+               {
+                  uint64_t x = (*it).first;
+                  uint64_t y = x & ~mask;
+                  for (size_t k=0; k<qubits.size(); ++k)
+                     y |= ((x >> qubits[k]) & 1ULL) << dest[k];
+                  next.insert(amplitude_map_t::value_type(y,(*it).second));
+               }
+               amplitudes.swap(next);
+               measurement_prediction_t p = measurement_prediction;
+               for (size_t k=0; k<qubits.size(); ++k)
+                  measurement_prediction[dest[k]] = p[qubits[k]];
+            }
+            else if (g->get_diagonal(d))
+            {
+               for (amplitude_map_t::iterator it=amplitudes.begin(); it!=amplitudes.end(); ++it)
+               {
+                  uint64_t j = 0;
+                  for (size_t k=0; k<qubits.size(); ++k)
+                     j |= (((*it).first >> qubits[k]) & 1ULL) << k;
+                  (*it).second *= d[j];
+               }
+            }
+            account();
+         }
+
+         /**
+          * \brief probability of measuring |1> on <q>
+          */
+         double probability(size_t q)
+         {
+            double p1 = 0, total = 0;
+            if (dense)
+            {
+               for (uint64_t i=0; i<dense->states(); ++i)
+               {
+                  double w = dense->amplitude(i).norm();
+                  total += w;
+                  if ((i >> q) & 1)
+                     p1 += w;
+               }
+            }
+            else
+               populations(q, p1, total);
+            return (total > 0 ? p1/total : 0.);
+         }
+
+         /**
+          * \brief measure <q> in the computational basis
+          */
+         bool measure(size_t q, bool disable_averaging=false)
+         {
+            double p1, total;
+            populations(q, p1, total);
+            bool            value = (rand()*total < p1);
+            complex_t       f(1/std::sqrt(value ? p1 : total-p1),0);
+            amplitude_map_t next(amplitudes.size());
+            for (amplitude_map_t::iterator it=amplitudes.begin(); it!=amplitudes.end(); ++it)
+               if (((((*it).first >> q) & 1) != 0) == value)
+                  next.insert(amplitude_map_t::value_type((*it).first,(*it).second*f));
+            amplitudes.swap(next);
+
+            measurement_prediction[q] = (value ? __state_1__ : __state_0__);
+            measurement_register[q]   = value;
+            if (!disable_averaging && measurement_averaging_enabled)
+            {
+               if (value)
+                  measurement_averaging[q].exited_states++;
+               else
+                  measurement_averaging[q].ground_states++;
+            }
+            return value;
+         }
+
+         /**
+          * \brief prepare <q> in |0>
+          */
+         void prepz(size_t q)
+         {
+            if (measure(q,true))
+            {
+               pauli_x x(q);
+               apply_unitary(&x);
+            }
+            measurement_register[q]   = false;
+            measurement_prediction[q] = __state_0__;
+         }
+
+         /**
+          * \brief amplitude of the basis state <i>
+          */
+         complex_t amplitude(uint64_t i)
+         {
+            if (dense)
+               return dense->amplitude(i);
+            amplitude_map_t::iterator it = amplitudes.find(i);
+            return (it == amplitudes.end() ? complex_t(0,0) : (*it).second);
+         }
+
+         /**
+          * \brief apply <g> with the semantics of gate::apply() : the gates
+          *    without a sparse implementation move the state to a dense
+          *    state vector
+          */
+         int64_t apply(gate * g)
+         {
+            if (dense)
+               return g->apply(*dense);
+            switch (g->type())
+            {
+               case __identity_gate__      : break;
+               case __measure_gate__       : return measure(g->qubits()[0]);
+               case __measure_reg_gate__   :
+                  for (size_t q=0; q<n_qubits; ++q)
+                     measure(q);
+                  break;
+               case __measure_x_gate__     :
+               case __measure_x_reg_gate__ :
+               case __measure_y_gate__     :
+               case __measure_y_reg_gate__ :
+                  {
+                     bool                reg = ((g->type() == __measure_x_reg_gate__) || (g->type() == __measure_y_reg_gate__));
+                     bool                y   = ((g->type() == __measure_y_gate__) || (g->type() == __measure_y_reg_gate__));
+                     std::vector<size_t> qubits;
+                     for (size_t q=0; q<(reg ? n_qubits : 1); ++q)
+                        qubits.push_back(reg ? q : g->qubits()[0]);
+                     for (size_t i=0; i<qubits.size(); ++i)
+                     {
+                        // the rotation may move the state to the dense
+                        // vector : measure through apply()
+                        hadamard    h(qubits[i]);
+                        s_dag_gate  sd(qubits[i]);
+                        phase_shift s(qubits[i]);
+                        qx::measure mz(qubits[i]);
+                        if (y)
+                           apply(&sd);
+                        apply(&h);
+                        apply(&mz);
+                        apply(&h);
+                        if (y)
+                           apply(&s);
+                     }
+                     break;
+                  }
+               case __prepz_gate__         : prepz(g->qubits()[0]); break;
+               case __prepx_gate__         :
+               case __prepy_gate__         :
+                  {
+                     hadamard    h(g->qubits()[0]);
+                     phase_shift s(g->qubits()[0]);
+                     prepz(g->qubits()[0]);
+                     apply(&h);
+                     if (g->type() == __prepy_gate__)
+                        apply(&s);
+                     break;
+                  }
+               case __classical_not_gate__ : flip_measurement(((classical_not *)g)->get_bit()); break;
+               case __display__            : dump(); break;
+               case __display_binary__     : dump(true); break;
+               case __bin_ctrl_gate__      :
+                  {
+                     std::vector<size_t> bits = ((bin_ctrl *)g)->get_bits();
+                     for (size_t i=0; i<bits.size(); ++i)
+                        if (!test(bits[i]))
+                           return 0;
+                     return apply(((bin_ctrl *)g)->get_gate());
+                  }
+               case __parallel_gate__      :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        apply(gates[i]);
+                     break;
+                  }
+               default :
+                  if (!is_relocatable(g))
+                  {
+                     densify();
+                     return g->apply(*dense);
+                  }
+                  apply_unitary(g);
+                  break;
+            }
+            return 0;
+         }
+
+         /**
+          * \brief execute <c> (honouring its iterations)
+          */
+         void execute(circuit * c)
+         {
+            for (size_t it=0; it<std::max<size_t>(c->get_iterations(),1); ++it)
+               for (size_t i=0; i<c->size(); ++i)
+                  apply(c->get(i));
+         }
+
+         /**
+          * \brief non-zero amplitudes of the state, one per line, in the
+          *    format of qu_register::get_state()
+          */
+         std::string get_state()
+         {
+            if (dense)
+               return dense->get_state();
+            std::vector<uint64_t> states;
+            for (amplitude_map_t::iterator it=amplitudes.begin(); it!=amplitudes.end(); ++it)
+               states.push_back((*it).first);
+            std::sort(states.begin(), states.end());
+            std::stringstream ss;
+            for (size_t i=0; i<states.size(); ++i)
+               ss << "   " << std::showpos << std::setw(7) << amplitude(states[i]) << " |" << qu_register::to_binary_string(states[i],n_qubits) << "> +\n";
+            return ss.str();
+         }
+
+         /**
+          * \brief dump the support of the state (unless <only_binary>),
+          *    then the measurement averaging, prediction and register as
+          *    qu_register::dump(true) does
+          */
+         void dump(bool only_binary=false)
+         {
+            if (dense)
+            {
+               dense->dump(only_binary);
+               return;
+            }
+            if (!only_binary)
+            {
+               println("--------------[sparse state]--------------- ");
+               print(get_state());
+               println("  [support : " << amplitudes.size() << " amplitudes, dense above " << max_support << "]");
+            }
+            if (measurement_averaging_enabled)
+            {
+               println("------------------------------------------- ");
+               print("[>>] measurement averaging (ground state) :");
+               print(" ");
+               for (int i=measurement_averaging.size()-1; i>=0; --i)
+               {
+                  double gs = measurement_averaging[i].ground_states;
+                  double es = measurement_averaging[i].exited_states;
+                  double av = ((es+gs) != 0. ? (gs/(es+gs)) : 0.);
+                  print(" | " << std::setw(9) << av);
+               }
+               println(" |");
+            }
+            println("------------------------------------------- ");
+            print("[>>] measurement prediction               :");
+            print(" ");
+            for (int i=measurement_prediction.size()-1; i>=0; --i)
+               print(" | " <<  std::setw(9) << __format_bin(measurement_prediction[i]));
+            println(" |");
+            println("------------------------------------------- ");
+            print("[>>] measurement register                 :");
+            print(" ");
+            for (int i=measurement_register.size()-1; i>=0; --i)
+               print(" | " <<  std::setw(9) << (measurement_register[i] ? '1' : '0'));
+            println(" |");
+            println("------------------------------------------- ");
+         }
+   };
+}
+
+#endif // QX_SPARSE_H
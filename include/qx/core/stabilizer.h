@@ -0,0 +1,497 @@
+/**
+ * @file    stabilizer.h
+ * @brief   stabilizer (clifford tableau) simulation of clifford circuits,
+ *          following "Improved simulation of stabilizer circuits"
+ *          [Aaronson & Gottesman 2004]
+ */
+
+#ifndef QX_STABILIZER_H
+#define QX_STABILIZER_H
+
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#include "qx/core/circuit.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define __qx_popcount(x) ((int64_t)__popcnt64(x))
+#else
+#define __qx_popcount(x) ((int64_t)__builtin_popcountll(x))
+#endif
+
+namespace qx
+{
+   /**
+    * \brief stabilizer register : tableau of the n destabilizers (rows 0..n-1)
+    *    and n stabilizers (rows n..2n-1) of the state, plus a scratch row, with
+    *    the x and z bits of each row packed in 64-bit words. clifford gates
+    *    cost O(n) and measurements O(n^2) instead of O(2^n).
+    *    the measurement register and averaging follow qu_register.
+    */
+   class stabilizer_register
+   {
+      private:
+
+         size_t                                 n_qubits;
+         size_t                                 words;
+         std::vector<uint64_t>                  x;
+         std::vector<uint64_t>                  z;
+         std::vector<uint8_t>                   r;
+         std::default_random_engine             rgenerator;
+         std::uniform_real_distribution<double> udistribution;
+
+         uint64_t * x_row(size_t i) { return &x[i*words]; }
+         uint64_t * z_row(size_t i) { return &z[i*words]; }
+
+         bool x_bit(size_t i, size_t q) { return (x[i*words+(q >> 6)] >> (q & 63)) & 1; }
+         bool z_bit(size_t i, size_t q) { return (z[i*words+(q >> 6)] >> (q & 63)) & 1; }
+
+         /**
+          * \brief multiply row <h> by row <i>, tracking the phase
+          */
+         void rowsum(size_t h, size_t i)
+         {
+            uint64_t * xh = x_row(h);
+            uint64_t * zh = z_row(h);
+            uint64_t * xi = x_row(i);
+            uint64_t * zi = z_row(i);
+            int64_t    e  = 2*r[h] + 2*r[i];
+            for (size_t w=0; w<words; ++w)
+            {
+               uint64_t x1 = xi[w], z1 = zi[w], x2 = xh[w], z2 = zh[w];
+               // power of i picked by each qubit of the product
+               uint64_t pos = (x1 & z1 & z2 & ~x2) | (x1 & ~z1 & z2 & x2) | (~x1 & z1 & x2 & ~z2);
+               uint64_t neg = (x1 & z1 & x2 & ~z2) | (x1 & ~z1 & z2 & ~x2) | (~x1 & z1 & x2 & z2);
+               e += __qx_popcount(pos) - __qx_popcount(neg);
+               xh[w] ^= x1;
+               zh[w] ^= z1;
+            }
+            r[h] = (((e % 4) + 4) % 4 == 2);
+         }
+
+         void copy_row(size_t h, size_t i)
+         {
+            std::copy(x_row(i), x_row(i)+words, x_row(h));
+            std::copy(z_row(i), z_row(i)+words, z_row(h));
+            r[h] = r[i];
+         }
+
+         void clear_row(size_t h)
+         {
+            std::fill(x_row(h), x_row(h)+words, 0);
+            std::fill(z_row(h), z_row(h)+words, 0);
+            r[h] = 0;
+         }
+
+         /**
+          * \brief outcome of measuring <q> if it is deterministic,
+          *    computed in the scratch row
+          */
+         bool deterministic_outcome(size_t q)
+         {
+            size_t s = 2*n_qubits;
+            clear_row(s);
+            for (size_t i=0; i<n_qubits; ++i)
+               if (x_bit(i,q))
+                  rowsum(s,i+n_qubits);
+            return r[s];
+         }
+
+      public:
+
+         measurement_register_t    measurement_register;
+         measurement_prediction_t  measurement_prediction;
+         measurement_averaging_t   measurement_averaging;
+         bool                      measurement_averaging_enabled;
+
+         /**
+          * ctor
+          */
+         stabilizer_register(size_t n_qubits) : n_qubits(n_qubits),
+                                                words((n_qubits+63)/64),
+                                                x((2*n_qubits+1)*((n_qubits+63)/64)),
+                                                z((2*n_qubits+1)*((n_qubits+63)/64)),
+                                                r(2*n_qubits+1),
+                                                rgenerator(xpu::timer().current()*10e5),
+                                                udistribution(.0,1),
+                                                measurement_register(n_qubits),
+                                                measurement_prediction(n_qubits),
+                                                measurement_averaging(n_qubits),
+                                                measurement_averaging_enabled(true)
+         {
+            reset();
+         }
+
+         /**
+          * \brief reset the state to |0...0>
+          */
+         void reset()
+         {
+            std::fill(x.begin(), x.end(), 0);
+            std::fill(z.begin(), z.end(), 0);
+            std::fill(r.begin(), r.end(), 0);
+            for (size_t q=0; q<n_qubits; ++q)
+            {
+               x_row(q)[q >> 6]          |= (1ULL << (q & 63));
+               z_row(q+n_qubits)[q >> 6] |= (1ULL << (q & 63));
+               measurement_register[q]   = false;
+               measurement_prediction[q] = __state_0__;
+            }
+         }
+
+         size_t size()
+         {
+            return n_qubits;
+         }
+
+         double rand()
+         {
+            return udistribution(rgenerator);
+         }
+
+         void seed(uint64_t s)
+         {
+            rgenerator.seed(s);
+            udistribution.reset();
+         }
+
+         bool test(uint64_t q)
+         {
+            return measurement_register[q];
+         }
+
+         bool get_measurement(uint64_t q)
+         {
+            return measurement_register[q];
+         }
+
+         void set_measurement(uint64_t q, bool m)
+         {
+            measurement_register[q] = m;
+         }
+
+         void flip_measurement(uint64_t q)
+         {
+            measurement_register[q] = !measurement_register[q];
+         }
+
+         /**
+          * \brief measurement register as an integer (qubit 0 in the
+          *    lowest bit), for up to 64 qubits
+          */
+         uint64_t get_measurements()
+         {
+            uint64_t m = 0;
+            for (size_t q=0; (q<n_qubits) && (q<64); ++q)
+               if (measurement_register[q])
+                  m |= (1ULL << q);
+            return m;
+         }
+
+         /**
+          * clifford gates
+          */
+
+         void hadamard(size_t q)
+         {
+            size_t   w = q >> 6;
+            uint64_t b = (1ULL << (q & 63));
+            for (size_t i=0; i<2*n_qubits; ++i)
+            {
+               uint64_t& xi = x[i*words+w];
+               uint64_t& zi = z[i*words+w];
+               r[i] ^= ((xi & zi & b) != 0);
+               uint64_t t = (xi ^ zi) & b;
+               xi ^= t;
+               zi ^= t;
+            }
+            measurement_prediction[q] = __state_unknown__;
+         }
+
+         void phase(size_t q)
+         {
+            size_t   w = q >> 6;
+            uint64_t b = (1ULL << (q & 63));
+            for (size_t i=0; i<2*n_qubits; ++i)
+            {
+               uint64_t& xi = x[i*words+w];
+               uint64_t& zi = z[i*words+w];
+               r[i] ^= ((xi & zi & b) != 0);
+               zi ^= (xi & b);
+            }
+         }
+
+         void phase_dag(size_t q)
+         {
+            size_t   w = q >> 6;
+            uint64_t b = (1ULL << (q & 63));
+            for (size_t i=0; i<2*n_qubits; ++i)
+            {
+               uint64_t& xi = x[i*words+w];
+               uint64_t& zi = z[i*words+w];
+               r[i] ^= ((xi & ~zi & b) != 0);
+               zi ^= (xi & b);
+            }
+         }
+
+         /**
+          * \brief pauli gate on <q> (x : px, z : pz, y : both) : flips the
+          *    sign of the rows anticommuting with it
+          */
+         void pauli(size_t q, bool px, bool pz)
+         {
+            size_t   w = q >> 6;
+            uint64_t b = (1ULL << (q & 63));
+            for (size_t i=0; i<2*n_qubits; ++i)
+               r[i] ^= ((((pz ? x[i*words+w] : 0) ^ (px ? z[i*words+w] : 0)) & b) != 0);
+            if (px && (measurement_prediction[q] != __state_unknown__))
+               measurement_prediction[q] = (measurement_prediction[q] == __state_0__ ? __state_1__ : __state_0__);
+         }
+
+         void cnot(size_t c, size_t t)
+         {
+            size_t   wc = c >> 6, wt = t >> 6;
+            uint64_t sc = (c & 63), st = (t & 63);
+            for (size_t i=0; i<2*n_qubits; ++i)
+            {
+               uint64_t * xi = x_row(i);
+               uint64_t * zi = z_row(i);
+               uint64_t xc = (xi[wc] >> sc) & 1, zc = (zi[wc] >> sc) & 1;
+               uint64_t xt = (xi[wt] >> st) & 1, zt = (zi[wt] >> st) & 1;
+               r[i]   ^= (xc & zt & (xt ^ zc ^ 1));
+               xi[wt] ^= (xc << st);
+               zi[wc] ^= (zt << sc);
+            }
+            if (measurement_prediction[c] == __state_1__)
+               measurement_prediction[t] = (measurement_prediction[t] == __state_0__ ? __state_1__ : (measurement_prediction[t] == __state_1__ ? __state_0__ : __state_unknown__));
+            else if (measurement_prediction[c] == __state_unknown__)
+               measurement_prediction[t] = __state_unknown__;
+         }
+
+         void cz(size_t c, size_t t)
+         {
+            state_t p = measurement_prediction[t];
+            hadamard(t);
+            cnot(c,t);
+            hadamard(t);
+            measurement_prediction[t] = p;
+         }
+
+         void swap(size_t a, size_t b)
+         {
+            for (size_t i=0; i<2*n_qubits; ++i)
+            {
+               bool xa = x_bit(i,a), za = z_bit(i,a);
+               bool xb = x_bit(i,b), zb = z_bit(i,b);
+               if (xa != xb)
+               {
+                  x[i*words+(a >> 6)] ^= (1ULL << (a & 63));
+                  x[i*words+(b >> 6)] ^= (1ULL << (b & 63));
+               }
+               if (za != zb)
+               {
+                  z[i*words+(a >> 6)] ^= (1ULL << (a & 63));
+                  z[i*words+(b >> 6)] ^= (1ULL << (b & 63));
+               }
+            }
+            std::swap(measurement_prediction[a], measurement_prediction[b]);
+         }
+
+         /**
+          * \brief measure <q> in the computational basis
+          */
+         bool measure(size_t q, bool disable_averaging=false)
+         {
+            size_t n = n_qubits;
+            size_t p = n;
+            while ((p < 2*n) && !x_bit(p,q))
+               p++;
+
+            bool value;
+            if (p < 2*n)
+            {
+               // random outcome : <p> is the first stabilizer anticommuting with z_q
+               for (size_t i=0; i<2*n; ++i)
+                  if ((i != p) && x_bit(i,q))
+                     rowsum(i,p);
+               copy_row(p-n,p);
+               clear_row(p);
+               z_row(p)[q >> 6] |= (1ULL << (q & 63));
+               value = (rand() < 0.5);
+               r[p]  = value;
+            }
+            else
+               value = deterministic_outcome(q);
+
+            measurement_prediction[q] = (value ? __state_1__ : __state_0__);
+            measurement_register[q]   = value;
+            if (!disable_averaging && measurement_averaging_enabled)
+            {
+               if (value)
+                  measurement_averaging[q].exited_states++;
+               else
+                  measurement_averaging[q].ground_states++;
+            }
+            return value;
+         }
+
+         /**
+          * \brief prepare <q> in |0>
+          */
+         void prepz(size_t q)
+         {
+            if (measure(q,true))
+               pauli(q,true,false);
+            measurement_register[q]   = false;
+            measurement_prediction[q] = __state_0__;
+         }
+
+         /**
+          * \brief check whether <g> can be applied to a stabilizer register
+          */
+         static bool supports(gate * g)
+         {
+            switch (g->type())
+            {
+               case __identity_gate__     :
+               case __hadamard_gate__     :
+               case __pauli_x_gate__      :
+               case __pauli_y_gate__      :
+               case __pauli_z_gate__      :
+               case __phase_gate__        :
+               case __sdag_gate__         :
+               case __cnot_gate__         :
+               case __cphase_gate__       :
+               case __swap_gate__         :
+               case __measure_gate__      :
+               case __measure_reg_gate__  :
+               case __prepz_gate__        :
+               case __classical_not_gate__:
+               case __display_binary__    :
+                  return true;
+               case __bin_ctrl_gate__     :
+                  return supports(((bin_ctrl *)g)->get_gate());
+               case __parallel_gate__     :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        if (!supports(gates[i]))
+                           return false;
+                     return true;
+                  }
+               default :
+                  return false;
+            }
+         }
+
+         /**
+          * \brief apply <g> with the semantics of gate::apply()
+          */
+         int64_t apply(gate * g)
+         {
+            switch (g->type())
+            {
+               case __identity_gate__     : break;
+               case __hadamard_gate__     : hadamard(g->qubits()[0]); break;
+               case __pauli_x_gate__      : pauli(g->qubits()[0],true,false); break;
+               case __pauli_y_gate__      : pauli(g->qubits()[0],true,true); break;
+               case __pauli_z_gate__      : pauli(g->qubits()[0],false,true); break;
+               case __phase_gate__        : phase(g->qubits()[0]); break;
+               case __sdag_gate__         : phase_dag(g->qubits()[0]); break;
+               case __cnot_gate__         : cnot(g->control_qubits()[0],g->target_qubits()[0]); break;
+               case __cphase_gate__       : cz(g->control_qubits()[0],g->target_qubits()[0]); break;
+               case __swap_gate__         : swap(g->qubits()[0],g->qubits()[1]); break;
+               case __measure_gate__      : return measure(g->qubits()[0]);
+               case __measure_reg_gate__  :
+                  for (size_t q=0; q<n_qubits; ++q)
+                     measure(q);
+                  break;
+               case __prepz_gate__        : prepz(g->qubits()[0]); break;
+               case __classical_not_gate__: flip_measurement(((classical_not *)g)->get_bit()); break;
+               case __display_binary__    : dump(); break;
+               case __bin_ctrl_gate__     :
+                  {
+                     std::vector<size_t> bits = ((bin_ctrl *)g)->get_bits();
+                     for (size_t i=0; i<bits.size(); ++i)
+                        if (!test(bits[i]))
+                           return 0;
+                     return apply(((bin_ctrl *)g)->get_gate());
+                  }
+               case __parallel_gate__     :
+                  {
+                     std::vector<gate *> gates = ((parallel_gates *)g)->get_gates();
+                     for (size_t i=0; i<gates.size(); ++i)
+                        apply(gates[i]);
+                     break;
+                  }
+               default :
+                  println("[x] stabilizer register : unsupported gate !");
+                  g->dump();
+                  return -1;
+            }
+            return 0;
+         }
+
+         /**
+          * \brief execute <c> (honouring its iterations)
+          */
+         void execute(circuit * c)
+         {
+            for (size_t it=0; it<std::max<size_t>(c->get_iterations(),1); ++it)
+               for (size_t i=0; i<c->size(); ++i)
+                  apply(c->get(i));
+         }
+
+         /**
+          * \brief dump the measurement averaging, prediction and register,
+          *    as qu_register::dump(true) does
+          */
+         void dump()
+         {
+            if (measurement_averaging_enabled)
+            {
+               println("------------------------------------------- ");
+               print("[>>] measurement averaging (ground state) :");
+               print(" ");
+               for (int i=measurement_averaging.size()-1; i>=0; --i)
+               {
+                  double gs = measurement_averaging[i].ground_states;
+                  double es = measurement_averaging[i].exited_states;
+                  double av = ((es+gs) != 0. ? (gs/(es+gs)) : 0.);
+                  print(" | " << std::setw(9) << av);
+               }
+               println(" |");
+            }
+            println("------------------------------------------- ");
+            print("[>>] measurement prediction               :");
+            print(" ");
+            for (int i=measurement_prediction.size()-1; i>=0; --i)
+               print(" | " <<  std::setw(9) << __format_bin(measurement_prediction[i]));
+            println(" |");
+            println("------------------------------------------- ");
+            print("[>>] measurement register                 :");
+            print(" ");
+            for (int i=measurement_register.size()-1; i>=0; --i)
+               print(" | " <<  std::setw(9) << (measurement_register[i] ? '1' : '0'));
+            println(" |");
+            println("------------------------------------------- ");
+         }
+   };
+
+   /**
+    * \brief check whether all the gates of <circuits> are supported by
+    *    the stabilizer register
+    */
+   inline bool is_clifford(std::vector<circuit *>& circuits)
+   {
+      for (size_t c=0; c<circuits.size(); ++c)
+         for (size_t i=0; i<circuits[c]->size(); ++i)
+            if (!stabilizer_register::supports(circuits[c]->get(i)))
+               return false;
+      return true;
+   }
+}
+
+#endif // QX_STABILIZER_H
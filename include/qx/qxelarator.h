@@ -43,15 +43,196 @@ public:
         qx_sim->execute(navg);
     }
 
+    /**
+     * fuse gates into dense unitaries on up to k qubits (2..5)
+     */
+    void set_fusion(size_t k)
+    {
+        qx_sim->set_fusion(k);
+    }
+
+    /**
+     * move the qubits of upcoming gates to the low, cache-local qubits
+     * before execution (noiseless circuits on more than 14 qubits)
+     */
+    void set_remap(bool r)
+    {
+        qx_sim->set_remap(r);
+    }
+
+    /**
+     * amplitude precision of the state vector : "single" or "double"
+     * @return false if the precision is unknown
+     */
+    bool set_precision(std::string p)
+    {
+        if (p == "single")
+            qx_sim->set_precision(qx::__single_precision__);
+        else if (p == "double")
+            qx_sim->set_precision(qx::__double_precision__);
+        else
+            return false;
+        return true;
+    }
+
+    /**
+     * simulate up to <threads> noisy trajectories of execute(navg)
+     * concurrently (0 : all cores), within <memory_mib> MiB (0 : no limit)
+     */
+    void set_trajectories(size_t threads, size_t memory_mib=0)
+    {
+        qx_sim->set_trajectories(threads, memory_mib);
+    }
+
+    /**
+     * simulation backend : "auto", "state_vector", "stabilizer",
+     * "density_matrix", "mps", "compressed" or "sparse"
+     * @return false if the backend is unknown
+     */
+    bool set_backend(std::string b)
+    {
+        qx::backend_t backend;
+        if (!qx::backend_from_name(b.c_str(), backend))
+            return false;
+        qx_sim->set_backend(backend);
+        return true;
+    }
+
+    /**
+     * truncation of the "mps" backend : largest bond dimension <chi>, and
+     * largest weight <w> of the singular values dropped by each gate
+     */
+    void set_mps(size_t chi, double w=__mps_default_cutoff__)
+    {
+        qx_sim->set_mps(chi, w);
+    }
+
+    /**
+     * weight below which the "compressed" backend drops amplitudes
+     */
+    void set_compression_tolerance(double w)
+    {
+        qx_sim->set_compression_tolerance(w);
+    }
+
+    /**
+     * write a checkpoint of the state vector to <file> every <interval>
+     * gates of the next single noiseless executions ("" : none)
+     */
+    void set_checkpoint(std::string file, size_t interval=__checkpoint_default_interval__)
+    {
+        qx_sim->set_checkpoint(file, interval);
+    }
+
+    /**
+     * resume the next execution from the checkpoint <file>, written by
+     * set_checkpoint() for the same circuit and options
+     */
+    void restore(std::string file)
+    {
+        qx_sim->set_restore(file);
+    }
+
+    /**
+     * estimated fidelity of the last "mps" execution after the truncations
+     */
+    double get_truncation_fidelity()
+    {
+        return qx_sim->get_truncation_fidelity();
+    }
+
     bool get_measurement_outcome(size_t q)
     {
         return qx_sim->move(q);
     }
+    /**
+     * shots per measured bitstring of the last execute(navg), available
+     * when the circuit only has terminal measurements and no noise
+     */
+    std::map<std::string,size_t> get_histogram()
+    {
+        return qx_sim->get_histogram();
+    }
+
     std::string get_state()
     {
         return qx_sim->get_state();
     }
 
+    /**
+     * probability of measuring |1> on qubit <q> after the last execution
+     */
+    double get_probability(size_t q)
+    {
+        return qx_sim->get_probability(q);
+    }
+
+    /**
+     * force the instruction set of the state-vector kernels
+     * ("sse3", "avx2" or "avx512"), capped to what the cpu supports
+     */
+    void set_isa(std::string isa)
+    {
+        xpu::isa_t i;
+        if (!xpu::isa_from_name(isa.c_str(), i))
+        {
+            std::cerr << "unknown instruction set '" << isa << "'" << std::endl;
+            return;
+        }
+        xpu::set_isa(i);
+    }
+
+    std::string get_isa()
+    {
+        return xpu::isa_name(xpu::get_isa());
+    }
+
+    /**
+     * placement of the pages of the state vectors allocated from now on
+     * on the numa nodes ("first_touch", "interleave" or "none")
+     * @return false if the policy is unknown
+     */
+    bool set_numa(std::string policy)
+    {
+        xpu::numa_policy_t p;
+        if (!xpu::numa_policy_from_name(policy.c_str(), p))
+        {
+            std::cerr << "unknown numa placement '" << policy << "'" << std::endl;
+            return false;
+        }
+        xpu::set_numa_policy(p);
+        return true;
+    }
+
+    std::string get_numa()
+    {
+        return xpu::numa_policy_name(xpu::get_numa_policy());
+    }
+
+    /**
+     * keep the state vectors allocated from now on in files mapped from
+     * <dir> (out-of-core mode, with qubit remapping), or in memory if
+     * <dir> is empty
+     * @return false if files can not be mapped on this platform or can not
+     * be created in <dir>
+     */
+    bool set_out_of_core(std::string dir)
+    {
+        if (!xpu::set_state_directory(dir))
+            return false;
+        qx_sim->set_remap(!dir.empty());
+        return true;
+    }
+
+    /**
+     * back the state vectors allocated from now on with transparent
+     * huge pages (on by default)
+     */
+    void set_huge_pages(bool enabled)
+    {
+        xpu::set_huge_pages(enabled);
+    }
+
 };
 
 #endif
@@ -4,6 +4,14 @@
 #include <vector>
 #include <stdint.h>
 #include "qx/core/error_model.h"
+#include "qx/core/backend.h"
+#include "qx/core/stabilizer.h"
+#include "qx/core/pauli_frame.h"
+#include "qx/core/density_matrix.h"
+#include "qx/core/mps.h"
+#include "qx/core/compressed.h"
+#include "qx/core/sparse.h"
+#include "qx/core/checkpoint.h"
 
 namespace qx
 {
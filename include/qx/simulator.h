@@ -42,11 +42,29 @@ class simulator
 {
 protected:
     qx::qu_register * reg;
+    qx::stabilizer_register * sreg;
+    qx::density_matrix_register * dreg;
+    qx::mps_register * mreg;
+    qx::compressed_register * creg;
+    qx::sparse_register * spreg;
     compiler::QasmRepresentation ast;
+    size_t fusion_qubits;
+    bool remapping;
+    qx::precision_t precision;
+    qx::shot_histogram_t histogram;
+    size_t trajectory_threads;
+    size_t memory_budget;
+    qx::backend_t backend;
+    size_t max_bond;
+    double cutoff;
+    double tolerance;
+    std::string checkpoint_file;
+    size_t checkpoint_interval;
+    std::string restore_file;
 
 public:
-    simulator() : reg(nullptr) { /*xpu::init();*/ }
-    ~simulator() { /*xpu::clean();*/ }
+    simulator() : reg(nullptr), sreg(nullptr), dreg(nullptr), mreg(nullptr), creg(nullptr), spreg(nullptr), fusion_qubits(0), remapping(false), precision(qx::__double_precision__), trajectory_threads(1), memory_budget(0), backend(qx::__auto_backend__), max_bond(__mps_default_max_bond__), cutoff(__mps_default_cutoff__), tolerance(__compressed_default_tolerance__), checkpoint_interval(__checkpoint_default_interval__) { /*xpu::init();*/ }
+    ~simulator() { delete reg; delete sreg; delete dreg; delete mreg; delete creg; delete spreg; /*xpu::clean();*/ }
 
     void set(std::string file_path)
     {
@@ -71,6 +89,93 @@ public:
     }
 
 
+    /**
+     * fuse gates into dense unitaries on up to <k> qubits (2..5)
+     * before execution, 0 or 1 only merges single-qubit gates
+     */
+    void set_fusion(size_t k)
+    {
+        fusion_qubits = k;
+    }
+
+    /**
+     * remap the qubits of the noiseless circuits so that upcoming gates
+     * act on the low, cache-local qubits (see qx::circuit::remap())
+     */
+    void set_remap(bool r)
+    {
+        remapping = r;
+    }
+
+    /**
+     * amplitude precision of the registers created by execute()
+     */
+    void set_precision(qx::precision_t p)
+    {
+        precision = p;
+    }
+
+    /**
+     * simulate up to <threads> noisy trajectories concurrently (0 : one per
+     * openmp thread), with registers fitting in <memory_mib> MiB (0 : no limit)
+     */
+    void set_trajectories(size_t threads, size_t memory_mib)
+    {
+        trajectory_threads = threads;
+        memory_budget      = memory_mib << 20;
+    }
+
+    /**
+     * simulation backend : __auto_backend__ runs the shots of noiseless
+     * clifford programs on the stabilizer backend, single executions
+     * stay on the state vector so that get_state() is available. noisy
+     * shots run on a density matrix when it is cheaper than the
+     * trajectories, and noiseless circuits too large for a state vector
+     * on a matrix product state.
+     */
+    void set_backend(qx::backend_t b)
+    {
+        backend = b;
+    }
+
+    /**
+     * truncation of the matrix product states : bond dimensions capped
+     * to <chi>, singular values dropped while their weight stays below
+     * <w>
+     */
+    void set_mps(size_t chi, double w)
+    {
+        max_bond = chi;
+        cutoff   = w;
+    }
+
+    /**
+     * weight below which the compressed backend drops the amplitudes of
+     * its sparse chunks
+     */
+    void set_compression_tolerance(double w)
+    {
+        tolerance = w;
+    }
+
+    /**
+     * write a checkpoint of the state vector to <file> every <interval>
+     * gates of the single noiseless runs (none if <file> is empty)
+     */
+    void set_checkpoint(std::string file, size_t interval)
+    {
+        checkpoint_file     = file;
+        checkpoint_interval = interval;
+    }
+
+    /**
+     * resume the next execution from the checkpoint <file>
+     */
+    void set_restore(std::string file)
+    {
+        restore_file = file;
+    }
+
     /**
      * execute qasm file
      */
@@ -87,22 +192,19 @@ public:
         double                     error_probability = 0;
         qx::error_model_t          error_model       = qx::__unknown_error_model__;
 
-        // create the quantum state
-        println("Creating quantum register of " << qubits << " qubits... ");
-        try
-        {
-            reg = new qx::qu_register(qubits);
-        }
-        catch(std::bad_alloc& exception)
-        {
-            std::cerr << "Not enough memory, aborting" << std::endl;
-            // xpu::clean();
-        }
-        catch(std::exception& exception)
-        {
-            std::cerr << "Unexpected exception (" << exception.what() << "), aborting" << std::endl;
-            // xpu::clean();
-        }
+        histogram.clear();
+        delete reg;
+        delete sreg;
+        delete dreg;
+        delete mreg;
+        delete creg;
+        delete spreg;
+        reg  = nullptr;
+        sreg = nullptr;
+        dreg = nullptr;
+        mreg = nullptr;
+        creg = nullptr;
+        spreg = nullptr;
 
         // convert libqasm ast to qx internal representation
         std::vector<compiler::SubCircuit> subcircuits = ast.getSubCircuits().getAllSubCircuits();
@@ -127,91 +229,465 @@ public:
             error_probability = ast.getErrorModelParameters().at(0);
             error_model       = qx::__depolarizing_channel__;
         }
+        else if (ast.getErrorModelType() == "amplitude_damping")
+        {
+            error_model       = qx::__amplitude_damping__;
+        }
+        else if (ast.getErrorModelType() == "phase_damping")
+        {
+            error_model       = qx::__phase_damping__;
+        }
 
-        // measurement averaging
-        if (navg)
+        // relaxation times of the damping models
+        double t1 = 0, t2 = 0;
+        bool   damping = ((error_model == qx::__amplitude_damping__) || (error_model == qx::__phase_damping__));
+        if (damping && !qx::damping_times(error_model, ast.getErrorModelParameters(), t1, t2))
         {
-            if (error_model == qx::__depolarizing_channel__)
+            error("invalid relaxation times (amplitude_damping, t1[, t2 <= 2*t1] or phase_damping, t2)");
+            return;
+        }
+
+        // checkpoints cover single noiseless runs of the state vector : the
+        // auto backend then stays on it
+        bool noisy    = (error_model == qx::__depolarizing_channel__);
+        bool checkpointed = (!checkpoint_file.empty() || !restore_file.empty());
+        if (checkpointed && (noisy || damping || navg || ((backend != qx::__auto_backend__) && (backend != qx::__state_vector_backend__))))
+        {
+            error("checkpoints are only taken for single noiseless runs of the state vector backend");
+            return;
+        }
+        qx::backend_t backend = (checkpointed ? qx::__state_vector_backend__ : this->backend);
+
+        // clifford programs can be simulated on a stabilizer tableau, and the
+        // shots of noisy ones drawn by pauli frame sampling
+        bool frames   = (navg && !perfect_circuits.empty() && qx::pauli_frame_sampler::supports(perfect_circuits));
+        bool clifford = (qx::is_clifford(perfect_circuits) && (!noisy || frames) && !damping);
+        if ((backend == qx::__stabilizer_backend__) && !clifford)
+        {
+            error("the stabilizer backend only simulates clifford circuits, noiseless or depolarized with pauli feedback");
+            return;
+        }
+        if (clifford && ((backend == qx::__stabilizer_backend__) || ((backend == qx::__auto_backend__) && navg)))
+        {
+            println("Clifford circuits : using the stabilizer backend");
+            sreg = new qx::stabilizer_register(qubits);
+            if (navg)
             {
-                qx::measure m;
-                for (size_t s=0; s<navg; ++s)
+                bool measured   = false;
+                bool sampleable = (qubits <= 64);
+                for (size_t i=0; (i<perfect_circuits.size()) && sampleable; i++)
+                    sampleable = perfect_circuits[i]->terminal_measurements_only(measured);
+
+                if (frames)
+                {
+                    qx::pauli_frame_sampler    sampler(qubits);
+                    qx::depolarizing_channel * channel = (noisy ? new qx::depolarizing_channel(perfect_circuits[0], qubits, error_probability) : NULL);
+                    sampler.run(perfect_circuits, *sreg, navg, channel, (sampleable ? &histogram : NULL));
+                    delete channel;
+                }
+                else
+                {
+                    qx::measure m;
+                    for (size_t s=0; s<navg; ++s)
+                    {
+                        sreg->reset();
+                        for (size_t i=0; i<perfect_circuits.size(); i++)
+                            sreg->execute(perfect_circuits[i]);
+                        sreg->apply(&m);
+                        if (sampleable)
+                            histogram[sreg->get_measurements()]++;
+                    }
+                }
+                println("Average measurement after " << navg << " shots:");
+                sreg->dump();
+            }
+            else
+            {
+                for (size_t i=0; i<perfect_circuits.size(); i++)
+                    sreg->execute(perfect_circuits[i]);
+            }
+            return;
+        }
+
+        // noiseless circuits too large for a state vector run on a
+        // matrix product state, whose size depends on the entanglement
+        bool chain = (!noisy && !damping && qx::mps_register::supports(perfect_circuits));
+        if ((backend == qx::__mps_backend__) && !chain)
+        {
+            error("the mps backend only simulates noiseless circuits of single-qubit and singly-controlled gates");
+            return;
+        }
+        if ((backend == qx::__mps_backend__) || ((backend == qx::__auto_backend__) && chain && (qubits >= __mps_auto_min_qubits__)))
+        {
+            println("Creating matrix product state of " << qubits << " qubits... ");
+            mreg = new qx::mps_register(qubits, max_bond, cutoff);
+            if (navg)
+            {
+                bool measured   = false;
+                bool sampleable = true;
+                for (size_t i=0; (i<perfect_circuits.size()) && sampleable; i++)
+                    sampleable = perfect_circuits[i]->terminal_measurements_only(measured);
+
+                if (sampleable)
                 {
-                    reg->reset();
                     for (size_t i=0; i<perfect_circuits.size(); i++)
                     {
-                        if (perfect_circuits[i]->size() == 0)
-                            continue;
-                        size_t iterations = perfect_circuits[i]->get_iterations();
-                        if (iterations > 1)
-                        {
-                            for (size_t it=0; it<iterations; ++it)
-                            {
-                                qx::noisy_dep_ch(perfect_circuits[i],error_probability,total_errors)->execute(*reg,false,true);
-                            }
-                        }
-                        else
-                            qx::noisy_dep_ch(perfect_circuits[i],error_probability,total_errors)->execute(*reg,false,true);
+                        perfect_circuits[i]->remove_measurements();
+                        mreg->execute(perfect_circuits[i]);
+                    }
+                    histogram = mreg->sample(navg);
+                }
+                else
+                {
+                    qx::measure m;
+                    for (size_t s=0; s<navg; ++s)
+                    {
+                        mreg->reset();
+                        for (size_t i=0; i<perfect_circuits.size(); i++)
+                            mreg->execute(perfect_circuits[i]);
+                        mreg->apply(&m);
                     }
-                    m.apply(*reg);
                 }
+                println("Average measurement after " << navg << " shots:");
+                mreg->dump(true);
             }
             else
+            {
+                for (size_t i=0; i<perfect_circuits.size(); i++)
+                    mreg->execute(perfect_circuits[i]);
+            }
+            return;
+        }
+
+        // noiseless circuits whose states have a small support run on a
+        // compressed state vector when asked to
+        if (backend == qx::__compressed_backend__)
+        {
+            if (noisy || damping || !qx::compressed_register::supports(perfect_circuits))
+            {
+                error("the compressed backend only simulates noiseless circuits of single-qubit, controlled, diagonal and swap gates");
+                return;
+            }
+            println("Creating compressed state vector of " << qubits << " qubits... ");
+            creg = new qx::compressed_register(qubits, tolerance);
+            if (navg)
             {
                 qx::measure m;
                 for (size_t s=0; s<navg; ++s)
                 {
-                    reg->reset();
+                    creg->reset();
                     for (size_t i=0; i<perfect_circuits.size(); i++)
-                        perfect_circuits[i]->execute(*reg,false,true);
-                    m.apply(*reg);
+                        creg->execute(perfect_circuits[i]);
+                    creg->apply(&m);
                 }
+                println("Average measurement after " << navg << " shots:");
+                creg->dump(true);
             }
+            else
+            {
+                for (size_t i=0; i<perfect_circuits.size(); i++)
+                    creg->execute(perfect_circuits[i]);
+            }
+            println("Compressed state : compression ratio " << creg->compression_ratio() << ", error bound " << creg->error_bound());
+            return;
+        }
 
-            println("Average measurement after " << navg << " shots:");
-            reg->dump(true);
+        // arithmetic and oracle circuits keep few non-zero amplitudes :
+        // they run on a sparse state when asked to, which moves to a state
+        // vector when they grow too many
+        if (backend == qx::__sparse_backend__)
+        {
+            if (noisy || damping)
+            {
+                error("the sparse backend only simulates noiseless circuits");
+                return;
+            }
+            println("Creating sparse state of " << qubits << " qubits... ");
+            spreg = new qx::sparse_register(qubits);
+            if (navg)
+            {
+                qx::measure m;
+                for (size_t s=0; s<navg; ++s)
+                {
+                    spreg->reset();
+                    for (size_t i=0; i<perfect_circuits.size(); i++)
+                        spreg->execute(perfect_circuits[i]);
+                    spreg->apply(&m);
+                }
+                println("Average measurement after " << navg << " shots:");
+                spreg->dump(true);
+            }
+            else
+            {
+                for (size_t i=0; i<perfect_circuits.size(); i++)
+                    spreg->execute(perfect_circuits[i]);
+            }
+            println("Sparse state : " << spreg->peak_support() << " amplitudes at the peak" << (spreg->is_dense() ? ", switched to a state vector" : ""));
+            return;
         }
-        else
+
+        // a density matrix replaces the damped trajectories when it is cheaper
+        // than the shots ; the depolarizing channel draws the errors of a step
+        // jointly, which the per-qubit kraus channels only approximate, so its
+        // trajectories are kept unless the density matrix is asked for
+        bool mixed = qx::density_matrix_register::supports(perfect_circuits);
+        if ((backend == qx::__density_matrix_backend__) && !mixed)
         {
-            if (error_model == qx::__depolarizing_channel__)
+            error("the density matrix backend does not simulate binary-controlled gates");
+            return;
+        }
+        if ((backend == qx::__density_matrix_backend__) || ((backend == qx::__auto_backend__) && mixed && damping && qx::density_matrix_preferred(qubits,navg)))
+        {
+            println("Creating density matrix of " << qubits << " qubits... ");
+            try
+            {
+                dreg = new qx::density_matrix_register(qubits);
+            }
+            catch(std::bad_alloc& exception)
+            {
+                std::cerr << "Not enough memory, aborting" << std::endl;
+                return;
+            }
+            if (damping)
+                dreg->set_damping(t1, t2);
+            else if (noisy)
+                dreg->set_noise(qx::depolarizing_kraus(error_probability), qx::bit_flip_kraus(error_probability));
+            for (size_t i=0; i<perfect_circuits.size(); i++)
+                dreg->execute(perfect_circuits[i]);
+            if (navg)
+            {
+                dreg->measure();
+                println("Exact measurement averaging (in place of " << navg << " shots):");
+                dreg->dump(true);
+            }
+            return;
+        }
+
+        // the gates of noisy runs are not grouped in cache blocks, so each
+        // gate and each error would read and write back the whole mapped file
+        if (!xpu::get_state_directory().empty() && (noisy || damping))
+        {
+            error("out-of-core state vectors only run noiseless circuits");
+            return;
+        }
+
+        // create the quantum state
+        println("Creating quantum register of " << qubits << " qubits... ");
+        try
+        {
+            reg = new qx::qu_register(qubits, precision);
+        }
+        catch(std::bad_alloc& exception)
+        {
+            if (!xpu::get_state_directory().empty())
+                std::cerr << "Could not map the state vector from " << xpu::get_state_directory() << ", aborting" << std::endl;
+            else
+                std::cerr << "Not enough memory, aborting" << std::endl;
+            // xpu::clean();
+            return;
+        }
+        catch(std::exception& exception)
+        {
+            std::cerr << "Unexpected exception (" << exception.what() << "), aborting" << std::endl;
+            // xpu::clean();
+            return;
+        }
+
+        // merge the gates of noiseless circuits, optionally remap their qubits,
+        // and group those on the low qubits to apply them block by block
+        if (!noisy && !damping)
+        {
+            size_t fused = 0;
+            for (size_t i=0; i<perfect_circuits.size(); i++)
+                fused += (fusion_qubits > 1 ? perfect_circuits[i]->fuse_dense(fusion_qubits) : perfect_circuits[i]->fuse());
+            if (fused)
+                println("Gate fusion removed " << fused << " gates.");
+            if (remapping)
             {
-                // println("[+] generating noisy circuits (p=" << qxr.getErrorProbability() << ")...");
+                size_t moves = 0;
                 for (size_t i=0; i<perfect_circuits.size(); i++)
+                    moves += perfect_circuits[i]->remap();
+                println("Qubit remapping : " << moves << " swaps.");
+            }
+            size_t tiled = 0;
+            for (size_t i=0; i<perfect_circuits.size(); i++)
+                tiled += perfect_circuits[i]->tile();
+            if (tiled)
+                println("Cache blocking : " << tiled << " groups of gates on qubits < " << __tile_qubits__ << ".");
+            size_t ungrouped = 0;
+            for (size_t i=0; i<perfect_circuits.size(); i++)
+                ungrouped += perfect_circuits[i]->ungrouped();
+            if (ungrouped && xpu::mapped_bytes())
+                println("Warning : out-of-core state vector : " << ungrouped << " gates (measurements, displays, binary-controlled gates or gates left on the high qubits by remapping) are not grouped in cache blocks and sweep the whole mapped file each.");
+        }
+
+        // measurement averaging
+        if (navg)
+        {
+            if (error_model == qx::__depolarizing_channel__)
+            {
+                size_t workers = qx::trajectory_workers(qubits, precision, trajectory_threads, memory_budget);
+                qx::run_dep_ch_trajectories(perfect_circuits, *reg, error_probability, navg, workers, total_errors);
+            }
+            else if (damping)
+            {
+                size_t workers = qx::trajectory_workers(qubits, precision, trajectory_threads, memory_budget);
+                qx::run_damping_trajectories(perfect_circuits, *reg, t1, t2, navg, workers, total_errors);
+            }
+            else
+            {
+                bool measured   = false;
+                bool sampleable = true;
+                for (size_t i=0; (i<perfect_circuits.size()) && sampleable; i++)
+                    sampleable = perfect_circuits[i]->terminal_measurements_only(measured);
+
+                if (sampleable)
                 {
-                    if (perfect_circuits[i]->size() == 0)
-                        continue;
-                    // println("[>] processing circuit '" << perfect_circuits[i]->id() << "'...");
-                    size_t iterations = perfect_circuits[i]->get_iterations();
-                    if (iterations > 1)
+                    // unitary circuits : simulate once and draw all the shots
+                    reg->reset();
+                    for (size_t i=0; i<perfect_circuits.size(); i++)
                     {
-                        for (size_t it=0; it<iterations; ++it)
-                            circuits.push_back(qx::noisy_dep_ch(perfect_circuits[i],error_probability,total_errors));
+                        perfect_circuits[i]->remove_measurements();
+                        perfect_circuits[i]->execute(*reg,false,true);
                     }
-                    else
+                    histogram = reg->sample(navg);
+                }
+                else
+                {
+                    qx::measure m;
+                    for (size_t s=0; s<navg; ++s)
                     {
-                        circuits.push_back(qx::noisy_dep_ch(perfect_circuits[i],error_probability,total_errors));
+                        reg->reset();
+                        for (size_t i=0; i<perfect_circuits.size(); i++)
+                            perfect_circuits[i]->execute(*reg,false,true);
+                        m.apply(*reg);
                     }
                 }
-                // println("[+] total errors injected in all circuits : " << total_errors);
+            }
+
+            println("Average measurement after " << navg << " shots:");
+            reg->dump(true);
+        }
+        else
+        {
+            if (error_model == qx::__depolarizing_channel__)
+            {
+                for (size_t i=0; i<perfect_circuits.size(); i++)
+                    qx::execute_dep_ch(perfect_circuits[i],*reg,error_probability,total_errors);
+            }
+            else if (damping)
+            {
+                for (size_t i=0; i<perfect_circuits.size(); i++)
+                    qx::execute_damping(perfect_circuits[i],*reg,t1,t2,total_errors);
             }
             else
                 circuits = perfect_circuits; // qxr.circuits();
 
-            for (size_t i=0; i<circuits.size(); i++)
+            if (checkpointed)
             {
-                circuits[i]->execute(*reg);
+                qx::checkpoint_position_t start = { 0, 0, 0 };
+                if (!restore_file.empty())
+                {
+                    bool restored = qx::load_checkpoint(restore_file, *reg, start, qx::checkpoint_fingerprint(circuits));
+                    restore_file.clear();
+                    if (!restored)
+                        return;
+                    println("Restored checkpoint : circuit " << start.circuit << ", iteration " << start.iteration << ", gate " << start.gate);
+                }
+                qx::execute_checkpointed(circuits, *reg, checkpoint_file, checkpoint_interval, start);
             }
+            else
+                for (size_t i=0; i<circuits.size(); i++)
+                {
+                    circuits[i]->execute(*reg);
+                }
         }
     }
 
+    /**
+     * measurement outcome of qubit <q> : the most likely one when the
+     * last execution ran on a density matrix
+     */
     bool move(size_t q)
     {
+        if (sreg)
+            return sreg->get_measurement(q);
+        if (dreg)
+            return (dreg->probability(q) > 0.5);
+        if (mreg)
+            return mreg->get_measurement(q);
+        if (creg)
+            return creg->get_measurement(q);
+        if (spreg)
+            return spreg->get_measurement(q);
         return reg->get_measurement(q);
     }
 
     std::string get_state()
     {
+        if (dreg)
+            return dreg->get_state();
+        if (mreg)
+            return mreg->get_state();
+        if (creg)
+            return creg->get_state();
+        if (spreg)
+            return spreg->get_state();
+        if (!reg)
+        {
+            error("no state vector : the last execution used the stabilizer backend");
+            return "";
+        }
         return reg->get_state();
     }
+
+    /**
+     * probability of measuring |1> on qubit <q> at the end of the last
+     * execution : exact under noise when it ran on a density matrix
+     */
+    double get_probability(size_t q)
+    {
+        if (dreg)
+            return dreg->probability(q);
+        if (mreg)
+            return mreg->probability(q);
+        if (creg)
+            return creg->probability(q);
+        if (spreg)
+            return spreg->probability(q);
+        if (!reg)
+        {
+            error("no quantum state : the last execution used the stabilizer backend");
+            return 0;
+        }
+        double p = 0;
+        for (uint64_t i=0; i<reg->states(); ++i)
+            if ((i >> q) & 1)
+                p += reg->amplitude(i).norm();
+        return p;
+    }
+
+    /**
+     * product of the weights kept by the truncations of the matrix
+     * product state of the last execution (1 when it was exact)
+     */
+    double get_truncation_fidelity()
+    {
+        return (mreg ? mreg->get_fidelity() : 1.);
+    }
+
+    /**
+     * number of shots of the last execute(navg) per measured basis
+     * state (bitstring, qubit 0 last), when the shots could be sampled
+     * from a single simulation
+     */
+    std::map<std::string,size_t> get_histogram()
+    {
+        std::map<std::string,size_t> h;
+        for (qx::shot_histogram_t::iterator it=histogram.begin(); it!=histogram.end(); ++it)
+            h[qx::qu_register::to_binary_string(it->first,ast.numQubits())] = it->second;
+        return h;
+    }
 };
 }
 
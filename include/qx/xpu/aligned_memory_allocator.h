@@ -15,6 +15,10 @@
 
 #include <new>
 
+#include "qx/xpu/numa.h"
+#include "qx/xpu/huge_pages.h"
+#include "qx/xpu/mapped_memory.h"
+
 namespace xpu
 {
 
@@ -48,15 +52,25 @@ namespace xpu
 	    }
 
 	    inline pointer allocate (size_type n) {
-	       pointer rv = (pointer)QX_ALIGNED_MEMORY_MALLOC(n*sizeof(value_type), N);
+	       size_t  bytes = n*sizeof(value_type);
+	       // out-of-core mode : large vectors live in a mapped file
+	       pointer rv = (pointer)map_state(bytes);
+	       if (rv)
+	          return rv;
+	       rv = (pointer)QX_ALIGNED_MEMORY_MALLOC(bytes, huge_page_alignment(bytes, N));
 	       if(NULL==rv) {
              throw std::bad_alloc();
 	       }
+	       // pages of the large vectors are backed by huge pages and
+	       // placed before the first write
+	       huge_pages_advise(rv, bytes);
+	       numa_place(rv, bytes);
 	       return rv;
 	    }
 
 	    inline void deallocate (pointer p, size_type) {
-	       QX_ALIGNED_MEMORY_FREE(p);
+	       if (!unmap_state(p))
+	          QX_ALIGNED_MEMORY_FREE(p);
 	    }
 
 	    inline void construct (pointer p, const value_type & wert) {
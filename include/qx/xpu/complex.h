@@ -533,6 +533,61 @@ namespace xpu
 
 
 
+   };
+
+   /**
+    * \brief single precision complex, same (im,re) layout as complex_d :
+    *    only used as a storage type, arithmetic is done by the kernels
+    *    in double precision
+    */
+   struct complex_f
+   {
+      float im, re;
+
+      complex_f ( )
+      {
+         // Do not initialize as it may corrupt the `first touch`
+      }
+
+      complex_f (float re, float im) : im(im), re(re)
+      {
+      }
+
+      complex_f (const complex_d& c) : im((float)c.im), re((float)c.re)
+      {
+      }
+
+      inline operator complex_d () const
+      {
+         return complex_d(re,im);
+      }
+
+      inline void operator = (const double v)
+      {
+         re = (float)v;
+         im = 0.f;
+      }
+
+      inline double norm() const
+      {
+         return (double)re*re + (double)im*im;
+      }
+
+      friend std::ostream &operator<<(std::ostream &os, const complex_f& c)
+      {
+         os << "(" << c.re << "," << c.im << ")";
+         return os;
+      }
+
+      friend bool operator==(const complex_f& l, const complex_f& r)
+      {
+         return ((l.re==r.re) && (l.im==r.im));
+      }
+
+      friend bool operator!=(const complex_f& l, const complex_f& r)
+      {
+         return ((l.re!=r.re) || (l.im!=r.im));
+      }
    };
 
    #ifdef __AVX__
@@ -0,0 +1,135 @@
+/**
+ * @file    huge_pages.h
+ * @brief   transparent huge pages (2 MiB) for the large state
+ *          vectors, to cut the tlb misses of the strided accesses
+ *          of the gates on high qubits
+ */
+
+#ifndef XPU_HUGE_PAGES_H
+#define XPU_HUGE_PAGES_H
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/**
+ * \brief size of a huge page, and alignment of the allocations which
+ *    ask for them (smaller ones keep the default pages)
+ */
+#define __huge_page_bytes__ (1UL << 21)
+
+namespace xpu
+{
+   /**
+    * huge pages requested for the state vectors
+    */
+   inline bool & __huge_pages_enabled()
+   {
+      static bool enabled = true;
+      return enabled;
+   }
+
+   inline bool & __huge_pages_selected()
+   {
+      static bool selected = false;
+      return selected;
+   }
+
+   /**
+    * \brief request (or not) huge pages for the state vectors
+    *    allocated from now on
+    */
+   inline void set_huge_pages(bool enabled)
+   {
+      __huge_pages_enabled()  = enabled;
+      __huge_pages_selected() = true;
+   }
+
+   /**
+    * \brief check whether huge pages are requested : QX_HUGE_PAGES=0 in
+    *    the environment disables them unless set_huge_pages() was called
+    */
+   inline bool get_huge_pages()
+   {
+      if (!__huge_pages_selected())
+      {
+         const char * env = getenv("QX_HUGE_PAGES");
+         if (env && (!strcmp(env,"0") || !strcmp(env,"off")))
+            __huge_pages_enabled() = false;
+         __huge_pages_selected() = true;
+      }
+      return __huge_pages_enabled();
+   }
+
+   /**
+    * \brief transparent huge page mode of the kernel : "always",
+    *    "madvise" or "never", or "unavailable" when the kernel has no
+    *    transparent huge pages (madvise then falls back to 4 KiB pages)
+    */
+   inline const char * huge_pages_mode()
+   {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+      static char mode[16] = "";
+      if (!mode[0])
+      {
+         strcpy(mode,"unavailable");
+         FILE * f = fopen("/sys/kernel/mm/transparent_hugepage/enabled","r");
+         if (f)
+         {
+            char line[128];
+            if (fgets(line,sizeof(line),f))
+            {
+               char * b = strchr(line,'[');
+               char * e = (b ? strchr(b,']') : NULL);
+               if (e && (e-b-1 < (long)sizeof(mode)))
+               {
+                  memcpy(mode,b+1,e-b-1);
+                  mode[e-b-1] = 0;
+               }
+            }
+            fclose(f);
+         }
+      }
+      return mode;
+#else
+      return "unavailable";
+#endif
+   }
+
+   /**
+    * \brief alignment of an allocation of <bytes> bytes aligned on <n> :
+    *    large ones start on a huge page boundary
+    */
+   inline size_t huge_page_alignment(size_t bytes, size_t n)
+   {
+      if (get_huge_pages() && (bytes >= __huge_page_bytes__) && (n < __huge_page_bytes__))
+         return __huge_page_bytes__;
+      return n;
+   }
+
+   /**
+    * \brief ask the kernel to back the fresh allocation <p> of <bytes>
+    *    bytes with huge pages, before its pages are touched. failures
+    *    (no transparent huge pages, mode "never") are harmless : the
+    *    allocation keeps 4 KiB pages.
+    */
+   inline void huge_pages_advise(void * p, size_t bytes)
+   {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+      if (!get_huge_pages() || (bytes < __huge_page_bytes__))
+         return;
+      uintptr_t first = ((uintptr_t)p + __huge_page_bytes__-1) & ~(uintptr_t)(__huge_page_bytes__-1);
+      uintptr_t last  = ((uintptr_t)p + bytes) & ~(uintptr_t)(__huge_page_bytes__-1);
+      if (last > first)
+         madvise((void *)first, last-first, MADV_HUGEPAGE);
+#endif
+   }
+
+} // namespace xpu
+
+#endif // XPU_HUGE_PAGES_H
@@ -0,0 +1,150 @@
+/**
+ * @file    isa.h
+ * @brief   runtime detection of the vector instruction set
+ *          extensions supported by the host cpu
+ */
+
+#ifndef XPU_ISA_H
+#define XPU_ISA_H
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+
+namespace xpu
+{
+   /**
+    * instruction set levels for which state-vector
+    * kernels are available, ordered by vector width
+    */
+   typedef enum __isa_t
+   {
+      __isa_sse3__,
+      __isa_avx2__,
+      __isa_avx512__
+   } isa_t;
+
+   /**
+    * \brief detect the widest instruction set supported
+    *    by both the cpu and the operating system
+    */
+   inline isa_t detect_isa()
+   {
+#if defined(_MSC_VER)
+      int info[4];
+      __cpuid(info, 0);
+      if (info[0] < 7)
+         return __isa_sse3__;
+      __cpuid(info, 1);
+      bool osxsave = (info[2] & (1 << 27)) != 0;
+      bool fma     = (info[2] & (1 << 12)) != 0;
+      if (!osxsave)
+         return __isa_sse3__;
+      unsigned long long xcr0 = _xgetbv(0);
+      __cpuidex(info, 7, 0);
+      bool avx2    = (info[1] & (1 << 5)) != 0;
+      bool avx512f = (info[1] & (1 << 16)) != 0;
+      if (avx512f && fma && ((xcr0 & 0xe6) == 0xe6))
+         return __isa_avx512__;
+      if (avx2 && fma && ((xcr0 & 0x6) == 0x6))
+         return __isa_avx2__;
+      return __isa_sse3__;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma"))
+         return __isa_avx512__;
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+         return __isa_avx2__;
+      return __isa_sse3__;
+#else
+      return __isa_sse3__;
+#endif
+   }
+
+   /**
+    * \brief instruction set name
+    */
+   inline const char * isa_name(isa_t isa)
+   {
+      switch (isa)
+      {
+         case __isa_avx512__ : return "avx512";
+         case __isa_avx2__   : return "avx2";
+         default             : return "sse3";
+      }
+   }
+
+   /**
+    * \brief parse an instruction set name ("sse3", "avx2" or "avx512")
+    * \return false if the name is unknown
+    */
+   inline bool isa_from_name(const char * name, isa_t & isa)
+   {
+      if (!strcmp(name,"sse3"))   { isa = __isa_sse3__;   return true; }
+      if (!strcmp(name,"avx2"))   { isa = __isa_avx2__;   return true; }
+      if (!strcmp(name,"avx512")) { isa = __isa_avx512__; return true; }
+      return false;
+   }
+
+   /**
+    * instruction set currently used by the kernels
+    */
+   inline isa_t & __active_isa()
+   {
+      static isa_t isa = detect_isa();
+      return isa;
+   }
+
+   inline bool & __isa_selected()
+   {
+      static bool selected = false;
+      return selected;
+   }
+
+   /**
+    * \brief force the instruction set used by the state-vector kernels,
+    *    capped to the widest one supported by the host
+    * \return the instruction set actually selected
+    */
+   inline isa_t set_isa(isa_t isa)
+   {
+      isa_t host = detect_isa();
+      __active_isa() = (isa > host ? host : isa);
+      __isa_selected() = true;
+      return __active_isa();
+   }
+
+   /**
+    * \brief select the instruction set on first use : the QX_ISA
+    *    environment variable overrides the detected one unless it
+    *    has been forced through set_isa()
+    */
+   inline isa_t select_isa()
+   {
+      if (!__isa_selected())
+      {
+         const char * env = getenv("QX_ISA");
+         isa_t isa;
+         if (env && isa_from_name(env,isa))
+            set_isa(isa);
+         __isa_selected() = true;
+      }
+      return __active_isa();
+   }
+
+   /**
+    * \brief instruction set used by the state-vector kernels, the QX_ISA
+    *    override being resolved on the first query (see select_isa())
+    */
+   inline isa_t get_isa()
+   {
+      return select_isa();
+   }
+
+} // namespace xpu
+
+#endif // XPU_ISA_H
@@ -0,0 +1,172 @@
+/**
+ * @file    mapped_memory.h
+ * @brief   out-of-core state vectors : large allocations backed by
+ *          memory-mapped files on a local disk, to simulate registers
+ *          which do not fit in memory
+ */
+
+#ifndef XPU_MAPPED_MEMORY_H
+#define XPU_MAPPED_MEMORY_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <new>
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#define XPU_MAPPED_MEMORY
+#endif
+
+/**
+ * \brief allocations smaller than this (2 MiB) always stay in memory
+ */
+#define __mapped_min_bytes__ (1UL << 21)
+
+namespace xpu
+{
+   /**
+    * directory of the backing files, empty when the state vectors stay
+    * in memory
+    */
+   inline std::string & __state_directory()
+   {
+      static std::string dir;
+      return dir;
+   }
+
+   /**
+    * live mappings and their length
+    */
+   inline std::map<void *,size_t> & __mappings()
+   {
+      static std::map<void *,size_t> m;
+      return m;
+   }
+
+   inline std::mutex & __mappings_lock()
+   {
+      static std::mutex l;
+      return l;
+   }
+
+   inline std::atomic<size_t> & __mappings_count()
+   {
+      static std::atomic<size_t> c(0);
+      return c;
+   }
+
+   /**
+    * \brief back the state vectors allocated from now on with files
+    *    created in <dir> (out-of-core mode), or keep them in memory if
+    *    <dir> is empty
+    * \return false if files can not be mapped on this platform or can
+    *    not be created in <dir> (the directory is then left unchanged)
+    */
+   inline bool set_state_directory(const std::string & dir)
+   {
+#ifdef XPU_MAPPED_MEMORY
+      if (!dir.empty())
+      {
+         // probe file
+         std::string path = dir + "/qx_state_XXXXXX";
+         std::vector<char> name(path.begin(), path.end());
+         name.push_back(0);
+         int fd = mkstemp(name.data());
+         if (fd < 0)
+            return false;
+         unlink(name.data());
+         close(fd);
+      }
+      __state_directory() = dir;
+      return true;
+#else
+      return dir.empty();
+#endif
+   }
+
+   inline const std::string & get_state_directory()
+   {
+      return __state_directory();
+   }
+
+   /**
+    * \brief bytes of the live mappings
+    */
+   inline size_t mapped_bytes()
+   {
+      std::lock_guard<std::mutex> guard(__mappings_lock());
+      size_t bytes = 0;
+      for (std::map<void *,size_t>::iterator it = __mappings().begin(); it != __mappings().end(); ++it)
+         bytes += it->second;
+      return bytes;
+   }
+
+   /**
+    * \brief map <bytes> bytes of a new file of the state directory : the
+    *    file is unlinked right away, so that its blocks are released with
+    *    the mapping (or when the process dies), and the kernel pages the
+    *    state in and out of the page cache as the kernels sweep it.
+    * \return the mapping, or NULL in memory mode and for small
+    *    allocations ; throws std::bad_alloc when the file can not be
+    *    created or mapped, rather than falling back on memory
+    */
+   inline void * map_state(size_t bytes)
+   {
+#ifdef XPU_MAPPED_MEMORY
+      const std::string & dir = __state_directory();
+      if (dir.empty() || (bytes < __mapped_min_bytes__))
+         return NULL;
+      std::string path = dir + "/qx_state_XXXXXX";
+      std::vector<char> name(path.begin(), path.end());
+      name.push_back(0);
+      int fd = mkstemp(name.data());
+      if (fd < 0)
+         throw std::bad_alloc();
+      unlink(name.data());
+      void * p = MAP_FAILED;
+      if (!ftruncate(fd, (off_t)bytes))
+         p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (p == MAP_FAILED)
+         throw std::bad_alloc();
+      std::lock_guard<std::mutex> guard(__mappings_lock());
+      __mappings()[p] = bytes;
+      __mappings_count()++;
+      return p;
+#else
+      return NULL;
+#endif
+   }
+
+   /**
+    * \brief release <p> if it was returned by map_state()
+    * \return false if <p> is not a mapping
+    */
+   inline bool unmap_state(void * p)
+   {
+#ifdef XPU_MAPPED_MEMORY
+      if (!__mappings_count())
+         return false;
+      std::lock_guard<std::mutex> guard(__mappings_lock());
+      std::map<void *,size_t>::iterator it = __mappings().find(p);
+      if (it == __mappings().end())
+         return false;
+      munmap(p, it->second);
+      __mappings().erase(it);
+      __mappings_count()--;
+      return true;
+#else
+      return false;
+#endif
+   }
+
+} // namespace xpu
+
+#endif // XPU_MAPPED_MEMORY_H
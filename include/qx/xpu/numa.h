@@ -0,0 +1,179 @@
+/**
+ * @file    numa.h
+ * @brief   placement of the large state vectors on the numa
+ *          nodes of the host
+ */
+
+#ifndef XPU_NUMA_H
+#define XPU_NUMA_H
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * \brief allocations smaller than this (2 MiB) are left to the default
+ *    placement of the operating system
+ */
+#define __numa_min_bytes__ (1UL << 21)
+
+namespace xpu
+{
+   /**
+    * placement of the pages of the state vectors
+    *  - first_touch : each thread touches the pages of the contiguous
+    *    slice of the vector that the static schedule of the kernels gives
+    *    it, so that they land on its node
+    *  - interleave  : the pages are spread round-robin over all the nodes
+    *  - none        : the pages land where they are first written, which
+    *    is the node of the allocating thread
+    */
+   typedef enum __numa_policy_t
+   {
+      __numa_first_touch__,
+      __numa_interleave__,
+      __numa_none__
+   } numa_policy_t;
+
+   /**
+    * \brief policy name
+    */
+   inline const char * numa_policy_name(numa_policy_t p)
+   {
+      switch (p)
+      {
+         case __numa_interleave__ : return "interleave";
+         case __numa_none__       : return "none";
+         default                  : return "first_touch";
+      }
+   }
+
+   /**
+    * \brief parse a policy name ("first_touch", "interleave" or "none")
+    * \return false if the name is unknown
+    */
+   inline bool numa_policy_from_name(const char * name, numa_policy_t & p)
+   {
+      if (!strcmp(name,"first_touch")) { p = __numa_first_touch__; return true; }
+      if (!strcmp(name,"interleave"))  { p = __numa_interleave__;  return true; }
+      if (!strcmp(name,"none"))        { p = __numa_none__;        return true; }
+      return false;
+   }
+
+   /**
+    * \brief number of numa nodes of the host (1 when unknown)
+    */
+   inline size_t numa_nodes()
+   {
+      size_t nodes = 0;
+#if defined(__linux__)
+      DIR * d = opendir("/sys/devices/system/node");
+      if (d)
+      {
+         struct dirent * e;
+         while ((e = readdir(d)))
+            if (!strncmp(e->d_name,"node",4) && (e->d_name[4] >= '0') && (e->d_name[4] <= '9'))
+               nodes++;
+         closedir(d);
+      }
+#endif
+      return (nodes ? nodes : 1);
+   }
+
+   /**
+    * policy currently used for the state vectors
+    */
+   inline numa_policy_t & __active_numa_policy()
+   {
+      static numa_policy_t p = __numa_first_touch__;
+      return p;
+   }
+
+   inline bool & __numa_policy_selected()
+   {
+      static bool selected = false;
+      return selected;
+   }
+
+   /**
+    * \brief force the placement policy of the state vectors
+    */
+   inline void set_numa_policy(numa_policy_t p)
+   {
+      __active_numa_policy()   = p;
+      __numa_policy_selected() = true;
+   }
+
+   /**
+    * \brief policy used for the state vectors : the QX_NUMA environment
+    *    variable overrides the default (first_touch) unless the policy
+    *    has been forced through set_numa_policy()
+    */
+   inline numa_policy_t get_numa_policy()
+   {
+      if (!__numa_policy_selected())
+      {
+         const char * env = getenv("QX_NUMA");
+         numa_policy_t p;
+         if (env && numa_policy_from_name(env,p))
+            __active_numa_policy() = p;
+         __numa_policy_selected() = true;
+      }
+      return __active_numa_policy();
+   }
+
+   /**
+    * \brief place the pages of the fresh allocation <p> of <bytes> bytes
+    *    according to the active policy, before anything is written to it :
+    *    interleaving binds the whole pages to all the nodes (mbind), then
+    *    the pages are touched in parallel, with the static schedule of the
+    *    kernels, which places them for first_touch and faults them in
+    *    concurrently for interleave
+    */
+   inline void numa_place(void * p, size_t bytes)
+   {
+      numa_policy_t policy = get_numa_policy();
+      if ((policy == __numa_none__) || (bytes < __numa_min_bytes__))
+         return;
+
+      size_t    page  = 4096;
+#if defined(__linux__)
+      page = sysconf(_SC_PAGESIZE);
+#endif
+      uintptr_t first = ((uintptr_t)p + page-1) & ~(uintptr_t)(page-1);
+      uintptr_t last  = ((uintptr_t)p + bytes) & ~(uintptr_t)(page-1);
+      if (last <= first)
+         return;
+
+#if defined(__linux__) && defined(SYS_mbind)
+      if ((policy == __numa_interleave__) && (numa_nodes() > 1))
+      {
+         const int     mpol_interleave = 3;
+         unsigned long mask = ~0UL; // restricted by the kernel to the allowed nodes
+         syscall(SYS_mbind, (void *)first, (unsigned long)(last-first), mpol_interleave, &mask, (unsigned long)(8*sizeof(mask)), 0U);
+      }
+#endif
+
+      int64_t pages = (int64_t)((last-first)/page);
+      char *  base  = (char *)first;
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+      for (int64_t i=0; i<pages; ++i)
+         base[i*page] = 0;
+   }
+
+} // namespace xpu
+
+#endif // XPU_NUMA_H
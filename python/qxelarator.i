@@ -10,6 +10,9 @@
 %module(docstring=DOCSTRING) qxelarator
 
 %include "std_string.i"
+%include "std_map.i"
+
+%template(histogram) std::map<std::string, size_t>;
 
 %{
 #include "qx/qxelarator.h"
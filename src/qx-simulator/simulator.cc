@@ -39,19 +39,121 @@ int main(int argc, char **argv)
    std::string file_path;
    size_t ncpu = 0;
    size_t navg = 0;
+   size_t fusion_qubits = 0;
+   bool remapping = false;
+   size_t memory_budget = 0;
+   size_t max_bond = __mps_default_max_bond__;
+   double cutoff = __mps_default_cutoff__;
+   double tolerance = __compressed_default_tolerance__;
+   std::string checkpoint_file;
+   std::string restore_file;
+   size_t checkpoint_interval = __checkpoint_default_interval__;
+   qx::precision_t precision = qx::__double_precision__;
+   qx::backend_t backend = qx::__auto_backend__;
+   std::vector<std::string> args;
    print_banner();
 
-   if (!(argc == 2 || argc == 3 || argc == 4))
+   // options are introduced by '-', the rest are positional arguments
+   for (int i=1; i<argc; ++i)
+   {
+      std::string arg(argv[i]);
+      if ((arg == "-fuse") && ((i+1) < argc))
+         fusion_qubits = atoi(argv[++i]);
+      else if (arg == "-remap")
+         remapping = true;
+      else if ((arg == "-backend") && ((i+1) < argc))
+      {
+         if (!qx::backend_from_name(argv[++i], backend))
+         {
+            println("[x] error : unknown backend '" << argv[i] << "' (auto, state_vector, stabilizer, density_matrix, mps, compressed or sparse)");
+            return -1;
+         }
+      }
+      else if ((arg == "-numa") && ((i+1) < argc))
+      {
+         xpu::numa_policy_t policy;
+         if (!xpu::numa_policy_from_name(argv[++i], policy))
+         {
+            println("[x] error : unknown numa placement '" << argv[i] << "' (first_touch, interleave or none)");
+            return -1;
+         }
+         xpu::set_numa_policy(policy);
+      }
+      else if ((arg == "-out_of_core") && ((i+1) < argc))
+      {
+         if (!xpu::set_state_directory(argv[++i]))
+         {
+            println("[x] error : can not create the out-of-core state files in '" << argv[i] << "' (or they are not supported on this platform)");
+            return -1;
+         }
+         remapping = true;
+      }
+      else if ((arg == "-huge_pages") && ((i+1) < argc))
+      {
+         std::string h(argv[++i]);
+         if ((h != "on") && (h != "off"))
+         {
+            println("[x] error : unknown huge page setting '" << h << "' (on or off)");
+            return -1;
+         }
+         xpu::set_huge_pages(h == "on");
+      }
+      else if ((arg == "-memory") && ((i+1) < argc))
+         memory_budget = ((size_t)atoi(argv[++i])) << 20;
+      else if ((arg == "-bond") && ((i+1) < argc))
+         max_bond = atoi(argv[++i]);
+      else if ((arg == "-cutoff") && ((i+1) < argc))
+         cutoff = atof(argv[++i]);
+      else if ((arg == "-tolerance") && ((i+1) < argc))
+         tolerance = atof(argv[++i]);
+      else if ((arg == "-checkpoint") && ((i+1) < argc))
+         checkpoint_file = argv[++i];
+      else if ((arg == "-checkpoint_interval") && ((i+1) < argc))
+         checkpoint_interval = atoi(argv[++i]);
+      else if ((arg == "-restore") && ((i+1) < argc))
+         restore_file = argv[++i];
+      else if ((arg == "-precision") && ((i+1) < argc))
+      {
+         std::string p(argv[++i]);
+         if (p == "single")
+            precision = qx::__single_precision__;
+         else if (p != "double")
+         {
+            println("[x] error : unknown precision '" << p << "' (single or double)");
+            return -1;
+         }
+      }
+      else
+         args.push_back(arg);
+   }
+
+   if (args.empty() || (args.size() > 3))
    {
       println("error : you must specify a circuit file !");
-      println("usage: \n   " << argv[0] << " file.qc [iterations] [num_cpu]");
+      println("usage: \n   " << argv[0] << " [options] file.qc [iterations] [num_cpu]");
+      println("options:");
+      println("   -fuse <k>                      fuse gates into dense unitaries on up to k (2..5) qubits");
+      println("   -remap                         move the qubits of upcoming gates to the low, cache-local qubits");
+      println("   -precision <single|double>     amplitude precision of the state vector (default: double)");
+      println("   -backend <name>                auto (default), state_vector, stabilizer (clifford circuits only), density_matrix, mps, compressed or sparse");
+      println("   -numa <policy>                 placement of the state vector : first_touch (default), interleave or none");
+      println("   -out_of_core <dir>             keep the state vector in a file mapped from <dir> (implies -remap)");
+      println("   -huge_pages <on|off>           back the state vector with transparent huge pages (default: on)");
+      println("   -memory <MiB>                  memory budget of the concurrent noisy trajectories");
+      println("   -bond <chi>                    largest bond dimension of the mps backend (default: " << __mps_default_max_bond__ << ")");
+      println("   -cutoff <w>                    weight of the singular values dropped by the mps backend (default: " << __mps_default_cutoff__ << ")");
+      println("   -tolerance <w>                 weight of the amplitudes dropped by the compressed backend (default: " << __compressed_default_tolerance__ << ")");
+      println("   -checkpoint <file>             write the state vector to <file> every -checkpoint_interval gates (single noiseless runs)");
+      println("   -checkpoint_interval <gates>   gates applied between two checkpoints (default: " << __checkpoint_default_interval__ << ")");
+      println("   -restore <file>                resume the run from the checkpoint <file>");
+      println("num_cpu: number of noisy trajectories simulated concurrently (default: 1)");
       return -1;
    }
 
    // parse arguments and initialise xpu cores
-   file_path = argv[1];
-   if (argc > 2) navg = (atoi(argv[2]));
-   if (argc > 3) ncpu = (atoi(argv[3]));
+   file_path = args[0];
+   if (args.size() > 1) navg = (atoi(args[1].c_str()));
+   if (args.size() > 2) ncpu = (atoi(args[2].c_str()));
    //if (ncpu && ncpu < 128) xpu::init(ncpu);
    //else xpu::init();
 
@@ -92,20 +194,6 @@ int main(int argc, char **argv)
    double                     error_probability = 0;
    qx::error_model_t          error_model       = qx::__unknown_error_model__;
 
-   // create the quantum state
-   println("[+] creating quantum register of " << qubits << " qubits... ");
-   try {
-      reg = new qx::qu_register(qubits);
-   } catch(std::bad_alloc& exception) {
-      std::cerr << "[x] not enough memory, aborting" << std::endl;
-      //xpu::clean();
-      return -1;
-   } catch(std::exception& exception) {
-      std::cerr << "[x] unexpected exception (" << exception.what() << "), aborting" << std::endl;
-      //xpu::clean();
-      return -1;
-   }
-
    // convert libqasm ast to qx internal representation
    // qx::QxRepresentation qxr = qx::QxRepresentation(qubits);
    std::vector<compiler::SubCircuit> subcircuits = ast.getSubCircuits().getAllSubCircuits();
@@ -132,45 +220,373 @@ int main(int argc, char **argv)
       error_probability = ast.getErrorModelParameters().at(0);
       error_model       = qx::__depolarizing_channel__;
    }
+   else if (ast.getErrorModelType() == "amplitude_damping")
+   {
+      error_model       = qx::__amplitude_damping__;
+   }
+   else if (ast.getErrorModelType() == "phase_damping")
+   {
+      error_model       = qx::__phase_damping__;
+   }
 
-   // measurement averaging
-   if (navg)
+   // relaxation times of the damping models
+   double t1 = 0, t2 = 0;
+   bool   damping = ((error_model == qx::__amplitude_damping__) || (error_model == qx::__phase_damping__));
+   if (damping && !qx::damping_times(error_model, ast.getErrorModelParameters(), t1, t2))
    {
-#ifdef USE_GPERFTOOLS
-      ProfilerStart("profile.log");
-#endif
-      if (error_model == qx::__depolarizing_channel__)
+      println("[x] error : invalid relaxation times (amplitude_damping, t1[, t2 <= 2*t1] or phase_damping, t2)");
+      return -1;
+   }
+
+   // checkpoints cover single noiseless runs of the state vector
+   bool noisy    = (error_model == qx::__depolarizing_channel__);
+   bool checkpointed = (!checkpoint_file.empty() || !restore_file.empty());
+   if (checkpointed)
+   {
+      if (noisy || damping || navg || ((backend != qx::__auto_backend__) && (backend != qx::__state_vector_backend__)))
       {
-         qx::measure m;
-         for (size_t s=0; s<navg; ++s)
+         println("[x] error : checkpoints are only taken for single noiseless runs of the state vector backend");
+         return -1;
+      }
+      backend = qx::__state_vector_backend__;
+   }
+
+   // clifford circuits are simulated on a stabilizer tableau, and the
+   // shots of noisy ones are drawn by pauli frame sampling
+   bool frames   = (navg && !perfect_circuits.empty() && qx::pauli_frame_sampler::supports(perfect_circuits));
+   bool clifford = (qx::is_clifford(perfect_circuits) && (!noisy || frames) && !damping);
+   if ((backend == qx::__stabilizer_backend__) && !clifford)
+   {
+      println("[x] error : the stabilizer backend only simulates clifford circuits, noiseless or depolarized with pauli feedback");
+      return -1;
+   }
+   if (clifford && ((backend == qx::__stabilizer_backend__) || (backend == qx::__auto_backend__)))
+   {
+      println("[+] clifford circuits : using the stabilizer backend");
+      qx::stabilizer_register sreg(qubits);
+      if (navg)
+      {
+         bool measured   = false;
+         bool sampleable = (qubits <= 64);
+         for (size_t i=0; (i<perfect_circuits.size()) && sampleable; i++)
+            sampleable = perfect_circuits[i]->terminal_measurements_only(measured);
+
+         qx::shot_histogram_t histogram;
+         if (frames)
          {
-            reg->reset();
+            println("[+] pauli frame sampling of " << navg << " shots...");
+            qx::pauli_frame_sampler    sampler(qubits);
+            qx::depolarizing_channel * channel = (noisy ? new qx::depolarizing_channel(perfect_circuits[0], qubits, error_probability) : NULL);
+            sampler.run(perfect_circuits, sreg, navg, channel, (sampleable ? &histogram : NULL));
+            delete channel;
+         }
+         else
+         {
+            qx::measure m;
+            for (size_t s=0; s<navg; ++s)
+            {
+               sreg.reset();
+               for (size_t i=0; i<perfect_circuits.size(); i++)
+                  sreg.execute(perfect_circuits[i]);
+               sreg.apply(&m);
+               if (sampleable)
+                  histogram[sreg.get_measurements()]++;
+            }
+         }
+         if (sampleable)
+         {
+            println("[+] " << navg << " shots :");
+            for (qx::shot_histogram_t::iterator it=histogram.begin(); it!=histogram.end(); ++it)
+               println("   |" << qx::qu_register::to_binary_string(it->first,qubits) << "> : " << it->second);
+         }
+         println("[+] average measurement after " << navg << " shots:");
+         sreg.dump();
+      }
+      else
+      {
+         for (size_t i=0; i<perfect_circuits.size(); i++)
+            sreg.execute(perfect_circuits[i]);
+      }
+      return 0;
+   }
+
+   // noiseless circuits too large for a state vector run on a matrix
+   // product state, whose size depends on the entanglement
+   bool chain = (!noisy && !damping && qx::mps_register::supports(perfect_circuits));
+   if ((backend == qx::__mps_backend__) && !chain)
+   {
+      println("[x] error : the mps backend only simulates noiseless circuits of single-qubit and singly-controlled gates");
+      return -1;
+   }
+   if ((backend == qx::__mps_backend__) || ((backend == qx::__auto_backend__) && chain && (qubits >= __mps_auto_min_qubits__)))
+   {
+      println("[+] creating matrix product state of " << qubits << " qubits (bond dimension <= " << max_bond << ")... ");
+      qx::mps_register mreg(qubits, max_bond, cutoff);
+      if (navg)
+      {
+         bool measured   = false;
+         bool sampleable = true;
+         for (size_t i=0; (i<perfect_circuits.size()) && sampleable; i++)
+            sampleable = perfect_circuits[i]->terminal_measurements_only(measured);
+
+         if (sampleable)
+         {
+            // simulate once and draw all the shots from the final state
             for (size_t i=0; i<perfect_circuits.size(); i++)
             {
-               if (perfect_circuits[i]->size() == 0)
-                  continue;
-               size_t iterations = perfect_circuits[i]->get_iterations();
-               if (iterations > 1)
-               {
-                  for (size_t it=0; it<iterations; ++it)
-                  {
-                     qx::noisy_dep_ch(perfect_circuits[i],error_probability,total_errors)->execute(*reg,false,true);
-                  }
-               } else
-                     qx::noisy_dep_ch(perfect_circuits[i],error_probability,total_errors)->execute(*reg,false,true);
+               perfect_circuits[i]->remove_measurements();
+               mreg.execute(perfect_circuits[i]);
+            }
+            qx::shot_histogram_t histogram = mreg.sample(navg);
+            if (qubits <= 64)
+            {
+               println("[+] " << navg << " shots sampled from the final state :");
+               for (qx::shot_histogram_t::iterator it=histogram.begin(); it!=histogram.end(); ++it)
+                  println("   |" << qx::qu_register::to_binary_string(it->first,qubits) << "> : " << it->second);
             }
-            m.apply(*reg);
          }
+         else
+         {
+            qx::measure m;
+            for (size_t s=0; s<navg; ++s)
+            {
+               mreg.reset();
+               for (size_t i=0; i<perfect_circuits.size(); i++)
+                  mreg.execute(perfect_circuits[i]);
+               mreg.apply(&m);
+            }
+         }
+         println("[+] average measurement after " << navg << " shots:");
+         mreg.dump(true);
       }
       else
+      {
+         for (size_t i=0; i<perfect_circuits.size(); i++)
+            mreg.execute(perfect_circuits[i]);
+      }
+      println("[+] largest bond dimension : " << mreg.bond_dimension() << ", truncation fidelity : " << mreg.get_fidelity());
+      return 0;
+   }
+
+   // noiseless circuits whose states have a small support run on a
+   // compressed state vector when asked to
+   if (backend == qx::__compressed_backend__)
+   {
+      if (noisy || damping || !qx::compressed_register::supports(perfect_circuits))
+      {
+         println("[x] error : the compressed backend only simulates noiseless circuits of single-qubit, controlled, diagonal and swap gates");
+         return -1;
+      }
+      println("[+] creating compressed state vector of " << qubits << " qubits... ");
+      qx::compressed_register creg(qubits, tolerance);
+      if (navg)
       {
          qx::measure m;
          for (size_t s=0; s<navg; ++s)
          {
+            creg.reset();
+            for (size_t i=0; i<perfect_circuits.size(); i++)
+               creg.execute(perfect_circuits[i]);
+            creg.apply(&m);
+         }
+         println("[+] average measurement after " << navg << " shots:");
+         creg.dump(true);
+      }
+      else
+      {
+         for (size_t i=0; i<perfect_circuits.size(); i++)
+            creg.execute(perfect_circuits[i]);
+      }
+      println("[+] compressed state : " << (creg.peak_bytes() >> 20) << " MiB at the peak, compression ratio : " << creg.compression_ratio() << ", error bound : " << creg.error_bound());
+      return 0;
+   }
+
+   // arithmetic and oracle circuits keep few non-zero amplitudes : they
+   // run on a sparse state when asked to, which moves to a state vector
+   // when they grow too many
+   if (backend == qx::__sparse_backend__)
+   {
+      if (noisy || damping)
+      {
+         println("[x] error : the sparse backend only simulates noiseless circuits");
+         return -1;
+      }
+      println("[+] creating sparse state of " << qubits << " qubits... ");
+      qx::sparse_register spreg(qubits);
+      if (navg)
+      {
+         qx::measure m;
+         for (size_t s=0; s<navg; ++s)
+         {
+            spreg.reset();
+            for (size_t i=0; i<perfect_circuits.size(); i++)
+               spreg.execute(perfect_circuits[i]);
+            spreg.apply(&m);
+         }
+         println("[+] average measurement after " << navg << " shots:");
+         spreg.dump(true);
+      }
+      else
+      {
+         for (size_t i=0; i<perfect_circuits.size(); i++)
+            spreg.execute(perfect_circuits[i]);
+      }
+      println("[+] sparse state : " << spreg.peak_support() << " amplitudes at the peak" << (spreg.is_dense() ? ", switched to a state vector" : ""));
+      return 0;
+   }
+
+   // a density matrix replaces the damped trajectories when it is cheaper
+   // than the shots ; the depolarizing channel draws the errors of a step
+   // jointly, which the per-qubit kraus channels only approximate, so its
+   // trajectories are kept unless the density matrix is asked for
+   bool mixed = qx::density_matrix_register::supports(perfect_circuits);
+   if ((backend == qx::__density_matrix_backend__) && !mixed)
+   {
+      println("[x] error : the density matrix backend does not simulate binary-controlled gates");
+      return -1;
+   }
+   if ((backend == qx::__density_matrix_backend__) || ((backend == qx::__auto_backend__) && mixed && damping && qx::density_matrix_preferred(qubits,navg)))
+   {
+      println("[+] creating density matrix of " << qubits << " qubits... ");
+      qx::density_matrix_register * dreg = NULL;
+      try {
+         dreg = new qx::density_matrix_register(qubits);
+      } catch(std::bad_alloc& exception) {
+         std::cerr << "[x] not enough memory, aborting" << std::endl;
+         return -1;
+      } catch(std::exception& exception) {
+         std::cerr << "[x] unexpected exception (" << exception.what() << "), aborting" << std::endl;
+         return -1;
+      }
+      if (damping)
+         dreg->set_damping(t1, t2);
+      else if (noisy)
+         dreg->set_noise(qx::depolarizing_kraus(error_probability), qx::bit_flip_kraus(error_probability));
+      for (size_t i=0; i<perfect_circuits.size(); i++)
+         dreg->execute(perfect_circuits[i]);
+      if (navg)
+      {
+         dreg->measure();
+         println("[+] exact measurement averaging (in place of " << navg << " shots):");
+         dreg->dump(true);
+      }
+      delete dreg;
+      return 0;
+   }
+
+   // the gates of noisy runs are not grouped in cache blocks, so each gate
+   // and each error would read and write back the whole mapped file
+   if (!xpu::get_state_directory().empty() && (noisy || damping))
+   {
+      println("[x] error : out-of-core state vectors only run noiseless circuits");
+      return -1;
+   }
+
+   // create the quantum state
+   println("[+] creating quantum register of " << qubits << " qubits... ");
+   try {
+      reg = new qx::qu_register(qubits, precision);
+   } catch(std::bad_alloc& exception) {
+      if (!xpu::get_state_directory().empty())
+         std::cerr << "[x] could not map the state vector from " << xpu::get_state_directory() << ", aborting" << std::endl;
+      else
+         std::cerr << "[x] not enough memory, aborting (see -out_of_core)" << std::endl;
+      //xpu::clean();
+      return -1;
+   } catch(std::exception& exception) {
+      std::cerr << "[x] unexpected exception (" << exception.what() << "), aborting" << std::endl;
+      //xpu::clean();
+      return -1;
+   }
+   println("[+] vector instruction set : " << xpu::isa_name(xpu::get_isa()));
+   println("[+] numa placement : " << xpu::numa_policy_name(xpu::get_numa_policy()) << " (" << xpu::numa_nodes() << " nodes)");
+   if (xpu::mapped_bytes())
+      println("[+] out-of-core state vector : " << (xpu::mapped_bytes() >> 20) << " MiB mapped from " << xpu::get_state_directory());
+   else if (!xpu::get_state_directory().empty())
+      println("[+] out-of-core state vector : none, the register is small enough to stay in memory");
+   println("[+] huge pages : " << (xpu::get_huge_pages() ? "on" : "off") << " (transparent huge pages : " << xpu::huge_pages_mode() << ")");
+   if (precision == qx::__single_precision__)
+      println("[+] amplitude precision : single");
+
+   // merge the gates of noiseless circuits, optionally remap their qubits,
+   // and group those on the low qubits to apply them block by block
+   if (!noisy && !damping)
+   {
+      size_t fused = 0;
+      for (size_t i=0; i<perfect_circuits.size(); i++)
+         fused += (fusion_qubits > 1 ? perfect_circuits[i]->fuse_dense(fusion_qubits) : perfect_circuits[i]->fuse());
+      if (fused)
+         println("[+] gate fusion removed " << fused << " gates.");
+      if (remapping)
+      {
+         size_t moves = 0;
+         for (size_t i=0; i<perfect_circuits.size(); i++)
+            moves += perfect_circuits[i]->remap();
+         println("[+] qubit remapping : " << moves << " swaps.");
+      }
+      size_t tiled = 0;
+      for (size_t i=0; i<perfect_circuits.size(); i++)
+         tiled += perfect_circuits[i]->tile();
+      if (tiled)
+         println("[+] cache blocking : " << tiled << " groups of gates on qubits < " << __tile_qubits__ << ".");
+      size_t ungrouped = 0;
+      for (size_t i=0; i<perfect_circuits.size(); i++)
+         ungrouped += perfect_circuits[i]->ungrouped();
+      if (ungrouped && xpu::mapped_bytes())
+         println("[!] warning : out-of-core state vector : " << ungrouped << " gates (measurements, displays, binary-controlled gates or gates left on the high qubits by remapping) are not grouped in cache blocks and sweep the whole mapped file each.");
+   }
+
+   // measurement averaging
+   if (navg)
+   {
+#ifdef USE_GPERFTOOLS
+      ProfilerStart("profile.log");
+#endif
+      if (error_model == qx::__depolarizing_channel__)
+      {
+         size_t workers = qx::trajectory_workers(qubits, precision, (ncpu ? ncpu : 1), memory_budget);
+         if (workers > 1)
+            println("[+] simulating " << workers << " noisy trajectories concurrently...");
+         qx::run_dep_ch_trajectories(perfect_circuits, *reg, error_probability, navg, workers, total_errors);
+      }
+      else if (damping)
+      {
+         size_t workers = qx::trajectory_workers(qubits, precision, (ncpu ? ncpu : 1), memory_budget);
+         if (workers > 1)
+            println("[+] simulating " << workers << " quantum-jump trajectories concurrently...");
+         qx::run_damping_trajectories(perfect_circuits, *reg, t1, t2, navg, workers, total_errors);
+      }
+      else
+      {
+         bool measured   = false;
+         bool sampleable = true;
+         for (size_t i=0; (i<perfect_circuits.size()) && sampleable; i++)
+            sampleable = perfect_circuits[i]->terminal_measurements_only(measured);
+
+         if (sampleable)
+         {
+            // unitary circuits : simulate once and draw all the shots
             reg->reset();
             for (size_t i=0; i<perfect_circuits.size(); i++)
+            {
+               perfect_circuits[i]->remove_measurements();
                perfect_circuits[i]->execute(*reg,false,true);
-            m.apply(*reg);
+            }
+            qx::shot_histogram_t histogram = reg->sample(navg);
+            println("[+] " << navg << " shots sampled from the final state :");
+            for (qx::shot_histogram_t::iterator it=histogram.begin(); it!=histogram.end(); ++it)
+               println("   |" << reg->to_binary_string(it->first,qubits) << "> : " << it->second);
+         }
+         else
+         {
+            qx::measure m;
+            for (size_t s=0; s<navg; ++s)
+            {
+               reg->reset();
+               for (size_t i=0; i<perfect_circuits.size(); i++)
+                  perfect_circuits[i]->execute(*reg,false,true);
+               m.apply(*reg);
+            }
          }
       }
 #ifdef USE_GPERFTOOLS
@@ -184,31 +600,33 @@ int main(int argc, char **argv)
       // if (qxr.getErrorModel() == qx::__depolarizing_channel__)
       if (error_model == qx::__depolarizing_channel__)
       {
-         // println("[+] generating noisy circuits (p=" << qxr.getErrorProbability() << ")...");
          for (size_t i=0; i<perfect_circuits.size(); i++)
-         {
-            if (perfect_circuits[i]->size() == 0)
-               continue;
-            // println("[>] processing circuit '" << perfect_circuits[i]->id() << "'...");
-            size_t iterations = perfect_circuits[i]->get_iterations();
-            if (iterations > 1)
-            {
-               for (size_t it=0; it<iterations; ++it)
-                  circuits.push_back(qx::noisy_dep_ch(perfect_circuits[i],error_probability,total_errors));
-            }
-            else
-            {
-               circuits.push_back(qx::noisy_dep_ch(perfect_circuits[i],error_probability,total_errors));
-            }
-         }
-         // println("[+] total errors injected in all circuits : " << total_errors);
+            qx::execute_dep_ch(perfect_circuits[i],*reg,error_probability,total_errors);
+      }
+      else if (damping)
+      {
+         for (size_t i=0; i<perfect_circuits.size(); i++)
+            qx::execute_damping(perfect_circuits[i],*reg,t1,t2,total_errors);
       }
       else 
          circuits = perfect_circuits; // qxr.circuits();
 
-
-      for (size_t i=0; i<circuits.size(); i++)
-         circuits[i]->execute(*reg);
+      if (checkpointed)
+      {
+         qx::checkpoint_position_t start = { 0, 0, 0 };
+         if (!restore_file.empty())
+         {
+            if (!qx::load_checkpoint(restore_file, *reg, start, qx::checkpoint_fingerprint(circuits)))
+               return -1;
+            println("[+] restored checkpoint '" << restore_file << "' : circuit " << start.circuit << ", iteration " << start.iteration << ", gate " << start.gate);
+         }
+         size_t written = qx::execute_checkpointed(circuits, *reg, checkpoint_file, checkpoint_interval, start);
+         if (!checkpoint_file.empty())
+            println("[+] " << written << " checkpoints written to '" << checkpoint_file << "'");
+      }
+      else
+         for (size_t i=0; i<circuits.size(); i++)
+            circuits[i]->execute(*reg);
    }
 
    // exit(0);
@@ -0,0 +1,47 @@
+version 1.0
+
+qubits 40
+
+.chain
+	ry q[0], 1.0
+	cnot q[0], q[1]
+	cnot q[1], q[2]
+	cnot q[2], q[3]
+	cnot q[3], q[4]
+	cnot q[4], q[5]
+	cnot q[5], q[6]
+	cnot q[6], q[7]
+	cnot q[7], q[8]
+	cnot q[8], q[9]
+	cnot q[9], q[10]
+	cnot q[10], q[11]
+	cnot q[11], q[12]
+	cnot q[12], q[13]
+	cnot q[13], q[14]
+	cnot q[14], q[15]
+	cnot q[15], q[16]
+	cnot q[16], q[17]
+	cnot q[17], q[18]
+	cnot q[18], q[19]
+	cnot q[19], q[20]
+	cnot q[20], q[21]
+	cnot q[21], q[22]
+	cnot q[22], q[23]
+	cnot q[23], q[24]
+	cnot q[24], q[25]
+	cnot q[25], q[26]
+	cnot q[26], q[27]
+	cnot q[27], q[28]
+	cnot q[28], q[29]
+	cnot q[29], q[30]
+	cnot q[30], q[31]
+	cnot q[31], q[32]
+	cnot q[32], q[33]
+	cnot q[33], q[34]
+	cnot q[34], q[35]
+	cnot q[35], q[36]
+	cnot q[36], q[37]
+	cnot q[37], q[38]
+	cnot q[38], q[39]
+	cz q[0], q[39]
+	cnot q[39], q[0]
@@ -0,0 +1,9 @@
+version 1.0
+
+qubits 2
+
+error_model amplitude_damping, 10
+
+.decay
+	x q[0]
+	h q[1]
@@ -0,0 +1,8 @@
+version 1.0
+
+qubits 2
+
+error_model depolarizing_channel, 0.1
+
+.measure
+	measure q[0]
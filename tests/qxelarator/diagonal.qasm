@@ -0,0 +1,29 @@
+version 1.0
+
+qubits 3
+
+.init
+	prep_z q[0]
+	prep_z q[1]
+	prep_z q[2]
+
+.phases
+	h q[0]
+	h q[1]
+	h q[2]
+	s q[0]
+	t q[1]
+	cz q[0], q[2]
+	s q[0]
+	tdag q[1]
+	z q[1]
+	rz q[2], 3.141592653589793
+	cz q[0], q[2]
+	s q[2]
+	sdag q[2]
+	h q[0]
+	h q[1]
+	h q[2]
+	measure q[0]
+	measure q[1]
+	measure q[2]
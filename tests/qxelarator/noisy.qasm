@@ -0,0 +1,9 @@
+version 1.0
+
+qubits 3
+
+error_model depolarizing_channel, 0.0
+
+.flip
+	x q[0]
+	cnot q[0], q[2]
@@ -0,0 +1,10 @@
+version 1.0
+
+qubits 25
+
+# above 20 qubits the number of ways to pick the faulty qubits overflows
+# an integer : about 22% of the shots see errors with p = 0.01
+error_model depolarizing_channel, 0.01
+
+.flip
+	x q[0]
@@ -0,0 +1,16 @@
+version 1.0
+
+qubits 11
+
+# basis state 1000 : the second batch of 1000 amplitudes read by the
+# measurement of q[10] starts inside its first block
+.init
+	x q[3]
+	x q[5]
+	x q[6]
+	x q[7]
+	x q[8]
+	x q[9]
+
+.kernel1
+	measure q[10]
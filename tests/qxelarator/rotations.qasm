@@ -0,0 +1,12 @@
+version 1.0
+
+qubits 3
+
+.rotations
+	h q[0]
+	rx q[1], 0.3
+	cnot q[0], q[1]
+	ry q[2], 1.2
+	rz q[0], 0.7
+	cr q[1], q[2], 0.5
+	t q[2]
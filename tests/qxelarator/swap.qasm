@@ -0,0 +1,24 @@
+version 1.0
+
+qubits 4
+
+.init
+	prep_z q[0]
+	prep_z q[1]
+	prep_z q[2]
+	prep_z q[3]
+	x q[0]
+	x q[1]
+
+.route
+	swap q[0], q[1]
+	swap q[1], q[2]
+	swap q[3], q[0]
+	swap q[2], q[3]
+	swap q[1], q[2]
+	swap q[2], q[1]
+
+	measure q[0]
+	measure q[1]
+	measure q[2]
+	measure q[3]
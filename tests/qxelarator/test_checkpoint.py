@@ -0,0 +1,47 @@
+import unittest
+import os
+import tempfile
+
+def test_checkpoint():
+    import qxelarator
+
+    path = os.path.join(os.path.dirname(os.path.realpath(__file__)), 'rotations.qasm')
+    directory = tempfile.mkdtemp()
+    checkpoint = os.path.join(directory, 'rotations.ckpt')
+
+    qx = qxelarator.QX()
+    qx.set(path)
+    qx.execute()
+    state = qx.get_state()
+
+    # the last checkpoint is taken after 6 of the 7 gates
+    qx = qxelarator.QX()
+    qx.set(path)
+    qx.set_checkpoint(checkpoint, 3)
+    qx.execute()
+    assert qx.get_state() == state
+    assert os.path.exists(checkpoint)
+
+    # resuming replays the last gate and ends in the state of the
+    # uninterrupted run
+    qx = qxelarator.QX()
+    qx.set(path)
+    qx.restore(checkpoint)
+    qx.execute()
+    assert qx.get_state() == state
+
+    # a program differing by an angle does not resume the checkpoint
+    other = os.path.join(directory, 'other.qasm')
+    with open(path) as source, open(other, 'w') as target:
+        target.write(source.read().replace('rx q[1], 0.3', 'rx q[1], 0.4'))
+    qx = qxelarator.QX()
+    qx.set(other)
+    qx.restore(checkpoint)
+    qx.execute()
+    assert qx.get_state() != state
+
+    os.remove(checkpoint)
+    os.remove(other)
+
+if __name__ == '__main__':
+    test_checkpoint()
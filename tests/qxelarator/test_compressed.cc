@@ -0,0 +1,49 @@
+#include <iostream>
+#include <random>
+#include "qx/representation.h"
+#include "qx/core/compressed.h"
+
+// runs random circuits on 18 qubits on the compressed backend and on the
+// state vector : above 16 qubits a register holds several chunks, which
+// are palette-coded, sparse or dense as the circuit goes
+int main() {
+
+    const size_t n = 18;
+    double worst = 0;
+
+    for (unsigned seed = 0; seed < 8; seed++) {
+        std::mt19937 rng(seed);
+        qx::circuit c(n);
+        for (size_t g = 0; g < 160; g++) {
+            size_t a = rng() % n;
+            size_t b = (a + 1 + rng() % (n - 1)) % n;
+            size_t t = (b + 1 + rng() % (n - 2)) % n;
+            if (t == a) t = (t + 1) % n;
+            if (t == b) t = (t + 1) % n;
+            if (t == a) t = (t + 1) % n;
+            double angle = (rng() % 1000) / 100.0;
+            switch (rng() % 8) {
+                case 0:  c.add(new qx::hadamard(a)); break;
+                case 1:  c.add(new qx::rx(a, angle)); break;
+                case 2:  c.add(new qx::ry(a, angle)); break;
+                case 3:  c.add(new qx::rz(a, angle)); break;
+                case 4:  c.add(new qx::cnot(a, b)); break;
+                case 5:  c.add(new qx::toffoli(a, b, t)); break;
+                case 6:  c.add(new qx::swap(a, b)); break;
+                default: c.add(new qx::cphase(a, b)); break;
+            }
+        }
+
+        qx::qu_register reg(n);
+        qx::compressed_register creg(n);
+        c.execute(reg, false, true);
+        creg.execute(&c);
+
+        for (uint64_t i = 0; i < (1UL << n); i++)
+            worst = std::max(worst, (reg.get_data()[i] - creg.amplitude(i)).norm());
+    }
+
+    std::cout << "largest squared difference with the state vector : " << worst << std::endl;
+    // only amplitudes of weight below the tolerance (1e-30) may be dropped
+    return (worst < 1e-20) ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+import unittest
+import math
+import os
+
+def test_compressed():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # the 40 qubits of the chain only have two non-zero amplitudes
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'chain.qasm'))
+    assert qx.set_backend('compressed')
+    qx.execute()
+
+    p = math.sin(0.5)**2
+    assert abs(qx.get_probability(0)) < 1e-9
+    assert abs(qx.get_probability(1) - p) < 1e-9
+    assert abs(qx.get_probability(39) - p) < 1e-9
+    assert 'compression ratio' in qx.get_state()
+
+def test_palette():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # the dense chunks of the uniform superposition only hold +a and -a
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'uniform.qasm'))
+    assert qx.set_backend('compressed')
+    qx.execute()
+
+    assert abs(qx.get_probability(0) - 0.5) < 1e-9
+    assert abs(qx.get_probability(19) - 0.5) < 1e-9
+    state = qx.get_state()
+    ratio = float(state.split('compression ratio ')[1].split(',')[0])
+    assert ratio > 8
+    assert 'error bound 0' in state
+
+if __name__ == '__main__':
+    test_compressed()
+    test_palette()
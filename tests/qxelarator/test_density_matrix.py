@@ -0,0 +1,49 @@
+import unittest
+import math
+import os
+
+def test_density_matrix():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'noisy.qasm'))
+    assert qx.set_backend('density_matrix')
+    qx.execute()
+
+    assert abs(qx.get_probability(0) - 1) < 1e-9
+    assert abs(qx.get_probability(1)) < 1e-9
+    assert abs(qx.get_probability(2) - 1) < 1e-9
+
+def test_depolarizing():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # q[0] is flipped with probability p before its measurement, q[1] gets
+    # an x or y error (2p/3) after it
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'depolarizing.qasm'))
+    assert qx.set_backend('density_matrix')
+    qx.execute()
+
+    assert abs(qx.get_probability(0) - 0.1) < 1e-9
+    assert abs(qx.get_probability(1) - 0.2/3) < 1e-9
+
+def test_amplitude_damping():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # t1 = 10 cycles, one cycle per gate : q[0] relaxes during x and h,
+    # q[1] during h only
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'damping.qasm'))
+    assert qx.set_backend('density_matrix')
+    qx.execute()
+
+    assert abs(qx.get_probability(0) - math.exp(-0.2)) < 1e-6
+    assert abs(qx.get_probability(1) - 0.5*math.exp(-0.1)) < 1e-6
+
+if __name__ == '__main__':
+    test_density_matrix()
+    test_depolarizing()
+    test_amplitude_damping()
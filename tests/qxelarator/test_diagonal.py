@@ -0,0 +1,20 @@
+import unittest
+import os
+
+def test_diagonal():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'diagonal.qasm'))
+
+    # the phases between the hadamards amount to z on each qubit
+    for precision in ['double', 'single']:
+        assert qx.set_precision(precision)
+        qx.execute()
+        assert qx.get_measurement_outcome(0)
+        assert qx.get_measurement_outcome(1)
+        assert qx.get_measurement_outcome(2)
+
+if __name__ == '__main__':
+    test_diagonal()
@@ -0,0 +1,19 @@
+import unittest
+import os
+
+def test_histogram():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'bell.qasm'))
+    qx.execute(1000)
+
+    # terminal measurements only : the shots are drawn from a single simulation
+    h = qx.get_histogram()
+    print(dict(h))
+    assert sum(h.values()) == 1000
+    assert set(h.keys()) <= {'00', '11'}
+
+if __name__ == '__main__':
+    test_histogram()
@@ -0,0 +1,37 @@
+import unittest
+import math
+import os
+
+def test_mps():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # 40 qubits are out of reach of a state vector : the matrix product
+    # state is picked automatically, and the gates between q[0] and q[39]
+    # go through swaps
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'chain.qasm'))
+    qx.execute()
+
+    p = math.sin(0.5)**2
+    assert abs(qx.get_probability(0)) < 1e-9
+    assert abs(qx.get_probability(1) - p) < 1e-9
+    assert abs(qx.get_probability(39) - p) < 1e-9
+    assert abs(qx.get_truncation_fidelity() - 1) < 1e-9
+
+def test_mps_truncation():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'chain.qasm'))
+    assert qx.set_backend('mps')
+    qx.set_mps(1)
+    qx.execute()
+
+    # a product state cannot hold the entanglement of the chain
+    assert qx.get_truncation_fidelity() < 0.9
+
+if __name__ == '__main__':
+    test_mps()
+    test_mps_truncation()
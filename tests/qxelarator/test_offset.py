@@ -0,0 +1,18 @@
+import unittest
+import os
+
+def test_offset():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # q[10] has no probability of being 1 in basis state 1000
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'offset.qasm'))
+    qx.execute()
+
+    assert not qx.get_measurement_outcome(10)
+    assert abs(qx.get_probability(10)) < 1e-9
+    assert abs(qx.get_probability(3) - 1) < 1e-9
+
+if __name__ == '__main__':
+    test_offset()
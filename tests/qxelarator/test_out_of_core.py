@@ -0,0 +1,26 @@
+import unittest
+import os
+import tempfile
+
+def test_out_of_core():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'swap.qasm'))
+
+    # no state file can be created in a missing directory
+    assert not qx.set_out_of_core(os.path.join(tempfile.gettempdir(), 'qx_missing', 'states'))
+
+    with tempfile.TemporaryDirectory() as d:
+        assert qx.set_out_of_core(d)
+        qx.execute()
+        assert qx.set_out_of_core('')
+
+    assert not qx.get_measurement_outcome(0)
+    assert not qx.get_measurement_outcome(1)
+    assert qx.get_measurement_outcome(2)
+    assert qx.get_measurement_outcome(3)
+
+if __name__ == '__main__':
+    test_out_of_core()
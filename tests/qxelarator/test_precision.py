@@ -0,0 +1,21 @@
+import unittest
+import os
+
+def test_precision():
+    import qxelarator
+
+    qx = qxelarator.QX()
+    assert qx.set_precision('single')
+    assert not qx.set_precision('half')
+
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'basic.qasm'))
+    qx.execute()
+
+    # x on both qubits : the outcome is deterministic in any precision
+    assert qx.get_measurement_outcome(0)
+    assert qx.get_measurement_outcome(1)
+
+    print('quantum state: \n'+qx.get_state())
+
+if __name__ == '__main__':
+    test_precision()
@@ -0,0 +1,37 @@
+#include <iostream>
+#include <cmath>
+#include "qx/representation.h"
+
+// compares the qft of each basis state of 4 of the 5 qubits with the
+// corresponding column of the DFT matrix, the fifth qubit being left alone
+int main() {
+
+    const size_t n = 5;
+    const std::vector<uint64_t> qubits = { 0, 1, 3, 4 };
+    const uint64_t dim = (1UL << qubits.size());
+    double worst = 0;
+
+    for (uint64_t k = 0; k < dim; k++) {
+        qx::qu_register reg(n);
+        // basis state k on the qft qubits, and |1> on qubit 2
+        qx::pauli_x(2).apply(reg);
+        for (size_t b = 0; b < qubits.size(); b++)
+            if ((k >> b) & 1)
+                qx::pauli_x(qubits[b]).apply(reg);
+        qx::qft(qubits).apply(reg);
+
+        for (uint64_t j = 0; j < dim; j++) {
+            uint64_t x = (1UL << 2);
+            for (size_t b = 0; b < qubits.size(); b++)
+                if ((j >> b) & 1)
+                    x |= (1UL << qubits[b]);
+            double phase = 2*M_PI*(double)(j*k)/dim;
+            complex_t expected(std::cos(phase)/std::sqrt((double)dim), std::sin(phase)/std::sqrt((double)dim));
+            worst = std::max(worst, (reg.get_data()[x] - expected).norm());
+        }
+    }
+
+    std::cout << "largest squared difference with the DFT matrix : " << worst << std::endl;
+    // R_SQRT_2 of the hadamard gate is a float literal
+    return (worst < 1e-12) ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+import unittest
+import math
+import os
+
+def test_sparse():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # the cnot chain relabels the two amplitudes of the 40 qubits
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'chain.qasm'))
+    assert qx.set_backend('sparse')
+    qx.execute()
+
+    p = math.sin(0.5)**2
+    assert abs(qx.get_probability(0)) < 1e-9
+    assert abs(qx.get_probability(1) - p) < 1e-9
+    assert abs(qx.get_probability(39) - p) < 1e-9
+    assert len(qx.get_state().splitlines()) == 2
+
+if __name__ == '__main__':
+    test_sparse()
@@ -0,0 +1,47 @@
+import unittest
+import os
+
+def test_stabilizer():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'basic.qasm'))
+    assert qx.set_backend('stabilizer')
+    assert not qx.set_backend('tensor_network')
+    qx.execute()
+
+    # basic.qasm only has clifford gates : x, cz and measurements
+    assert qx.get_measurement_outcome(0)
+    assert qx.get_measurement_outcome(1)
+
+def test_pauli_frames():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # noisy clifford program : the shots are drawn by pauli frame sampling
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'noisy.qasm'))
+    qx.execute(1000)
+
+    h = qx.get_histogram()
+    assert dict(h) == {'101': 1000}
+
+def test_pauli_frames_25_qubits():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # one gate on 25 qubits : errors hit it with probability 1-(1-p)^25,
+    # about 0.22, and the x and y errors (about 70% of them) flip a qubit
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'noisy25.qasm'))
+    qx.execute(4000)
+
+    h = dict(qx.get_histogram())
+    flipped = 1 - max(h.values()) / 4000
+    assert 0.12 < flipped < 0.2
+
+if __name__ == '__main__':
+    test_stabilizer()
+    test_pauli_frames()
+    test_pauli_frames_25_qubits()
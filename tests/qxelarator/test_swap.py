@@ -0,0 +1,21 @@
+import unittest
+import os
+
+def test_swap():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'swap.qasm'))
+
+    # the swaps move the states of q0 and q1 to q3 and q2
+    for precision in ['double', 'single']:
+        assert qx.set_precision(precision)
+        qx.execute()
+        assert not qx.get_measurement_outcome(0)
+        assert not qx.get_measurement_outcome(1)
+        assert qx.get_measurement_outcome(2)
+        assert qx.get_measurement_outcome(3)
+
+if __name__ == '__main__':
+    test_swap()
@@ -0,0 +1,35 @@
+import unittest
+import os
+
+def test_trajectories():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'noisy.qasm'))
+    qx.set_backend('state_vector')
+    qx.set_trajectories(4, 64)
+    qx.execute(100)
+
+    # every trajectory measures all the qubits, the outcome of the last
+    # shot is kept
+    assert qx.get_measurement_outcome(0)
+    assert not qx.get_measurement_outcome(1)
+    assert qx.get_measurement_outcome(2)
+
+def test_damping_trajectory():
+    import qxelarator
+
+    qx = qxelarator.QX()
+
+    # a quantum-jump trajectory leaves q[0] either decayed or excited
+    qx.set(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'damping.qasm'))
+    qx.set_backend('state_vector')
+    qx.execute()
+
+    p = qx.get_probability(0)
+    assert p < 1e-6 or p > 1 - 1e-6
+
+if __name__ == '__main__':
+    test_trajectories()
+    test_damping_trajectory()
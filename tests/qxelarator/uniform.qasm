@@ -0,0 +1,7 @@
+version 1.0
+
+qubits 20
+
+.uniform
+	h q[0:19]
+	z q[0]